@@ -0,0 +1,431 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bit>
+
+/*
+压缩棋盘：64bit存放4*4的格子，每格4bit存放数字的指数（0为空，n为2^n），
+行优先存放，第y行位于[16y, 16y+16)，行内第x列位于低位起的第4x bit
+
+移动使用预先计算的行表（65536种行 * 左右两个方向），上下移动通过转置变为左右移动
+注意：4bit最大只能表示2^15=32768，两个32768不会再合并
+
+对称：棋盘有8种对称（旋转与镜像），编号s的三个bit依次为：bit2先转置，bit0再水平镜像，bit1最后垂直镜像，
+等价的棋盘取8种变换中数值最小者为规范形式，用作缓存或表的键可以节省最多8倍空间
+*/
+class Board_Packed
+{
+public:
+	using Board = uint64_t;
+	using Row = uint16_t;
+
+	//与Game2048_Core::Direction保持一致
+	enum Direction : uint8_t
+	{
+		Up = 0,
+		Dn,
+		Lt,
+		Rt,
+		Enum_End,
+	};
+
+	constexpr const static inline size_t szWidth = 4;
+	constexpr const static inline size_t szHeight = 4;
+	constexpr const static inline size_t szTotalSize = szWidth * szHeight;
+	constexpr const static inline size_t szRowCount = 65536;
+	constexpr const static inline uint8_t u8MaxExponent = 15;
+
+private:
+	struct Row_Table
+	{
+		Row u16Left[szRowCount];//向左移动后的行
+		Row u16Right[szRowCount];//向右移动后的行
+		uint32_t u32Score[szRowCount];//移动产生的分数（左右相同）
+	};
+
+	static Row ReverseRow(Row u16Row)
+	{
+		return (Row)(((u16Row >> 12) & 0x000F) | ((u16Row >> 4) & 0x00F0) | ((u16Row << 4) & 0x0F00) | ((u16Row << 12) & 0xF000));
+	}
+
+	//按照游戏规则计算一行向左移动的结果
+	static Row MoveRowLeft(Row u16Row, uint32_t &u32Score)
+	{
+		uint8_t u8Cell[szWidth] = {};
+		size_t szCount = 0;
+		bool bMerged = false;//上一个格子是否由合并得到，合并过的不能再次合并
+
+		u32Score = 0;
+		for (size_t i = 0; i < szWidth; ++i)
+		{
+			uint8_t u8Exp = (u16Row >> (i * 4)) & 0x0F;
+			if (u8Exp == 0)
+			{
+				continue;
+			}
+
+			if (szCount != 0 && !bMerged && u8Cell[szCount - 1] == u8Exp && u8Exp != u8MaxExponent)
+			{
+				++u8Cell[szCount - 1];
+				u32Score += (uint32_t)1 << u8Cell[szCount - 1];
+				bMerged = true;
+			}
+			else
+			{
+				u8Cell[szCount++] = u8Exp;
+				bMerged = false;
+			}
+		}
+
+		Row u16Ret = 0;
+		for (size_t i = 0; i < szCount; ++i)
+		{
+			u16Ret |= (Row)u8Cell[i] << (i * 4);
+		}
+
+		return u16Ret;
+	}
+
+	static const Row_Table &BuildTable(void)
+	{
+		static Row_Table stTable;//约640KB，放在静态区
+
+		for (size_t i = 0; i < szRowCount; ++i)
+		{
+			Row u16Row = (Row)i;
+			uint32_t u32Score = 0;
+
+			stTable.u16Left[i] = MoveRowLeft(u16Row, u32Score);
+			stTable.u32Score[i] = u32Score;
+
+			uint32_t u32Unused = 0;
+			stTable.u16Right[i] = ReverseRow(MoveRowLeft(ReverseRow(u16Row), u32Unused));
+		}
+
+		return stTable;
+	}
+
+	static const Row_Table &GetTable(void)
+	{
+		static const Row_Table &stTable = BuildTable();//首次使用时构建，线程安全
+		return stTable;
+	}
+
+public:
+	//====================格子访问====================
+	static uint8_t GetCell(Board u64Board, size_t szIndex)
+	{
+		return (u64Board >> (szIndex * 4)) & 0x0F;
+	}
+
+	static Board SetCell(Board u64Board, size_t szIndex, uint8_t u8Exp)
+	{
+		return (u64Board & ~((Board)0x0F << (szIndex * 4))) | ((Board)(u8Exp & 0x0F) << (szIndex * 4));
+	}
+
+	static Row GetRow(Board u64Board, size_t szY)
+	{
+		return (Row)(u64Board >> (szY * 16));
+	}
+
+	//指数转换为数值，0为空
+	static uint64_t ExponentToValue(uint8_t u8Exp)
+	{
+		return u8Exp == 0 ? 0 : (uint64_t)1 << u8Exp;
+	}
+
+	//数值转换为指数，数值必须是2的幂或者0
+	static uint8_t ValueToExponent(uint64_t u64Value)
+	{
+		return u64Value == 0 ? 0 : (uint8_t)std::countr_zero(u64Value);
+	}
+
+	//====================整体变换====================
+	//转置（行列互换）
+	static Board Transpose(Board x)
+	{
+		Board a1 = x & 0xF0F00F0FF0F00F0FULL;
+		Board a2 = x & 0x0000F0F00000F0F0ULL;
+		Board a3 = x & 0x0F0F00000F0F0000ULL;
+		Board a = a1 | (a2 << 12) | (a3 >> 12);
+		Board b1 = a & 0xFF00FF0000FF00FFULL;
+		Board b2 = a & 0x00FF00FF00000000ULL;
+		Board b3 = a & 0x00000000FF00FF00ULL;
+		return b1 | (b2 >> 24) | (b3 << 24);
+	}
+
+	//水平镜像（每行左右翻转）
+	static Board MirrorHorizontal(Board x)
+	{
+		return
+			((x & 0x000F000F000F000FULL) << 12) |
+			((x & 0x00F000F000F000F0ULL) << 4) |
+			((x & 0x0F000F000F000F00ULL) >> 4) |
+			((x & 0xF000F000F000F000ULL) >> 12);
+	}
+
+	//垂直镜像（行的上下顺序翻转）
+	static Board MirrorVertical(Board x)
+	{
+		return
+			((x & 0x000000000000FFFFULL) << 48) |
+			((x & 0x00000000FFFF0000ULL) << 16) |
+			((x & 0x0000FFFF00000000ULL) >> 16) |
+			((x & 0xFFFF000000000000ULL) >> 48);
+	}
+
+	//====================对称====================
+	constexpr const static inline uint8_t u8SymmetryCount = 8;
+
+	//对棋盘应用第u8Sym种对称变换
+	static Board ApplySymmetry(Board u64Board, uint8_t u8Sym)
+	{
+		if (u8Sym & 4)
+		{
+			u64Board = Transpose(u64Board);
+		}
+		if (u8Sym & 1)
+		{
+			u64Board = MirrorHorizontal(u64Board);
+		}
+		if (u8Sym & 2)
+		{
+			u64Board = MirrorVertical(u64Board);
+		}
+
+		return u64Board;
+	}
+
+	//撤销第u8Sym种对称变换
+	static Board InvertSymmetry(Board u64Board, uint8_t u8Sym)
+	{
+		if (u8Sym & 2)
+		{
+			u64Board = MirrorVertical(u64Board);
+		}
+		if (u8Sym & 1)
+		{
+			u64Board = MirrorHorizontal(u64Board);
+		}
+		if (u8Sym & 4)
+		{
+			u64Board = Transpose(u64Board);
+		}
+
+		return u64Board;
+	}
+
+	//规范形式：8种对称中数值最小的棋盘，u8Sym返回得到规范形式所用的变换
+	//只需一次转置，其余均为移位与掩码
+	static Board Canonical(Board u64Board, uint8_t &u8Sym)
+	{
+		Board u64Transpose = Transpose(u64Board);
+		Board u64Cand[u8SymmetryCount] =
+		{
+			u64Board,
+			MirrorHorizontal(u64Board),
+			MirrorVertical(u64Board),
+			0,
+			u64Transpose,
+			MirrorHorizontal(u64Transpose),
+			MirrorVertical(u64Transpose),
+			0,
+		};
+		u64Cand[3] = MirrorVertical(u64Cand[1]);
+		u64Cand[7] = MirrorVertical(u64Cand[5]);
+
+		//条件选择而不是分支，避免随机棋盘下的分支预测失败
+		Board u64Min = u64Cand[0];
+		u8Sym = 0;
+		for (uint8_t i = 1; i < u8SymmetryCount; ++i)
+		{
+			bool bLess = u64Cand[i] < u64Min;
+			u64Min = bLess ? u64Cand[i] : u64Min;
+			u8Sym = bLess ? i : u8Sym;
+		}
+
+		return u64Min;
+	}
+
+	static Board Canonical(Board u64Board)
+	{
+		Board u64Transpose = Transpose(u64Board);
+		Board u64Mirror = MirrorHorizontal(u64Board);
+		Board u64TransposeMirror = MirrorHorizontal(u64Transpose);
+
+		const Board u64Cand[u8SymmetryCount - 1] =
+		{
+			u64Mirror,
+			MirrorVertical(u64Board),
+			MirrorVertical(u64Mirror),
+			u64Transpose,
+			u64TransposeMirror,
+			MirrorVertical(u64Transpose),
+			MirrorVertical(u64TransposeMirror),
+		};
+
+		Board u64Min = u64Board;
+		for (Board u64It : u64Cand)
+		{
+			u64Min = u64It < u64Min ? u64It : u64Min;
+		}
+
+		return u64Min;
+	}
+
+	//原棋盘上的方向在第u8Sym种对称变换后的棋盘上对应的方向，
+	//即ApplySymmetry(Move(b, d), s) == Move(ApplySymmetry(b, s), MapDirection(d, s))
+	static Direction MapDirection(Direction dMove, uint8_t u8Sym)
+	{
+		if (u8Sym & 4)//转置：上<->左，下<->右
+		{
+			constexpr const static Direction dTranspose[] = { Lt, Rt, Up, Dn };
+			dMove = dTranspose[dMove];
+		}
+		if (u8Sym & 1)//水平镜像：左<->右
+		{
+			dMove = dMove == Lt ? Rt : dMove == Rt ? Lt : dMove;
+		}
+		if (u8Sym & 2)//垂直镜像：上<->下
+		{
+			dMove = dMove == Up ? Dn : dMove == Dn ? Up : dMove;
+		}
+
+		return dMove;
+	}
+
+	//MapDirection的逆变换：变换后棋盘上的方向对应原棋盘上的方向
+	static Direction UnmapDirection(Direction dMove, uint8_t u8Sym)
+	{
+		if (u8Sym & 2)
+		{
+			dMove = dMove == Up ? Dn : dMove == Dn ? Up : dMove;
+		}
+		if (u8Sym & 1)
+		{
+			dMove = dMove == Lt ? Rt : dMove == Rt ? Lt : dMove;
+		}
+		if (u8Sym & 4)
+		{
+			constexpr const static Direction dTranspose[] = { Lt, Rt, Up, Dn };
+			dMove = dTranspose[dMove];
+		}
+
+		return dMove;
+	}
+
+	//====================统计====================
+	static size_t CountEmpty(Board u64Board)
+	{
+		//把每个4bit压缩到最低位：非空格子最低位为1
+		u64Board |= (u64Board >> 2) & 0x3333333333333333ULL;
+		u64Board |= (u64Board >> 1);
+		u64Board = ~u64Board & 0x1111111111111111ULL;
+		return (size_t)std::popcount(u64Board);
+	}
+
+	static uint8_t MaxExponent(Board u64Board)
+	{
+		uint8_t u8Max = 0;
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			uint8_t u8Exp = GetCell(u64Board, i);
+			u8Max = u8Exp > u8Max ? u8Exp : u8Max;
+		}
+
+		return u8Max;
+	}
+
+	//====================移动====================
+	//移动并累加分数，棋盘不变则说明该方向无效
+	static Board Move(Board u64Board, Direction dMove, uint32_t &u32Score)
+	{
+		const Row_Table &stTable = GetTable();
+
+		bool bVertical = (dMove == Up || dMove == Dn);
+		const Row *pRowTable = (dMove == Up || dMove == Lt) ? stTable.u16Left : stTable.u16Right;
+
+		Board u64Src = bVertical ? Transpose(u64Board) : u64Board;
+		Board u64Dst = 0;
+		for (size_t szY = 0; szY < szHeight; ++szY)
+		{
+			Row u16Row = GetRow(u64Src, szY);
+			u64Dst |= (Board)pRowTable[u16Row] << (szY * 16);
+			u32Score += stTable.u32Score[u16Row];
+		}
+
+		return bVertical ? Transpose(u64Dst) : u64Dst;
+	}
+
+	//单行查表移动，bRight为false向左，供其它棋盘表示（如Board_Wide）复用行表
+	static Row MoveRow(Row u16Row, bool bRight, uint32_t &u32Score)
+	{
+		const Row_Table &stTable = GetTable();
+		u32Score += stTable.u32Score[u16Row];
+		return bRight ? stTable.u16Right[u16Row] : stTable.u16Left[u16Row];
+	}
+
+	static Board Move(Board u64Board, Direction dMove)
+	{
+		uint32_t u32Unused = 0;
+		return Move(u64Board, dMove, u32Unused);
+	}
+
+	//合法移动掩码，第d位为1代表方向d有效
+	//只需要判断每行是否变化，不必组装移动后的棋盘，且上下只需转置一次
+	static uint8_t LegalMoves(Board u64Board)
+	{
+		const Row_Table &stTable = GetTable();
+		Board u64Transpose = Transpose(u64Board);
+
+		uint8_t u8Mask = 0;
+		for (size_t szY = 0; szY < szHeight; ++szY)
+		{
+			Row u16Row = GetRow(u64Board, szY);
+			Row u16Col = GetRow(u64Transpose, szY);
+
+			u8Mask |= (stTable.u16Left[u16Col] != u16Col) << Up;
+			u8Mask |= (stTable.u16Right[u16Col] != u16Col) << Dn;
+			u8Mask |= (stTable.u16Left[u16Row] != u16Row) << Lt;
+			u8Mask |= (stTable.u16Right[u16Row] != u16Row) << Rt;
+		}
+
+		return u8Mask;
+	}
+
+	//====================生成数字====================
+	//在第szNth个空格子处放置指数为u8Exp的数字，szNth必须小于空格子数
+	static Board SpawnAt(Board u64Board, size_t szNth, uint8_t u8Exp)
+	{
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			if (GetCell(u64Board, i) != 0)
+			{
+				continue;
+			}
+
+			if (szNth-- == 0)
+			{
+				return SetCell(u64Board, i, u8Exp);
+			}
+		}
+
+		return u64Board;
+	}
+
+	//在随机空格子处生成2（90%）或4（10%），没有空格子则不变
+	//Rand需要提供Below(n)返回[0, n)内的均匀整数（如Fast_Rand），一次取随机数同时决定位置与数值
+	template<typename Rand>
+	static Board SpawnRandom(Board u64Board, Rand &rand)
+	{
+		size_t szEmpty = CountEmpty(u64Board);
+		if (szEmpty == 0)
+		{
+			return u64Board;
+		}
+
+		uint32_t u32Rand = rand.Below((uint32_t)szEmpty * 10);
+		return SpawnAt(u64Board, u32Rand / 10, u32Rand % 10 == 0 ? 2 : 1);
+	}
+};
@@ -0,0 +1,287 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "Board_Packed.hpp"
+
+/*
+小棋盘（宽高均为2~4）：与Board_Packed相同，每格4bit存放指数，但格子按y*宽+x紧密排列，
+移动通过按长度预先计算的行表完成，宽高不同的棋盘只有4种对称（不能转置）
+
+用于小棋盘的穷举求解（见Game2048_Tablebase.hpp），速度不如Board_Packed，但宽高可以在运行时指定
+*/
+class Board_Small
+{
+public:
+	using Board = uint64_t;
+	using Direction = Board_Packed::Direction;
+
+	constexpr const static inline size_t szMinSide = 2;
+	constexpr const static inline size_t szMaxSide = 4;
+	constexpr const static inline size_t szMaxCells = szMaxSide * szMaxSide;
+
+private:
+	size_t szWidth;
+	size_t szHeight;
+	size_t szCells;
+
+	//每个方向的所有行：u8Lines[d][i]为第i行按移动方向从前到后的格子下标
+	uint8_t u8Lines[Board_Packed::Enum_End][szMaxSide][szMaxSide];
+	size_t szLineCount[Board_Packed::Enum_End];
+	size_t szLineLength[Board_Packed::Enum_End];
+
+	std::vector<uint16_t> vecLineLeft[szMaxSide + 1];//按长度区分的向左移动表
+
+	size_t szSymmetryCount;
+	uint8_t u8Symmetry[Board_Packed::u8SymmetryCount][szMaxCells];//第s种对称下第i格移动到的位置
+
+private:
+	//按照游戏规则计算长度为szLength的一行向左移动的结果
+	static uint16_t MoveLineLeft(uint16_t u16Line, size_t szLength)
+	{
+		uint8_t u8Cell[szMaxSide] = {};
+		size_t szCount = 0;
+		bool bMerged = false;
+
+		for (size_t i = 0; i < szLength; ++i)
+		{
+			uint8_t u8Exp = (u16Line >> (i * 4)) & 0x0F;
+			if (u8Exp == 0)
+			{
+				continue;
+			}
+
+			if (szCount != 0 && !bMerged && u8Cell[szCount - 1] == u8Exp && u8Exp != Board_Packed::u8MaxExponent)
+			{
+				++u8Cell[szCount - 1];
+				bMerged = true;
+			}
+			else
+			{
+				u8Cell[szCount++] = u8Exp;
+				bMerged = false;
+			}
+		}
+
+		uint16_t u16Ret = 0;
+		for (size_t i = 0; i < szCount; ++i)
+		{
+			u16Ret |= (uint16_t)u8Cell[i] << (i * 4);
+		}
+
+		return u16Ret;
+	}
+
+	void BuildLineTable(size_t szLength)
+	{
+		if (!vecLineLeft[szLength].empty())
+		{
+			return;
+		}
+
+		vecLineLeft[szLength].resize((size_t)1 << (4 * szLength));
+		for (size_t i = 0; i < vecLineLeft[szLength].size(); ++i)
+		{
+			vecLineLeft[szLength][i] = MoveLineLeft((uint16_t)i, szLength);
+		}
+	}
+
+	void BuildLines(void)
+	{
+		for (size_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			bool bHorizontal = d == Board_Packed::Lt || d == Board_Packed::Rt;
+			bool bReverse = d == Board_Packed::Dn || d == Board_Packed::Rt;
+
+			szLineCount[d] = bHorizontal ? szHeight : szWidth;
+			szLineLength[d] = bHorizontal ? szWidth : szHeight;
+			for (size_t i = 0; i < szLineCount[d]; ++i)
+			{
+				for (size_t k = 0; k < szLineLength[d]; ++k)
+				{
+					size_t szPos = bReverse ? szLineLength[d] - 1 - k : k;
+					size_t x = bHorizontal ? szPos : i;
+					size_t y = bHorizontal ? i : szPos;
+					u8Lines[d][i][k] = (uint8_t)(y * szWidth + x);
+				}
+			}
+		}
+	}
+
+	void BuildSymmetry(void)
+	{
+		//编号与Board_Packed相同：bit2转置，bit0水平镜像，bit1垂直镜像，宽高不同时只用前4种
+		szSymmetryCount = szWidth == szHeight ? Board_Packed::u8SymmetryCount : 4;
+		for (size_t s = 0; s < szSymmetryCount; ++s)
+		{
+			for (size_t i = 0; i < szCells; ++i)
+			{
+				size_t x = i % szWidth, y = i / szWidth;
+				if (s & 4)
+				{
+					size_t t = x;
+					x = y;
+					y = t;
+				}
+				if (s & 1)
+				{
+					x = szWidth - 1 - x;
+				}
+				if (s & 2)
+				{
+					y = szHeight - 1 - y;
+				}
+				u8Symmetry[s][i] = (uint8_t)(y * szWidth + x);
+			}
+		}
+	}
+
+public:
+	Board_Small(size_t _szWidth, size_t _szHeight) :
+		szWidth(_szWidth),
+		szHeight(_szHeight),
+		szCells(_szWidth * _szHeight),
+		u8Lines{},
+		szLineCount{},
+		szLineLength{},
+		vecLineLeft{},
+		szSymmetryCount(0),
+		u8Symmetry{}
+	{
+		BuildLineTable(szWidth);
+		BuildLineTable(szHeight);
+		BuildLines();
+		BuildSymmetry();
+	}
+	~Board_Small(void) = default;
+
+	Board_Small(const Board_Small &) = default;
+	Board_Small(Board_Small &&) = default;
+	Board_Small &operator=(const Board_Small &) = default;
+	Board_Small &operator=(Board_Small &&) = default;
+
+	static bool IsValidSize(size_t _szWidth, size_t _szHeight)
+	{
+		return _szWidth >= szMinSide && _szWidth <= szMaxSide && _szHeight >= szMinSide && _szHeight <= szMaxSide;
+	}
+
+	size_t Width(void) const
+	{
+		return szWidth;
+	}
+
+	size_t Height(void) const
+	{
+		return szHeight;
+	}
+
+	size_t Cells(void) const
+	{
+		return szCells;
+	}
+
+	//====================格子访问====================
+	static uint8_t GetCell(Board u64Board, size_t szIndex)
+	{
+		return (u64Board >> (szIndex * 4)) & 0x0F;
+	}
+
+	static Board SetCell(Board u64Board, size_t szIndex, uint8_t u8Exp)
+	{
+		return (u64Board & ~((Board)0x0F << (szIndex * 4))) | ((Board)(u8Exp & 0x0F) << (szIndex * 4));
+	}
+
+	size_t CountEmpty(Board u64Board) const
+	{
+		size_t szCount = 0;
+		for (size_t i = 0; i < szCells; ++i)
+		{
+			szCount += GetCell(u64Board, i) == 0;
+		}
+
+		return szCount;
+	}
+
+	uint8_t MaxExponent(Board u64Board) const
+	{
+		uint8_t u8Max = 0;
+		for (size_t i = 0; i < szCells; ++i)
+		{
+			uint8_t u8Exp = GetCell(u64Board, i);
+			u8Max = u8Exp > u8Max ? u8Exp : u8Max;
+		}
+
+		return u8Max;
+	}
+
+	//所有数字之和，移动不改变它，每次生成增加2或4，可以用来给局面分层
+	uint64_t TileSum(Board u64Board) const
+	{
+		uint64_t u64Sum = 0;
+		for (size_t i = 0; i < szCells; ++i)
+		{
+			u64Sum += Board_Packed::ExponentToValue(GetCell(u64Board, i));
+		}
+
+		return u64Sum;
+	}
+
+	//====================移动====================
+	//棋盘不变则说明该方向无效
+	Board Move(Board u64Board, Direction dMove) const
+	{
+		const std::vector<uint16_t> &vecTable = vecLineLeft[szLineLength[dMove]];
+
+		Board u64Ret = 0;
+		for (size_t i = 0; i < szLineCount[dMove]; ++i)
+		{
+			const uint8_t *pLine = u8Lines[dMove][i];
+
+			uint16_t u16Line = 0;
+			for (size_t k = 0; k < szLineLength[dMove]; ++k)
+			{
+				u16Line |= (uint16_t)GetCell(u64Board, pLine[k]) << (k * 4);
+			}
+
+			u16Line = vecTable[u16Line];
+			for (size_t k = 0; k < szLineLength[dMove]; ++k)
+			{
+				u64Ret |= (Board)((u16Line >> (k * 4)) & 0x0F) << (pLine[k] * 4);
+			}
+		}
+
+		return u64Ret;
+	}
+
+	//====================对称====================
+	size_t SymmetryCount(void) const
+	{
+		return szSymmetryCount;
+	}
+
+	Board ApplySymmetry(Board u64Board, size_t szSym) const
+	{
+		Board u64Ret = 0;
+		for (size_t i = 0; i < szCells; ++i)
+		{
+			u64Ret |= (Board)GetCell(u64Board, i) << (u8Symmetry[szSym][i] * 4);
+		}
+
+		return u64Ret;
+	}
+
+	//规范形式：所有对称中数值最小的棋盘
+	Board Canonical(Board u64Board) const
+	{
+		Board u64Min = u64Board;
+		for (size_t s = 1; s < szSymmetryCount; ++s)
+		{
+			Board u64Sym = ApplySymmetry(u64Board, s);
+			u64Min = u64Sym < u64Min ? u64Sym : u64Min;
+		}
+
+		return u64Min;
+	}
+};
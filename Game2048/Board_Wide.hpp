@@ -0,0 +1,292 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <bit>
+
+#include "Board_Packed.hpp"
+
+/*
+宽压缩棋盘：每格8bit存放数字的指数，4行各占一个u32（行内第x列位于低位起的第8x bit），
+指数最大为63（与Game2048_Core的u64格子一致），可以表示超过32768的数字
+
+移动时逐行处理：一行所有指数都不超过14时压缩为4bit行，直接使用Board_Packed的行表（结果最大为15，4bit可以表示），
+否则使用逐格合并的标量实现，所以数字不超过16384的行与Board_Packed速度相近，只有包含大数字的行走慢路径
+与Board_Packed之间可以互相转换：FitsPacked为true时（所有指数不超过15）转换不丢失信息，
+从不超过32768的对局可以一直使用Board_Packed，需要更大数字时再转换为本表示
+*/
+class Board_Wide
+{
+public:
+	using Row = uint32_t;
+	using Direction = Board_Packed::Direction;
+
+	struct Board
+	{
+		Row u32Rows[4];
+
+		bool operator==(const Board &) const = default;
+	};
+
+	constexpr const static inline size_t szWidth = 4;
+	constexpr const static inline size_t szHeight = 4;
+	constexpr const static inline size_t szTotalSize = szWidth * szHeight;
+	constexpr const static inline uint8_t u8MaxExponent = 63;
+
+private:
+	//任意字节为0
+	static bool HasZeroByte(uint32_t u32Value)
+	{
+		return ((u32Value - 0x01010101u) & ~u32Value & 0x80808080u) != 0;
+	}
+
+	//所有指数都不超过14，可以走4bit行表
+	static bool RowFitsTable(Row u32Row)
+	{
+		return (u32Row & 0xF0F0F0F0u) == 0 && !HasZeroByte(u32Row ^ 0x0F0F0F0Fu);
+	}
+
+	//每字节的低4bit压缩为4bit行（调用方保证高4bit为0）
+	static Board_Packed::Row PackRow(Row u32Row)
+	{
+		uint32_t u32Tmp = u32Row | (u32Row >> 4);
+		return (Board_Packed::Row)((u32Tmp & 0x00FF) | ((u32Tmp >> 8) & 0xFF00));
+	}
+
+	static Row UnpackRow(Board_Packed::Row u16Row)
+	{
+		uint32_t u32Tmp = (uint32_t)(u16Row & 0x00FF) | ((uint32_t)(u16Row & 0xFF00) << 8);
+		return (u32Tmp | (u32Tmp << 4)) & 0x0F0F0F0Fu;
+	}
+
+	static Row ReverseRow(Row u32Row)
+	{
+		return (u32Row >> 24) | ((u32Row >> 8) & 0x0000FF00u) | ((u32Row << 8) & 0x00FF0000u) | (u32Row << 24);
+	}
+
+	//按照游戏规则计算一行向左移动的结果（与Board_Packed::MoveRowLeft相同，只是指数为8bit）
+	static Row MoveRowLeftSlow(Row u32Row, uint64_t &u64Score)
+	{
+		uint8_t u8Cell[szWidth] = {};
+		size_t szCount = 0;
+		bool bMerged = false;//上一个格子是否由合并得到，合并过的不能再次合并
+
+		for (size_t i = 0; i < szWidth; ++i)
+		{
+			uint8_t u8Exp = (uint8_t)(u32Row >> (i * 8));
+			if (u8Exp == 0)
+			{
+				continue;
+			}
+
+			if (szCount != 0 && !bMerged && u8Cell[szCount - 1] == u8Exp && u8Exp < u8MaxExponent)
+			{
+				++u8Cell[szCount - 1];
+				u64Score += (uint64_t)1 << u8Cell[szCount - 1];
+				bMerged = true;
+			}
+			else
+			{
+				u8Cell[szCount++] = u8Exp;
+				bMerged = false;
+			}
+		}
+
+		Row u32Ret = 0;
+		for (size_t i = 0; i < szCount; ++i)
+		{
+			u32Ret |= (Row)u8Cell[i] << (i * 8);
+		}
+
+		return u32Ret;
+	}
+
+	static Row MoveRow(Row u32Row, bool bRight, uint64_t &u64Score)
+	{
+		if (RowFitsTable(u32Row))
+		{
+			uint32_t u32Score = 0;
+			Row u32Ret = UnpackRow(Board_Packed::MoveRow(PackRow(u32Row), bRight, u32Score));
+			u64Score += u32Score;
+			return u32Ret;
+		}
+
+		return bRight ? ReverseRow(MoveRowLeftSlow(ReverseRow(u32Row), u64Score)) : MoveRowLeftSlow(u32Row, u64Score);
+	}
+
+public:
+	//====================格子访问====================
+	static uint8_t GetCell(const Board &stBoard, size_t szIndex)
+	{
+		return (uint8_t)(stBoard.u32Rows[szIndex / szWidth] >> (szIndex % szWidth * 8));
+	}
+
+	static Board SetCell(Board stBoard, size_t szIndex, uint8_t u8Exp)
+	{
+		Row &u32Row = stBoard.u32Rows[szIndex / szWidth];
+		size_t szShift = szIndex % szWidth * 8;
+		u32Row = (u32Row & ~((Row)0xFF << szShift)) | ((Row)u8Exp << szShift);
+		return stBoard;
+	}
+
+	static uint64_t ExponentToValue(uint8_t u8Exp)
+	{
+		return u8Exp == 0 ? 0 : (uint64_t)1 << u8Exp;
+	}
+
+	//====================转换====================
+	static Board FromPacked(Board_Packed::Board u64Board)
+	{
+		Board stBoard{};
+		for (size_t szY = 0; szY < szHeight; ++szY)
+		{
+			stBoard.u32Rows[szY] = UnpackRow(Board_Packed::GetRow(u64Board, szY));
+		}
+
+		return stBoard;
+	}
+
+	//所有指数都不超过15，转换为Board_Packed不丢失信息
+	static bool FitsPacked(const Board &stBoard)
+	{
+		return ((stBoard.u32Rows[0] | stBoard.u32Rows[1] | stBoard.u32Rows[2] | stBoard.u32Rows[3]) & 0xF0F0F0F0u) == 0;
+	}
+
+	//超过32768的数字截断为32768（与Game2048_Core::GetPackedBoard相同）
+	static Board_Packed::Board ToPacked(const Board &stBoard)
+	{
+		Board_Packed::Board u64Board = 0;
+		for (size_t szY = 0; szY < szHeight; ++szY)
+		{
+			Row u32Row = stBoard.u32Rows[szY];
+			if ((u32Row & 0xF0F0F0F0u) != 0)
+			{
+				for (size_t szX = 0; szX < szWidth; ++szX)
+				{
+					uint32_t u32Exp = (u32Row >> (szX * 8)) & 0xFF;
+					u32Exp = u32Exp < Board_Packed::u8MaxExponent ? u32Exp : Board_Packed::u8MaxExponent;
+					u32Row = (u32Row & ~((Row)0xFF << (szX * 8))) | (u32Exp << (szX * 8));
+				}
+			}
+			u64Board |= (Board_Packed::Board)PackRow(u32Row) << (szY * 16);
+		}
+
+		return u64Board;
+	}
+
+	//====================整体变换====================
+	//转置：先在相邻两行之间交换单个字节，再在隔一行的两行之间交换两个字节
+	static Board Transpose(const Board &stBoard)
+	{
+		const Row *r = stBoard.u32Rows;
+		Row t0 = (r[0] & 0x00FF00FFu) | ((r[1] << 8) & 0xFF00FF00u);
+		Row t1 = ((r[0] >> 8) & 0x00FF00FFu) | (r[1] & 0xFF00FF00u);
+		Row t2 = (r[2] & 0x00FF00FFu) | ((r[3] << 8) & 0xFF00FF00u);
+		Row t3 = ((r[2] >> 8) & 0x00FF00FFu) | (r[3] & 0xFF00FF00u);
+
+		return Board{ {
+			(t0 & 0x0000FFFFu) | (t2 << 16),
+			(t1 & 0x0000FFFFu) | (t3 << 16),
+			(t0 >> 16) | (t2 & 0xFFFF0000u),
+			(t1 >> 16) | (t3 & 0xFFFF0000u),
+		} };
+	}
+
+	//====================统计====================
+	static size_t CountEmpty(const Board &stBoard)
+	{
+		//非0字节的最高位置1，再数最高位为0的字节
+		size_t szEmpty = 0;
+		for (Row u32Row : stBoard.u32Rows)
+		{
+			Row u32Tmp = ((u32Row & 0x7F7F7F7Fu) + 0x7F7F7F7Fu) | u32Row;
+			szEmpty += (size_t)std::popcount(~u32Tmp & 0x80808080u);
+		}
+
+		return szEmpty;
+	}
+
+	static uint8_t MaxExponent(const Board &stBoard)
+	{
+		uint8_t u8Max = 0;
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			uint8_t u8Exp = GetCell(stBoard, i);
+			u8Max = u8Exp > u8Max ? u8Exp : u8Max;
+		}
+
+		return u8Max;
+	}
+
+	//====================移动====================
+	//移动并累加分数，棋盘不变则说明该方向无效
+	static Board Move(const Board &stBoard, Direction dMove, uint64_t &u64Score)
+	{
+		bool bVertical = (dMove == Board_Packed::Up || dMove == Board_Packed::Dn);
+		bool bRight = (dMove == Board_Packed::Dn || dMove == Board_Packed::Rt);
+
+		Board stSrc = bVertical ? Transpose(stBoard) : stBoard;
+		Board stDst{};
+		for (size_t szY = 0; szY < szHeight; ++szY)
+		{
+			stDst.u32Rows[szY] = MoveRow(stSrc.u32Rows[szY], bRight, u64Score);
+		}
+
+		return bVertical ? Transpose(stDst) : stDst;
+	}
+
+	//合法移动掩码，第d位为1代表方向d有效，只比较每行与每列是否变化
+	static uint8_t LegalMoves(const Board &stBoard)
+	{
+		Board stTranspose = Transpose(stBoard);
+		uint64_t u64Unused = 0;
+
+		uint8_t u8Mask = 0;
+		for (size_t szY = 0; szY < szHeight; ++szY)
+		{
+			Row u32Row = stBoard.u32Rows[szY];
+			Row u32Col = stTranspose.u32Rows[szY];
+
+			u8Mask |= (MoveRow(u32Col, false, u64Unused) != u32Col) << Board_Packed::Up;
+			u8Mask |= (MoveRow(u32Col, true, u64Unused) != u32Col) << Board_Packed::Dn;
+			u8Mask |= (MoveRow(u32Row, false, u64Unused) != u32Row) << Board_Packed::Lt;
+			u8Mask |= (MoveRow(u32Row, true, u64Unused) != u32Row) << Board_Packed::Rt;
+		}
+
+		return u8Mask;
+	}
+
+	//====================生成数字====================
+	static Board SpawnAt(Board stBoard, size_t szNth, uint8_t u8Exp)
+	{
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			if (GetCell(stBoard, i) != 0)
+			{
+				continue;
+			}
+
+			if (szNth-- == 0)
+			{
+				return SetCell(stBoard, i, u8Exp);
+			}
+		}
+
+		return stBoard;
+	}
+
+	//与Board_Packed::SpawnRandom取随机数的方式相同，同一随机数流在两种表示上生成相同的数字
+	template<typename Rand>
+	static Board SpawnRandom(const Board &stBoard, Rand &rand)
+	{
+		size_t szEmpty = CountEmpty(stBoard);
+		if (szEmpty == 0)
+		{
+			return stBoard;
+		}
+
+		uint32_t u32Rand = rand.Below((uint32_t)szEmpty * 10);
+		return SpawnAt(stBoard, u32Rand / 10, u32Rand % 10 == 0 ? 2 : 1);
+	}
+};
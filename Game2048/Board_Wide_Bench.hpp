@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <chrono>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Board_Wide.hpp"
+#include "Fast_Rand.hpp"
+
+/*
+宽压缩棋盘测试：
+	先在两种表示上用同一随机数流同时进行随机对局，逐步比较结果（数字不超过16384时必须完全一致），并比较速度
+	再从含有大数字的随机棋盘出发测量慢路径的速度，并检查大数字的合并与分数
+
+用法：
+	Game2048 wide [--games N] [--seed S]
+*/
+class Board_Wide_Bench
+{
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		uint64_t u64Games = cmd.GetU64("games", 20000);
+		uint64_t u64Seed = cmd.GetU64("seed", 0);
+
+		//一致性：同一随机数流驱动两种表示
+		uint64_t u64Moves = 0;
+		{
+			Fast_Rand randPacked(u64Seed);
+			Fast_Rand randWide(u64Seed);
+			for (uint64_t g = 0; g < u64Games; ++g)
+			{
+				Board_Packed::Board u64Board = Board_Packed::SpawnRandom(Board_Packed::SpawnRandom(0, randPacked), randPacked);
+				Board_Wide::Board stBoard = Board_Wide::SpawnRandom(Board_Wide::SpawnRandom(Board_Wide::Board{}, randWide), randWide);
+				while (true)
+				{
+					if (Board_Wide::ToPacked(stBoard) != u64Board || Board_Wide::FromPacked(u64Board) != stBoard)
+					{
+						fprintf(stderr, "Error: boards differ in game %" PRIu64 " at move %" PRIu64 "\n", g, u64Moves);
+						return 1;
+					}
+
+					uint8_t u8Mask = Board_Packed::LegalMoves(u64Board);
+					if (Board_Wide::LegalMoves(stBoard) != u8Mask)
+					{
+						fprintf(stderr, "Error: legal moves differ in game %" PRIu64 "\n", g);
+						return 1;
+					}
+					if (u8Mask == 0)
+					{
+						break;
+					}
+
+					uint32_t u32Pick = randPacked.Below(4);
+					randWide.Below(4);
+					while ((u8Mask & (1 << u32Pick)) == 0)
+					{
+						u32Pick = (u32Pick + 1) % 4;
+					}
+
+					uint32_t u32Score = 0;
+					uint64_t u64Score = 0;
+					u64Board = Board_Packed::SpawnRandom(Board_Packed::Move(u64Board, (Board_Packed::Direction)u32Pick, u32Score), randPacked);
+					stBoard = Board_Wide::SpawnRandom(Board_Wide::Move(stBoard, (Board_Packed::Direction)u32Pick, u64Score), randWide);
+					if (u32Score != u64Score)
+					{
+						fprintf(stderr, "Error: scores differ in game %" PRIu64 "\n", g);
+						return 1;
+					}
+					++u64Moves;
+				}
+			}
+		}
+
+		//速度：同样的随机对局分别只在一种表示上进行
+		auto Measure = [&](auto stStart, auto fnMove, auto fnLegal, auto fnSpawn) -> double
+		{
+			Fast_Rand rand(u64Seed);
+			uint64_t u64Count = 0;
+			auto tpBeg = std::chrono::steady_clock::now();
+			for (uint64_t g = 0; g < u64Games; ++g)
+			{
+				auto stBoard = fnSpawn(fnSpawn(stStart, rand), rand);
+				while (true)
+				{
+					uint8_t u8Mask = fnLegal(stBoard);
+					if (u8Mask == 0)
+					{
+						break;
+					}
+
+					uint32_t u32Pick = rand.Below(4);
+					while ((u8Mask & (1 << u32Pick)) == 0)
+					{
+						u32Pick = (u32Pick + 1) % 4;
+					}
+					stBoard = fnSpawn(fnMove(stBoard, (Board_Packed::Direction)u32Pick), rand);
+					++u64Count;
+				}
+			}
+			auto tpEnd = std::chrono::steady_clock::now();
+			return u64Count / std::chrono::duration<double>(tpEnd - tpBeg).count();
+		};
+
+		double dPacked = Measure((Board_Packed::Board)0,
+			[](Board_Packed::Board u64Board, Board_Packed::Direction d) { return Board_Packed::Move(u64Board, d); },
+			[](Board_Packed::Board u64Board) { return Board_Packed::LegalMoves(u64Board); },
+			[](Board_Packed::Board u64Board, Fast_Rand &rand) { return Board_Packed::SpawnRandom(u64Board, rand); });
+		double dWide = Measure(Board_Wide::Board{},
+			[](const Board_Wide::Board &stBoard, Board_Packed::Direction d) { uint64_t u64Unused = 0; return Board_Wide::Move(stBoard, d, u64Unused); },
+			[](const Board_Wide::Board &stBoard) { return Board_Wide::LegalMoves(stBoard); },
+			[](const Board_Wide::Board &stBoard, Fast_Rand &rand) { return Board_Wide::SpawnRandom(stBoard, rand); });
+
+		//大数字：每局开始时在一角放置2^20，该行始终走慢路径
+		Board_Wide::Board stBig = Board_Wide::SetCell(Board_Wide::Board{}, 0, 20);
+		double dWideBig = Measure(stBig,
+			[](const Board_Wide::Board &stBoard, Board_Packed::Direction d) { uint64_t u64Unused = 0; return Board_Wide::Move(stBoard, d, u64Unused); },
+			[](const Board_Wide::Board &stBoard) { return Board_Wide::LegalMoves(stBoard); },
+			[](const Board_Wide::Board &stBoard, Fast_Rand &rand) { return Board_Wide::SpawnRandom(stBoard, rand); });
+
+		//大数字合并：一行2^40 2^40 2^15 2^15向左，得到2^41 2^16，分数2^41+2^16
+		Board_Wide::Board stMerge = Board_Wide::Board{ { 40u | 40u << 8 | 15u << 16 | 15u << 24, 0, 0, 0 } };
+		uint64_t u64MergeScore = 0;
+		Board_Wide::Board stMerged = Board_Wide::Move(stMerge, Board_Packed::Lt, u64MergeScore);
+		if (stMerged.u32Rows[0] != (41u | 16u << 8) || u64MergeScore != ((uint64_t)1 << 41) + ((uint64_t)1 << 16))
+		{
+			fprintf(stderr, "Error: wide merge gave row %08" PRIx32 " score %" PRIu64 "\n", stMerged.u32Rows[0], u64MergeScore);
+			return 1;
+		}
+
+		printf("Games:[%" PRIu64 "] Moves:[%" PRIu64 "] identical on both boards\n", u64Games, u64Moves);
+		printf("packed       %.2fM moves/s\n", dPacked / 1e6);
+		printf("wide         %.2fM moves/s\n", dWide / 1e6);
+		printf("wide (2^20)  %.2fM moves/s\n", dWideBig / 1e6);
+
+		return 0;
+	}
+};
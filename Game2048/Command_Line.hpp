@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string_view>
+
+//简单的命令行解析，格式：程序名 [模式] [--选项 值] [--开关]
+//模式为第一个不以--开头的参数，其后所有不以--开头的参数为位置参数
+//注意：开关类选项无法与后跟的位置参数区分，所以位置参数必须写在所有选项之前
+class Command_Line
+{
+private:
+	int iArgc;
+	char **pArgv;
+
+private:
+	//查找选项所在的下标，不存在返回-1
+	int FindOption(std::string_view svName) const
+	{
+		for (int i = 1; i < iArgc; ++i)
+		{
+			const char *pArg = pArgv[i];
+			if (pArg[0] == '-' && pArg[1] == '-' && svName == (pArg + 2))
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	//获取选项后跟的值，不存在或者后面没有值则返回nullptr
+	const char *GetValue(std::string_view svName) const
+	{
+		int iIndex = FindOption(svName);
+		if (iIndex < 0 || iIndex + 1 >= iArgc)
+		{
+			return nullptr;
+		}
+
+		return pArgv[iIndex + 1];
+	}
+
+public:
+	Command_Line(int _iArgc, char **_pArgv) :
+		iArgc(_iArgc),
+		pArgv(_pArgv)
+	{}
+	~Command_Line(void) = default;
+
+	//获取模式，没有模式则返回空串
+	std::string_view Mode(void) const
+	{
+		return Positional(0);
+	}
+
+	//获取第szIndex个位置参数（模式为第0个），不存在返回空串
+	std::string_view Positional(size_t szIndex) const
+	{
+		for (int i = 1; i < iArgc; ++i)
+		{
+			const char *pArg = pArgv[i];
+			if (pArg[0] == '-' && pArg[1] == '-')//跳过选项与其值
+			{
+				if (i + 1 < iArgc && strncmp(pArgv[i + 1], "--", 2) != 0)
+				{
+					++i;
+				}
+				continue;
+			}
+
+			if (szIndex-- == 0)
+			{
+				return pArg;
+			}
+		}
+
+		return {};
+	}
+
+	//开关类选项，存在即为true
+	bool HasFlag(std::string_view svName) const
+	{
+		return FindOption(svName) >= 0;
+	}
+
+	const char *GetString(std::string_view svName, const char *pDefault = nullptr) const
+	{
+		const char *pValue = GetValue(svName);
+		return pValue != nullptr ? pValue : pDefault;
+	}
+
+	uint64_t GetU64(std::string_view svName, uint64_t u64Default) const
+	{
+		const char *pValue = GetValue(svName);
+		return pValue != nullptr ? strtoull(pValue, nullptr, 0) : u64Default;
+	}
+
+	double GetDouble(std::string_view svName, double dDefault) const
+	{
+		const char *pValue = GetValue(svName);
+		return pValue != nullptr ? strtod(pValue, nullptr) : dDefault;
+	}
+};
@@ -12,6 +12,8 @@
 #include <unistd.h>
 #include <unordered_set>
 
+#include "Game2048_Profile.hpp"
+
 class Console_Input
 {
 public:
@@ -49,10 +51,18 @@ public:
 private:
 	std::unordered_map<Key, Func, KeyHash> mapRegisterTable;
 	termios original;
+	bool bTerminal;//stdin不是终端（管道或文件）时不设置termios，按键直接按字节读取
 
 public:
-	Console_Input(void)
+	Console_Input(void) :
+		original(),
+		bTerminal(isatty(STDIN_FILENO) != 0)
 	{
+		if (!bTerminal)
+		{
+			return;
+		}
+
 		termios raw;
 		tcgetattr(STDIN_FILENO, &raw);
 		original = raw;
@@ -62,7 +72,10 @@ public:
 	~Console_Input(void)
 	{
 		// Restore terminal state.
-		tcsetattr(STDIN_FILENO, TCSAFLUSH, &original);
+		if (bTerminal)
+		{
+			tcsetattr(STDIN_FILENO, TCSAFLUSH, &original);
+		}
 	}
 
 	Console_Input(Console_Input &&) = default;
@@ -75,6 +88,7 @@ public:
 	{
 		Key ret;
 		auto ch = std::getchar();
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_KeyDecode);
 		char tmp;
 		switch (ch)
 		{
@@ -131,6 +145,7 @@ public:
 	std::optional<long> Once(void) const
 	{
 		Key get = GetTranslateKey();
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_Dispatch);
 		auto it = mapRegisterTable.find(get);
 		if (it == mapRegisterTable.end())
 		{
@@ -12,6 +12,8 @@
 #include <limits.h>
 #include <stdint.h>
 
+#include "Game2048_Profile.hpp"
+
 //保证未定义的情况下才定义，且在自己定义的情况下清除定义
 #ifndef EOL
 	#define EOL -1
@@ -133,6 +135,7 @@ public:
 	{
 		Key stKeyRet;
 		int iInput = _getch();//获取第一次输入
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_KeyDecode);//不计等待按键的时间
 		switch (iInput)
 		{
 		case 0x00://转义
@@ -184,6 +187,7 @@ public:
 	std::optional<long> Once(void) const//不保证函数会不会抛出异常
 	{
 		Key stKetGet = GetTranslateKey();
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_Dispatch);
 
 		//获取函数
 		auto it = mapRegisterTable.find(stKetGet);
@@ -0,0 +1,317 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+	#include <filesystem>
+	#include <fstream>
+#endif
+
+/*
+CPU拓扑：发现NUMA节点及其CPU，把工作线程绑定到指定CPU
+	Linux读取/sys/devices/system/node/nodeN/cpulist，只保留本进程允许使用的CPU（sched_getaffinity，taskset与cgroup限制的结果）
+	Windows读取各节点的处理器掩码（仅第0个处理器组）
+	读取失败或不支持时退化为单个节点，包含所有允许的CPU，单路机器上的行为与不绑定时相同
+
+工作线程按节点轮流分配（第i个线程在第i%节点数个节点上），线程数超过CPU数时循环复用
+只读的大表（评估权重等）可以用RunOnNode在绑定到该节点的线程中加载，依靠首次访问分配策略把页面放在本地节点
+*/
+class Cpu_Topology
+{
+public:
+	struct Node
+	{
+		uint32_t u32Id = 0;//系统中的节点号
+		std::vector<uint32_t> vecCpus{};//升序
+	};
+
+	struct Slot
+	{
+		size_t szNode = 0;//vecNodes中的下标（不是节点号）
+		uint32_t u32Cpu = 0;
+	};
+
+private:
+	std::vector<Node> vecNodes;
+	bool bFromSystem;//是否从系统读到了节点信息
+
+	//解析"0-3,8,10-11"格式的CPU列表
+	static bool ParseCpuList(std::string_view svList, std::vector<uint32_t> &vecCpus)
+	{
+		while (!svList.empty() && (svList.back() == '\n' || svList.back() == ' '))
+		{
+			svList.remove_suffix(1);
+		}
+
+		while (!svList.empty())
+		{
+			size_t szComma = svList.find(',');
+			std::string strRange(svList.substr(0, szComma));
+			svList = szComma != std::string_view::npos ? svList.substr(szComma + 1) : std::string_view{};
+
+			char *pEnd = nullptr;
+			unsigned long ulFirst = strtoul(strRange.c_str(), &pEnd, 10);
+			if (pEnd == strRange.c_str())
+			{
+				return false;
+			}
+			unsigned long ulLast = ulFirst;
+			if (*pEnd == '-')
+			{
+				const char *pLast = pEnd + 1;
+				ulLast = strtoul(pLast, &pEnd, 10);
+				if (pEnd == pLast || ulLast < ulFirst)
+				{
+					return false;
+				}
+			}
+			if (*pEnd != '\0')
+			{
+				return false;
+			}
+
+			for (unsigned long i = ulFirst; i <= ulLast; ++i)
+			{
+				vecCpus.push_back((uint32_t)i);
+			}
+		}
+
+		return true;
+	}
+
+	//本进程允许使用的CPU
+	static std::vector<uint32_t> AllowedCpus(void)
+	{
+		std::vector<uint32_t> vecCpus{};
+#if defined(_WIN32)
+		DWORD_PTR dwProcess = 0, dwSystem = 0;
+		if (GetProcessAffinityMask(GetCurrentProcess(), &dwProcess, &dwSystem))
+		{
+			for (uint32_t i = 0; i < sizeof(DWORD_PTR) * 8; ++i)
+			{
+				if (dwProcess & ((DWORD_PTR)1 << i))
+				{
+					vecCpus.push_back(i);
+				}
+			}
+		}
+#elif defined(__linux__)
+		cpu_set_t stSet;
+		CPU_ZERO(&stSet);
+		if (sched_getaffinity(0, sizeof(stSet), &stSet) == 0)
+		{
+			for (uint32_t i = 0; i < CPU_SETSIZE; ++i)
+			{
+				if (CPU_ISSET(i, &stSet))
+				{
+					vecCpus.push_back(i);
+				}
+			}
+		}
+#endif
+		if (vecCpus.empty())
+		{
+			uint32_t u32Count = std::thread::hardware_concurrency();
+			for (uint32_t i = 0; i < (u32Count != 0 ? u32Count : 1); ++i)
+			{
+				vecCpus.push_back(i);
+			}
+		}
+
+		return vecCpus;
+	}
+
+	//读取系统的节点信息，失败返回空
+	static std::vector<Node> SystemNodes(void)
+	{
+		std::vector<Node> vecResult{};
+#if defined(_WIN32)
+		ULONG ulHighest = 0;
+		if (GetNumaHighestNodeNumber(&ulHighest))
+		{
+			for (ULONG i = 0; i <= ulHighest; ++i)
+			{
+				ULONGLONG ullMask = 0;
+				if (!GetNumaNodeProcessorMask((UCHAR)i, &ullMask))
+				{
+					continue;
+				}
+
+				Node stNode{};
+				stNode.u32Id = (uint32_t)i;
+				for (uint32_t c = 0; c < 64; ++c)
+				{
+					if (ullMask & ((ULONGLONG)1 << c))
+					{
+						stNode.vecCpus.push_back(c);
+					}
+				}
+				vecResult.push_back(std::move(stNode));
+			}
+		}
+#elif defined(__linux__)
+		std::error_code ec{};
+		for (const auto &it : std::filesystem::directory_iterator("/sys/devices/system/node", ec))
+		{
+			std::string strName = it.path().filename().string();
+			if (strName.size() <= 4 || strName.compare(0, 4, "node") != 0 ||
+				strName.find_first_not_of("0123456789", 4) != std::string::npos)
+			{
+				continue;
+			}
+
+			std::ifstream ifsList(it.path() / "cpulist");
+			std::string strList{};
+			if (!ifsList || !std::getline(ifsList, strList))
+			{
+				continue;
+			}
+
+			Node stNode{};
+			stNode.u32Id = (uint32_t)strtoul(strName.c_str() + 4, nullptr, 10);
+			if (!ParseCpuList(strList, stNode.vecCpus))
+			{
+				return {};
+			}
+			vecResult.push_back(std::move(stNode));
+		}
+#endif
+		std::sort(vecResult.begin(), vecResult.end(),
+			[](const Node &l, const Node &r) -> bool
+			{
+				return l.u32Id < r.u32Id;
+			});
+		return vecResult;
+	}
+
+public:
+	Cpu_Topology(void) :
+		vecNodes(),
+		bFromSystem(false)
+	{}
+	~Cpu_Topology(void) = default;
+
+	Cpu_Topology(const Cpu_Topology &) = delete;
+	Cpu_Topology &operator=(const Cpu_Topology &) = delete;
+
+	//发现拓扑，总能得到至少一个非空节点
+	void Discover(void)
+	{
+		std::vector<uint32_t> vecAllowed = AllowedCpus();
+
+		vecNodes.clear();
+		for (Node &stNode : SystemNodes())
+		{
+			//去掉不允许使用的CPU，只剩空集的节点（内存节点或被限制的节点）不参与分配
+			std::erase_if(stNode.vecCpus,
+				[&](uint32_t u32Cpu) -> bool
+				{
+					return !std::binary_search(vecAllowed.begin(), vecAllowed.end(), u32Cpu);
+				});
+			if (!stNode.vecCpus.empty())
+			{
+				vecNodes.push_back(std::move(stNode));
+			}
+		}
+
+		bFromSystem = !vecNodes.empty();
+		if (!bFromSystem)
+		{
+			vecNodes.push_back(Node{ 0, std::move(vecAllowed) });
+		}
+	}
+
+	size_t NodeCount(void) const
+	{
+		return vecNodes.size();
+	}
+
+	const Node &GetNode(size_t szNode) const
+	{
+		return vecNodes[szNode];
+	}
+
+	size_t CpuCount(void) const
+	{
+		size_t szCount = 0;
+		for (const Node &stNode : vecNodes)
+		{
+			szCount += stNode.vecCpus.size();
+		}
+		return szCount;
+	}
+
+	//第u32Worker个工作线程的位置：节点之间轮流，节点内按CPU顺序
+	Slot SlotOf(uint32_t u32Worker) const
+	{
+		size_t szNode = u32Worker % vecNodes.size();
+		const std::vector<uint32_t> &vecCpus = vecNodes[szNode].vecCpus;
+		return Slot{ szNode, vecCpus[(u32Worker / vecNodes.size()) % vecCpus.size()] };
+	}
+
+	//把当前线程绑定到一个CPU，不支持或失败返回false（线程照常运行，只是不绑定）
+	static bool PinCurrentThread(uint32_t u32Cpu)
+	{
+#if defined(_WIN32)
+		return u32Cpu < sizeof(DWORD_PTR) * 8 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << u32Cpu) != 0;
+#elif defined(__linux__)
+		cpu_set_t stSet;
+		CPU_ZERO(&stSet);
+		CPU_SET(u32Cpu, &stSet);
+		return pthread_setaffinity_np(pthread_self(), sizeof(stSet), &stSet) == 0;
+#else
+		return false;
+#endif
+	}
+
+	//在绑定到节点第一个CPU的临时线程中执行fn并等待完成，fn中首次写入的内存会分配在该节点上
+	template<typename Func>
+	void RunOnNode(size_t szNode, Func &&fn) const
+	{
+		std::thread thNode([&](void) -> void
+			{
+				PinCurrentThread(vecNodes[szNode].vecCpus.front());
+				fn();
+			});
+		thNode.join();
+	}
+
+	void Print(FILE *pFile) const
+	{
+		fprintf(pFile, "Topology:[%s] Nodes:[%zu] Cpus:[%zu]\n", bFromSystem ? "system" : "fallback", vecNodes.size(), CpuCount());
+		for (const Node &stNode : vecNodes)
+		{
+			fprintf(pFile, "  Node:[%" PRIu32 "] Cpus:[", stNode.u32Id);
+			//连续的CPU合并为区间输出
+			for (size_t i = 0; i < stNode.vecCpus.size();)
+			{
+				size_t j = i;
+				while (j + 1 < stNode.vecCpus.size() && stNode.vecCpus[j + 1] == stNode.vecCpus[j] + 1)
+				{
+					++j;
+				}
+				fprintf(pFile, "%s%" PRIu32, i != 0 ? "," : "", stNode.vecCpus[i]);
+				if (j != i)
+				{
+					fprintf(pFile, "-%" PRIu32, stNode.vecCpus[j]);
+				}
+				i = j + 1;
+			}
+			fprintf(pFile, "]\n");
+		}
+	}
+};
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+//SplitMix64：状态只有8字节的快速随机数，用于AI模拟等不需要与Game2048_Core对局一致的场合
+class Fast_Rand
+{
+private:
+	uint64_t u64State;
+
+public:
+	Fast_Rand(uint64_t u64Seed = 0) :
+		u64State(u64Seed)
+	{}
+	~Fast_Rand(void) = default;
+
+	uint64_t operator()(void)
+	{
+		uint64_t z = (u64State += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	//[0, u32Range)内的均匀整数（取高32bit相乘后取高位，无除法）
+	uint32_t Below(uint32_t u32Range)
+	{
+		return (uint32_t)((((*this)() >> 32) * u32Range) >> 32);
+	}
+
+	uint64_t GetState(void) const
+	{
+		return u64State;
+	}
+
+	void SetState(uint64_t _u64State)
+	{
+		u64State = _u64State;
+	}
+};
@@ -0,0 +1,504 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <vector>
+#include <span>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Mapped_File.hpp"
+#include "Game2048_Core.hpp"
+
+/*
+对局存档格式（小端序，所有结构按8字节对齐，可以直接mmap后按结构访问）：
+
+	[File_Header]                     //文件头，固定64字节
+	[对局数据 0][对局数据 1]...       //按写入顺序连续存放，每段起始8字节对齐
+	[Game_Entry * u64GameCount]       //对局索引，位于u64IndexOffset
+
+每段对局数据（偏移见Game_Entry::u64DataOffset）：
+	[u64 关键帧 * (移动步数 / 关键帧间隔 + 1)]  //第i个关键帧为第i*间隔步之后的压缩棋盘，第0个为初始棋盘
+	[u8 生成流 * 移动步数]                      //每步之后生成的数字，格式同Game2048_Core::GetLastSpawn
+	[u8 移动流 * ((移动步数 + 3) / 4)]          //每步2bit，低位在前
+	[填充到8字节对齐]
+
+读取第g局第k步之后的棋盘：取第k/间隔个关键帧，然后用移动流与生成流向后解码不超过间隔步
+因为生成流记录了随机结果，解码不需要随机数生成器，只需要压缩棋盘的移动表
+*/
+class Game2048_Archive
+{
+public:
+	constexpr const static inline uint32_t u32Magic = 0x52413247;//'G2AR'
+	constexpr const static inline uint16_t u16Version = 1;
+	constexpr const static inline uint32_t u32DefaultKeyframeInterval = 64;
+
+	struct File_Header
+	{
+		uint32_t u32Magic;
+		uint16_t u16Version;
+		uint16_t u16Reserved;
+		uint32_t u32KeyframeInterval;
+		uint32_t u32Reserved;
+		uint64_t u64GameCount;
+		uint64_t u64IndexOffset;
+		uint64_t u64TotalMoves;
+		uint64_t u64Reserved[3];
+	};
+	static_assert(sizeof(File_Header) == 64);
+
+	struct Game_Entry
+	{
+		uint64_t u64DataOffset;
+		uint64_t u64MoveCount;
+		uint64_t u64FinalScore;
+		double dSpawnWeights_2;
+		double dSpawnWeights_4;
+		uint32_t u32Seed;
+		uint32_t u32FinalStatus;
+	};
+	static_assert(sizeof(Game_Entry) == 48);
+
+	//每段对局数据的大小
+	static uint64_t KeyframeCount(uint64_t u64MoveCount, uint32_t u32Interval)
+	{
+		return u64MoveCount / u32Interval + 1;
+	}
+
+	static uint64_t GameDataSize(uint64_t u64MoveCount, uint32_t u32Interval)
+	{
+		uint64_t u64Size = KeyframeCount(u64MoveCount, u32Interval) * sizeof(uint64_t) + u64MoveCount + (u64MoveCount + 3) / 4;
+		return (u64Size + 7) & ~(uint64_t)7;
+	}
+};
+
+//单局数据的构建，由模拟线程各自持有，一局结束后整体交给Writer
+class Game2048_Archive_Game
+{
+	friend class Game2048_Archive_Writer;
+
+private:
+	uint32_t u32KeyframeInterval;
+	Game2048_Archive::Game_Entry stEntry;
+
+	std::vector<uint64_t> vecKeyframes;
+	std::vector<uint8_t> vecSpawns;
+	std::vector<uint8_t> vecMoves;
+
+public:
+	Game2048_Archive_Game(uint32_t _u32KeyframeInterval = Game2048_Archive::u32DefaultKeyframeInterval) :
+		u32KeyframeInterval(_u32KeyframeInterval),
+		stEntry{},
+		vecKeyframes(),
+		vecSpawns(),
+		vecMoves()
+	{}
+	~Game2048_Archive_Game(void) = default;
+
+	//在core.NewGame之后调用
+	void Begin(const Game2048_Core &core)
+	{
+		stEntry = {};
+		stEntry.u32Seed = core.GetSeed();
+		stEntry.dSpawnWeights_2 = core.GetSpawnWeights_2();
+		stEntry.dSpawnWeights_4 = core.GetSpawnWeights_4();
+
+		vecKeyframes.clear();
+		vecSpawns.clear();
+		vecMoves.clear();
+
+		vecKeyframes.push_back(core.GetPackedBoard());
+	}
+
+	//在每次有效的core.ProcessMove之后调用
+	void Push(const Game2048_Core &core, uint8_t u8Direction)
+	{
+		uint64_t u64Index = stEntry.u64MoveCount++;
+
+		if (u64Index % 4 == 0)
+		{
+			vecMoves.push_back(0);
+		}
+		vecMoves.back() |= (u8Direction & 0x03) << ((u64Index % 4) * 2);
+		vecSpawns.push_back(core.GetLastSpawn());
+
+		if (stEntry.u64MoveCount % u32KeyframeInterval == 0)
+		{
+			vecKeyframes.push_back(core.GetPackedBoard());
+		}
+
+		stEntry.u64FinalScore = core.GetScore();
+		stEntry.u32FinalStatus = core.GetStatus();
+	}
+
+	uint64_t GetMoveCount(void) const
+	{
+		return stEntry.u64MoveCount;
+	}
+};
+
+//流式写入，可被多个模拟线程共用（调用方负责加锁），Close时写入索引与文件头
+class Game2048_Archive_Writer
+{
+private:
+	FILE *pFile;
+	Game2048_Archive::File_Header stHeader;
+	std::vector<Game2048_Archive::Game_Entry> vecIndex;
+	uint64_t u64WriteOffset;
+
+private:
+	bool WriteBytes(const void *pData, size_t szSize)
+	{
+		if (szSize != 0 && fwrite(pData, 1, szSize, pFile) != szSize)
+		{
+			return false;
+		}
+
+		u64WriteOffset += szSize;
+		return true;
+	}
+
+public:
+	Game2048_Archive_Writer(void) :
+		pFile(NULL),
+		stHeader{},
+		vecIndex(),
+		u64WriteOffset(0)
+	{}
+	~Game2048_Archive_Writer(void)
+	{
+		Close();
+	}
+
+	Game2048_Archive_Writer(const Game2048_Archive_Writer &) = delete;
+	Game2048_Archive_Writer &operator=(const Game2048_Archive_Writer &) = delete;
+
+	bool Open(const char *pPath, uint32_t u32KeyframeInterval = Game2048_Archive::u32DefaultKeyframeInterval)
+	{
+		Close();
+
+		pFile = fopen(pPath, "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+		setvbuf(pFile, NULL, _IOFBF, 1 << 20);//大缓冲区，减少系统调用
+
+		stHeader = {};
+		stHeader.u32Magic = Game2048_Archive::u32Magic;
+		stHeader.u16Version = Game2048_Archive::u16Version;
+		stHeader.u32KeyframeInterval = u32KeyframeInterval;
+		vecIndex.clear();
+		u64WriteOffset = 0;
+
+		//先写占位的文件头，Close时回写
+		return WriteBytes(&stHeader, sizeof(stHeader));
+	}
+
+	uint32_t GetKeyframeInterval(void) const
+	{
+		return stHeader.u32KeyframeInterval;
+	}
+
+	bool Append(const Game2048_Archive_Game &game)
+	{
+		if (pFile == NULL || game.u32KeyframeInterval != stHeader.u32KeyframeInterval)
+		{
+			return false;
+		}
+
+		Game2048_Archive::Game_Entry stEntry = game.stEntry;
+		stEntry.u64DataOffset = u64WriteOffset;
+
+		const uint64_t u64Zero = 0;
+		uint64_t u64Size = Game2048_Archive::GameDataSize(stEntry.u64MoveCount, stHeader.u32KeyframeInterval);
+		uint64_t u64Used = game.vecKeyframes.size() * sizeof(uint64_t) + game.vecSpawns.size() + game.vecMoves.size();
+
+		bool bRet =
+			WriteBytes(game.vecKeyframes.data(), game.vecKeyframes.size() * sizeof(uint64_t)) &&
+			WriteBytes(game.vecSpawns.data(), game.vecSpawns.size()) &&
+			WriteBytes(game.vecMoves.data(), game.vecMoves.size()) &&
+			WriteBytes(&u64Zero, (size_t)(u64Size - u64Used));//填充对齐
+
+		vecIndex.push_back(stEntry);
+		stHeader.u64TotalMoves += stEntry.u64MoveCount;
+
+		return bRet;
+	}
+
+	bool Close(void)
+	{
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		stHeader.u64GameCount = vecIndex.size();
+		stHeader.u64IndexOffset = u64WriteOffset;
+
+		bool bRet =
+			WriteBytes(vecIndex.data(), vecIndex.size() * sizeof(Game2048_Archive::Game_Entry)) &&
+			fseek(pFile, 0, SEEK_SET) == 0 &&
+			fwrite(&stHeader, sizeof(stHeader), 1, pFile) == 1;
+
+		bRet = fclose(pFile) == 0 && bRet;
+		pFile = NULL;
+
+		return bRet;
+	}
+};
+
+//通过内存映射读取，所有数据直接指向映射区域
+class Game2048_Archive_Reader
+{
+public:
+	using Board = Board_Packed::Board;
+
+	//某一局的零拷贝视图
+	struct Game_View
+	{
+		const Game2048_Archive::Game_Entry *pEntry;
+		std::span<const uint64_t> spKeyframes;
+		std::span<const uint8_t> spSpawns;
+		std::span<const uint8_t> spMoves;
+		uint32_t u32KeyframeInterval;
+
+		uint8_t GetMove(uint64_t u64Index) const
+		{
+			return (spMoves[u64Index / 4] >> ((u64Index % 4) * 2)) & 0x03;
+		}
+
+		//对棋盘应用第u64Index步（移动与随后的生成）
+		Board ApplyStep(Board u64Board, uint64_t u64Index) const
+		{
+			u64Board = Board_Packed::Move(u64Board, (Board_Packed::Direction)GetMove(u64Index));
+
+			uint8_t u8Spawn = spSpawns[u64Index];
+			if (u8Spawn != Game2048_Core::u8NoSpawn)
+			{
+				u64Board = Board_Packed::SetCell(u64Board, u8Spawn & 0x0F, (u8Spawn & 0x10) ? 2 : 1);
+			}
+
+			return u64Board;
+		}
+
+		//第u64Step步之后的棋盘（0为初始棋盘），从最近的关键帧开始解码
+		Board GetBoard(uint64_t u64Step) const
+		{
+			uint64_t u64Keyframe = u64Step / u32KeyframeInterval;
+			Board u64Board = spKeyframes[u64Keyframe];
+
+			for (uint64_t i = u64Keyframe * u32KeyframeInterval; i < u64Step; ++i)
+			{
+				u64Board = ApplyStep(u64Board, i);
+			}
+
+			return u64Board;
+		}
+
+		//按顺序遍历每一个棋盘（包含初始棋盘），回调形式：void(uint64_t u64Step, Board u64Board)
+		template<typename Func>
+		void ForEachBoard(Func &&fFunc) const
+		{
+			Board u64Board = spKeyframes[0];
+			fFunc((uint64_t)0, u64Board);
+
+			for (uint64_t i = 0; i < pEntry->u64MoveCount; ++i)
+			{
+				u64Board = ApplyStep(u64Board, i);
+				fFunc(i + 1, u64Board);
+			}
+		}
+	};
+
+private:
+	Mapped_File mapFile;
+	const Game2048_Archive::File_Header *pHeader;
+	const Game2048_Archive::Game_Entry *pIndex;
+
+public:
+	Game2048_Archive_Reader(void) :
+		mapFile(),
+		pHeader(nullptr),
+		pIndex(nullptr)
+	{}
+	~Game2048_Archive_Reader(void) = default;
+
+	bool Open(const char *pPath)
+	{
+		pHeader = nullptr;
+		pIndex = nullptr;
+
+		if (!mapFile.Open(pPath))
+		{
+			return false;
+		}
+
+		pHeader = mapFile.At<Game2048_Archive::File_Header>(0);
+		if (pHeader == nullptr ||
+			pHeader->u32Magic != Game2048_Archive::u32Magic ||
+			pHeader->u16Version != Game2048_Archive::u16Version ||
+			pHeader->u32KeyframeInterval == 0)
+		{
+			pHeader = nullptr;
+			return false;
+		}
+
+		pIndex = mapFile.At<Game2048_Archive::Game_Entry>(pHeader->u64IndexOffset, (size_t)pHeader->u64GameCount);
+		if (pIndex == nullptr)
+		{
+			pHeader = nullptr;
+			return false;
+		}
+
+		//每局数据必须8字节对齐且完整地在文件中，GetGame之后不再检查
+		for (uint64_t i = 0; i < pHeader->u64GameCount; ++i)
+		{
+			const Game2048_Archive::Game_Entry &stEntry = pIndex[i];
+			if (stEntry.u64DataOffset % sizeof(uint64_t) != 0 ||
+				stEntry.u64MoveCount > mapFile.Size() ||//每步至少占1字节，同时避免下面计算大小时溢出
+				mapFile.At<uint8_t>(stEntry.u64DataOffset, (size_t)Game2048_Archive::GameDataSize(stEntry.u64MoveCount, pHeader->u32KeyframeInterval)) == nullptr)
+			{
+				pHeader = nullptr;
+				pIndex = nullptr;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	uint64_t GameCount(void) const
+	{
+		return pHeader != nullptr ? pHeader->u64GameCount : 0;
+	}
+
+	uint64_t TotalMoves(void) const
+	{
+		return pHeader != nullptr ? pHeader->u64TotalMoves : 0;
+	}
+
+	uint32_t KeyframeInterval(void) const
+	{
+		return pHeader->u32KeyframeInterval;
+	}
+
+	Game_View GetGame(uint64_t u64Game) const
+	{
+		const Game2048_Archive::Game_Entry &stEntry = pIndex[u64Game];
+		uint32_t u32Interval = pHeader->u32KeyframeInterval;
+
+		uint64_t u64KeyframeCount = Game2048_Archive::KeyframeCount(stEntry.u64MoveCount, u32Interval);
+		const uint8_t *pData = mapFile.Data() + stEntry.u64DataOffset;
+		const uint64_t *pKeyframes = (const uint64_t *)pData;
+		const uint8_t *pSpawns = pData + u64KeyframeCount * sizeof(uint64_t);
+		const uint8_t *pMoves = pSpawns + stEntry.u64MoveCount;
+
+		return Game_View{
+			&stEntry,
+			{ pKeyframes, (size_t)u64KeyframeCount },
+			{ pSpawns, (size_t)stEntry.u64MoveCount },
+			{ pMoves, (size_t)((stEntry.u64MoveCount + 3) / 4) },
+			u32Interval,
+		};
+	}
+};
+
+/*
+存档查看与校验
+
+用法：
+	Game2048 archive <文件> [--game g] [--move k] [--verify]
+	--game/--move 打印第g局第k步之后的棋盘
+	--verify      用游戏核心按种子与移动流重新模拟所有对局，逐个棋盘与存档解码结果比对
+*/
+class Game2048_Archive_Tool
+{
+private:
+	static void PrintBoard(Board_Packed::Board u64Board)
+	{
+		for (size_t szY = 0; szY < Board_Packed::szHeight; ++szY)
+		{
+			for (size_t szX = 0; szX < Board_Packed::szWidth; ++szX)
+			{
+				printf("%6" PRIu64, Board_Packed::ExponentToValue(Board_Packed::GetCell(u64Board, szY * Board_Packed::szWidth + szX)));
+			}
+			printf("\n");
+		}
+	}
+
+	static bool VerifyGame(const Game2048_Archive_Reader::Game_View &view)
+	{
+		Game2048_Core core(view.pEntry->u32Seed, view.pEntry->dSpawnWeights_2, view.pEntry->dSpawnWeights_4);
+		core.NewGame();
+
+		bool bMatch = true;
+		view.ForEachBoard([&](uint64_t u64Step, Board_Packed::Board u64Board) -> void
+			{
+				if (u64Step != 0)
+				{
+					core.ProcessMove((Game2048_Core::Direction)view.GetMove(u64Step - 1));
+				}
+
+				bMatch = bMatch && core.GetPackedBoard() == u64Board && view.GetBoard(u64Step) == u64Board;
+			});
+
+		return bMatch && core.GetScore() == view.pEntry->u64FinalScore;
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		auto svPath = cmd.Positional(1);
+
+		Game2048_Archive_Reader reader{};
+		if (svPath.empty())
+		{
+			fprintf(stderr, "Usage: Game2048 archive <file> [--game g] [--move k] [--verify]\n");
+			return 1;
+		}
+		if (!reader.Open(svPath.data()))
+		{
+			fprintf(stderr, "Error: cannot open archive [%s] or it is corrupted\n", svPath.data());
+			return 1;
+		}
+
+		printf("Games:[%" PRIu64 "] Moves:[%" PRIu64 "] KeyframeInterval:[%" PRIu32 "]\n",
+			reader.GameCount(), reader.TotalMoves(), reader.KeyframeInterval());
+
+		if (cmd.HasFlag("game"))
+		{
+			uint64_t u64Game = cmd.GetU64("game", 0);
+			if (u64Game >= reader.GameCount())
+			{
+				fprintf(stderr, "Error: game index out of range\n");
+				return 1;
+			}
+
+			auto view = reader.GetGame(u64Game);
+			uint64_t u64Move = cmd.GetU64("move", view.pEntry->u64MoveCount);
+			u64Move = u64Move < view.pEntry->u64MoveCount ? u64Move : view.pEntry->u64MoveCount;
+
+			printf("Game:[%" PRIu64 "] Seed:[%" PRIu32 "] Moves:[%" PRIu64 "] Score:[%" PRIu64 "] Status:[%" PRIu32 "]\n",
+				u64Game, view.pEntry->u32Seed, view.pEntry->u64MoveCount, view.pEntry->u64FinalScore, view.pEntry->u32FinalStatus);
+			printf("Board after move [%" PRIu64 "]:\n", u64Move);
+			PrintBoard(view.GetBoard(u64Move));
+		}
+
+		if (cmd.HasFlag("verify"))
+		{
+			uint64_t u64Mismatch = 0;
+			for (uint64_t i = 0; i < reader.GameCount(); ++i)
+			{
+				u64Mismatch += !VerifyGame(reader.GetGame(i));
+			}
+
+			printf("Verify: %" PRIu64 " mismatched games\n", u64Mismatch);
+			return u64Mismatch == 0 ? 0 : 1;
+		}
+
+		return 0;
+	}
+};
@@ -0,0 +1,284 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include "Command_Line.hpp"
+#include "Console_Output.hpp"
+#include "Board_Wide.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_Policy_Options.hpp"
+#include "Game2048_Render.hpp"
+#include "Game2048_Profile.hpp"
+
+/*
+AI自动游戏（演示）：主线程用策略驱动Game2048_Core，每步只把最新的棋盘发布到快照，
+绘制线程按固定帧率采样最新快照并绘制，绘制与终端输出的耗时不会拖慢模拟，
+模拟比帧率快时中间的棋盘直接跳过，只绘制采样时的最新一帧
+
+快照为单写者顺序锁（seqlock）：写者先把序号改为奇数，写入数据，再把序号改为下一个偶数；
+读者读取前后两次序号相同且为偶数则数据完整，否则重试，写者永远不会等待读者
+
+用法：
+	Game2048 autoplay [--policy 名称] [--weights 文件 | --heuristic 文件] [--book 文件] [--depth D] [--rollouts R] [--seed S] [--games N] [--speed 每秒步数] [--fps 帧率]
+	--speed 模拟速度，默认0为不限速
+	--fps   绘制帧率，默认60，0为不绘制（只在结束时输出统计，可以对比绘制对模拟速度的影响）
+	策略默认expectimax
+*/
+class Game2048_AutoPlay
+{
+private:
+	struct Frame
+	{
+		Board_Wide::Board stBoard{};
+		uint64_t u64Score = 0;
+		uint64_t u64Moves = 0;//所有对局的总步数
+		uint64_t u64Game = 0;//当前对局序号（从0开始）
+		uint64_t u64Status = 0;
+	};
+
+	class Snapshot
+	{
+	private:
+		constexpr const static inline size_t szDataCount = 6;
+
+		std::atomic<uint64_t> u64Seq;
+		std::atomic<uint64_t> u64Data[szDataCount];//数据本身也用relaxed原子读写，读写重叠时不构成数据竞争
+
+	public:
+		Snapshot(void) :
+			u64Seq(0),
+			u64Data{}
+		{}
+		~Snapshot(void) = default;
+
+		Snapshot(const Snapshot &) = delete;
+		Snapshot &operator=(const Snapshot &) = delete;
+
+		//只能由一个线程调用
+		void Publish(const Frame &stFrame)
+		{
+			uint64_t u64Cur = u64Seq.load(std::memory_order_relaxed);
+			u64Seq.store(u64Cur + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			u64Data[0].store((uint64_t)stFrame.stBoard.u32Rows[0] | (uint64_t)stFrame.stBoard.u32Rows[1] << 32, std::memory_order_relaxed);
+			u64Data[1].store((uint64_t)stFrame.stBoard.u32Rows[2] | (uint64_t)stFrame.stBoard.u32Rows[3] << 32, std::memory_order_relaxed);
+			u64Data[2].store(stFrame.u64Score, std::memory_order_relaxed);
+			u64Data[3].store(stFrame.u64Moves, std::memory_order_relaxed);
+			u64Data[4].store(stFrame.u64Game, std::memory_order_relaxed);
+			u64Data[5].store(stFrame.u64Status, std::memory_order_relaxed);
+
+			u64Seq.store(u64Cur + 2, std::memory_order_release);
+		}
+
+		//读取最新的完整帧，返回其序号（序号不变说明没有新数据）
+		uint64_t Read(Frame &stFrame) const
+		{
+			while (true)
+			{
+				uint64_t u64Beg = u64Seq.load(std::memory_order_acquire);
+				if ((u64Beg & 1) != 0)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				uint64_t u64Rows01 = u64Data[0].load(std::memory_order_relaxed);
+				uint64_t u64Rows23 = u64Data[1].load(std::memory_order_relaxed);
+				stFrame.u64Score = u64Data[2].load(std::memory_order_relaxed);
+				stFrame.u64Moves = u64Data[3].load(std::memory_order_relaxed);
+				stFrame.u64Game = u64Data[4].load(std::memory_order_relaxed);
+				stFrame.u64Status = u64Data[5].load(std::memory_order_relaxed);
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (u64Seq.load(std::memory_order_relaxed) != u64Beg)
+				{
+					continue;
+				}
+
+				stFrame.stBoard = Board_Wide::Board{ { (uint32_t)u64Rows01, (uint32_t)(u64Rows01 >> 32), (uint32_t)u64Rows23, (uint32_t)(u64Rows23 >> 32) } };
+				return u64Beg;
+			}
+		}
+	};
+
+	struct Shared
+	{
+		Snapshot snapshot{};
+		std::atomic<bool> bDone{ false };
+		uint64_t u64Games = 1;
+		double dFps = 60.0;
+	};
+
+	static void DrawFrame(Console_Output &co, const Shared &stShared, const Frame &stFrame, double dMovesPerSecond)
+	{
+		Game2048_Render::PrintGameBoard(co, stFrame.stBoard, stFrame.u64Score);
+		co.ClearLine();
+		printf("Game:[%" PRIu64 "/%" PRIu64 "] Moves:[%" PRIu64 "] Sim:[%.0f moves/s] Render:[%.0f fps]",
+			stFrame.u64Game + 1, stShared.u64Games, stFrame.u64Moves, dMovesPerSecond, stShared.dFps);
+		co.NextLine();
+
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_Flush);
+		fflush(stdout);
+	}
+
+	//绘制线程：按帧率采样，快照没有变化则不重绘，结束时绘制最后一帧
+	static void RenderThread(Console_Output &co, Shared &stShared)
+	{
+		auto durFrame = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / stShared.dFps));
+		auto tpNext = std::chrono::steady_clock::now();
+
+		uint64_t u64LastSeq = UINT64_MAX;
+		uint64_t u64RateMoves = 0;
+		auto tpRate = tpNext;
+		double dMovesPerSecond = 0;
+
+		Frame stFrame{};
+		while (true)
+		{
+			bool bDone = stShared.bDone.load(std::memory_order_acquire);//先读结束标志，保证最后一帧是结束后的快照
+			uint64_t u64Seq = stShared.snapshot.Read(stFrame);
+
+			//每秒更新一次模拟速度
+			auto tpNow = std::chrono::steady_clock::now();
+			double dElapsed = std::chrono::duration<double>(tpNow - tpRate).count();
+			if (dElapsed >= 1.0)
+			{
+				dMovesPerSecond = (stFrame.u64Moves - u64RateMoves) / dElapsed;
+				u64RateMoves = stFrame.u64Moves;
+				tpRate = tpNow;
+			}
+
+			if (u64Seq != u64LastSeq)
+			{
+				DrawFrame(co, stShared, stFrame, dMovesPerSecond);
+				u64LastSeq = u64Seq;
+			}
+
+			if (bDone)
+			{
+				break;
+			}
+
+			//落后超过一帧时不补帧
+			tpNext += durFrame;
+			tpNext = tpNext > tpNow ? tpNext : tpNow;
+			std::this_thread::sleep_until(tpNext);
+		}
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		Shared stShared{};
+		stShared.u64Games = cmd.GetU64("games", 1);
+		stShared.dFps = cmd.GetDouble("fps", 60.0);
+		double dMovesPerSecond = cmd.GetDouble("speed", 0.0);
+		uint32_t u32SeedBase = cmd.HasFlag("seed") ? (uint32_t)cmd.GetU64("seed", 0) : std::random_device{}();
+		const char *pPolicy = cmd.GetString("policy", "expectimax");
+
+		Game2048_Policy_Options policyOptions{};
+		if (!policyOptions.Load(cmd, true))
+		{
+			return 1;
+		}
+		const Game2048_Policy::Context &stContext = policyOptions.stContext;
+
+		auto upPolicy = Game2048_Policy::Create(pPolicy, u32SeedBase, stContext);
+		if (upPolicy == nullptr)
+		{
+			fprintf(stderr, "Error: unknown policy [%s]\n", pPolicy);
+			return 1;
+		}
+		if (stShared.u64Games == 0)
+		{
+			fprintf(stderr, "Error: nothing to play\n");
+			return 1;
+		}
+
+		bool bRender = stShared.dFps > 0;
+		Console_Output co{};
+		std::thread threadRender{};
+		if (bRender)
+		{
+			co.HideCursor();
+			co.ClearScreen();
+			threadRender = std::thread(RenderThread, std::ref(co), std::ref(stShared));
+		}
+
+		//每步的间隔，0为不限速
+		auto durStep = dMovesPerSecond > 0
+			? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / dMovesPerSecond))
+			: std::chrono::steady_clock::duration::zero();
+
+		Game2048_Core core(u32SeedBase);
+		Frame stFrame{};
+		uint64_t u64ScoreSum = 0;
+		uint64_t u64Wins = 0;
+		uint64_t u64MaxTile = 0;
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		auto tpNext = tpBeg;
+		for (uint64_t g = 0; g < stShared.u64Games; ++g)
+		{
+			core.NewGame((uint32_t)(u32SeedBase + g));
+			stFrame.u64Game = g;
+
+			while (true)
+			{
+				stFrame.stBoard = core.GetWideBoard();
+				stFrame.u64Score = core.GetScore();
+				stFrame.u64Status = core.GetStatus();
+				if (bRender)
+				{
+					stShared.snapshot.Publish(stFrame);
+				}
+
+				if (core.GetStatus() != Game2048_Core::InGame)
+				{
+					break;
+				}
+
+				if (!core.ProcessMove((Game2048_Core::Direction)upPolicy->Choose(core.GetPackedBoard())))
+				{
+					break;//策略必须给出有效方向，这里仅作保护
+				}
+				++stFrame.u64Moves;
+
+				if (durStep != std::chrono::steady_clock::duration::zero())
+				{
+					tpNext += durStep;
+					std::this_thread::sleep_until(tpNext);
+				}
+			}
+
+			u64ScoreSum += core.GetScore();
+			u64Wins += core.GetStatus() == Game2048_Core::WinGame;
+			uint64_t u64Tile = Board_Wide::ExponentToValue(Board_Wide::MaxExponent(core.GetWideBoard()));
+			u64MaxTile = u64Tile > u64MaxTile ? u64Tile : u64MaxTile;
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		if (bRender)
+		{
+			stShared.bDone.store(true, std::memory_order_release);
+			threadRender.join();
+			co.ShowCursor();
+		}
+
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		printf("Policy:[%s] Games:[%" PRIu64 "] Wins:[%" PRIu64 "] AvgScore:[%.1f] MaxTile:[%" PRIu64 "]\n",
+			upPolicy->Name(), stShared.u64Games, u64Wins, (double)u64ScoreSum / stShared.u64Games, u64MaxTile);
+		printf("Moves:[%" PRIu64 "] Time:[%.3f s] %.0f moves/s\n",
+			stFrame.u64Moves, dSeconds, dSeconds > 0 ? stFrame.u64Moves / dSeconds : 0.0);
+
+		return 0;
+	}
+};
@@ -0,0 +1,157 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+
+#include "Board_Packed.hpp"
+#include "Mapped_File.hpp"
+
+/*
+开局库：自我对局中频繁出现的局面（移动前的棋盘，对称规范形式）预先用较深的expectimax搜索，保存最佳移动与期望值，
+策略先查库，命中则直接使用库中的移动，不再搜索（见Game2048_Policy.hpp中的Policy_Book，构建见Game2048_BookBuilder.hpp）
+
+文件格式（小端序）：
+	[u32 魔数 'G2BK'][u16 版本][u16 保留][u64 条目数]
+	[条目 * 条目数：u64 规范棋盘][f32 期望值][u32 出现次数][u8 规范棋盘上的最佳方向][u8 搜索深度][u8 保留 * 6]
+条目按棋盘严格升序排列（打开时检查，方向越界或顺序错误的文件视为损坏），查找为二分；整个文件直接mmap只读使用，查找不加锁，多个线程可以共用一个对象
+构建时写到临时文件再改名替换，已打开的旧文件映射不受影响，读者永远不会看到写了一半的文件
+*/
+class Game2048_Book
+{
+public:
+	using Board = Board_Packed::Board;
+	using Direction = Board_Packed::Direction;
+
+	constexpr const static inline uint32_t u32Magic = 0x4B423247;//'G2BK'
+	constexpr const static inline uint16_t u16Version = 1;
+
+	struct File_Header
+	{
+		uint32_t u32Magic;
+		uint16_t u16Version;
+		uint16_t u16Reserved;
+		uint64_t u64EntryCount;
+	};
+
+	struct Entry
+	{
+		Board u64Board;
+		float fValue;
+		uint32_t u32Visits;
+		uint8_t u8Move;
+		uint8_t u8Depth;
+		uint8_t u8Reserved[6];
+	};
+
+	static_assert(sizeof(File_Header) == 16 && sizeof(Entry) == 24);
+
+private:
+	Mapped_File mapFile;
+	const File_Header *pHeader;
+	const Entry *pEntries;
+
+public:
+	Game2048_Book(void) :
+		mapFile(),
+		pHeader(nullptr),
+		pEntries(nullptr)
+	{}
+	~Game2048_Book(void) = default;
+
+	Game2048_Book(const Game2048_Book &) = delete;
+	Game2048_Book &operator=(const Game2048_Book &) = delete;
+
+	bool Open(const char *pPath)
+	{
+		Close();
+		if (!mapFile.Open(pPath))
+		{
+			return false;
+		}
+
+		pHeader = mapFile.At<File_Header>(0);
+		if (pHeader == nullptr ||
+			pHeader->u32Magic != u32Magic ||
+			pHeader->u16Version != u16Version)
+		{
+			Close();
+			return false;
+		}
+
+		pEntries = mapFile.At<Entry>(sizeof(File_Header), pHeader->u64EntryCount);
+		if (pEntries == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		//打开时检查一遍：方向必须有效（查库结果直接交给Board_Packed::Move），棋盘必须严格升序（否则二分查找会漏掉条目）
+		for (uint64_t i = 0; i < pHeader->u64EntryCount; ++i)
+		{
+			if (pEntries[i].u8Move >= Board_Packed::Enum_End ||
+				(i != 0 && pEntries[i - 1].u64Board >= pEntries[i].u64Board))
+			{
+				Close();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Close(void)
+	{
+		mapFile.Close();
+		pHeader = nullptr;
+		pEntries = nullptr;
+	}
+
+	bool IsOpen(void) const
+	{
+		return pHeader != nullptr;
+	}
+
+	uint64_t Count(void) const
+	{
+		return pHeader != nullptr ? pHeader->u64EntryCount : 0;
+	}
+
+	const Entry *Entries(void) const
+	{
+		return pEntries;
+	}
+
+	//按规范棋盘查找，不存在返回nullptr
+	const Entry *Find(Board u64Canonical) const
+	{
+		const Entry *pEnd = pEntries + Count();
+		const Entry *pFind = std::lower_bound(pEntries, pEnd, u64Canonical,
+			[](const Entry &stEntry, Board u64Key) -> bool
+			{
+				return stEntry.u64Board < u64Key;
+			});
+
+		return pFind != pEnd && pFind->u64Board == u64Canonical ? pFind : nullptr;
+	}
+
+	//按任意朝向的棋盘查找，命中时返回该朝向上的最佳方向与期望值
+	bool Lookup(Board u64Board, Direction &dMove, float &fValue) const
+	{
+		if (pHeader == nullptr)
+		{
+			return false;
+		}
+
+		uint8_t u8Sym = 0;
+		const Entry *pEntry = Find(Board_Packed::Canonical(u64Board, u8Sym));
+		if (pEntry == nullptr)
+		{
+			return false;
+		}
+
+		dMove = Board_Packed::UnmapDirection((Direction)pEntry->u8Move, u8Sym);
+		fValue = pEntry->fValue;
+		return true;
+	}
+};
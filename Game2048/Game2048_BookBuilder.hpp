@@ -0,0 +1,401 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_Policy_Options.hpp"
+#include "Game2048_Book.hpp"
+
+/*
+开局库构建（文件格式见Game2048_Book.hpp）：
+	1.统计：多线程用指定策略自我对局，只走每局的前M步，按规范形式统计每个移动前局面的出现次数
+	2.搜索：出现次数达到K的局面（库中没有，或库中的搜索深度更浅）按局面分给多个线程，用更深的expectimax求最佳方向与期望值
+	3.合并：与已有的库合并（已有条目累加出现次数，重新搜索的条目替换），排序后写到临时文件再改名替换
+构建可以增量进行：换一个种子再次构建同一个文件，会在已有的库上继续累积，已经搜索过的局面不会重复搜索
+（未达到K次的局面不写入库，其次数不跨构建累积）
+
+用法：
+	Game2048 book build 文件 [--games N] [--moves M] [--min-visits K] [--threads T] [--seed S] [--policy P] [--weights 文件 | --heuristic 文件] [--depth D] [--search-depth SD]
+	Game2048 book info 文件 [--board 十六进制棋盘] [--top N]
+	--moves 默认16，--min-visits 默认8，--policy 统计时使用的策略，默认expectimax，--search-depth 默认为--depth加1
+	使用：selfplay与autoplay的--book 文件
+*/
+class Game2048_BookBuilder
+{
+public:
+	using Board = Board_Packed::Board;
+
+	struct Options
+	{
+		const char *pOutput = nullptr;
+		uint64_t u64Games = 1000;
+		uint32_t u32Moves = 16;
+		uint32_t u32MinVisits = 8;
+		uint32_t u32Threads = 0;//0为硬件线程数
+		uint32_t u32SeedBase = 0;
+		const char *pPolicy = "expectimax";
+		uint32_t u32SearchDepth = 3;
+		Game2048_Policy::Context stContext{};//统计与搜索共用评估函数
+	};
+
+private:
+	using Visit_Map = std::unordered_map<Board, uint32_t>;
+
+	const Options &stOptions;
+	uint32_t u32Threads;
+	std::unordered_map<Board, Game2048_Book::Entry> mapEntries;//已有的库与本次的结果
+
+private:
+	template<typename Func>
+	void RunThreads(Func &&fnWorker)
+	{
+		std::vector<std::thread> vecThreads;
+		for (uint32_t i = 0; i < u32Threads; ++i)
+		{
+			vecThreads.emplace_back(fnWorker, i);
+		}
+		for (auto &it : vecThreads)
+		{
+			it.join();
+		}
+	}
+
+	void LoadExisting(void)
+	{
+		Game2048_Book book{};
+		if (!book.Open(stOptions.pOutput))
+		{
+			return;//不存在则从头构建
+		}
+
+		for (uint64_t i = 0; i < book.Count(); ++i)
+		{
+			const Game2048_Book::Entry &stEntry = book.Entries()[i];
+			mapEntries[stEntry.u64Board] = stEntry;
+		}
+	}
+
+	//对局前M步，统计规范局面的出现次数
+	Visit_Map Collect(void)
+	{
+		std::atomic<uint64_t> u64NextGame{ 0 };
+		std::mutex mtxMerge;
+		Visit_Map mapVisits{};
+
+		RunThreads([&](uint32_t u32WorkerIndex) -> void
+		{
+			Game2048_Policy::Context stContext = stOptions.stContext;
+			stContext.pBook = nullptr;//统计反映策略本身的选择
+			Game2048_Core core(0);
+			Visit_Map mapLocal{};
+
+			while (true)
+			{
+				uint64_t u64Game = u64NextGame.fetch_add(1, std::memory_order_relaxed);
+				if (u64Game >= stOptions.u64Games)
+				{
+					break;
+				}
+
+				//策略按局创建，统计结果与线程数无关
+				uint64_t u64Seed = (uint64_t)stOptions.u32SeedBase + u64Game;
+				auto upPolicy = Game2048_Policy::Create(stOptions.pPolicy, u64Seed * 0x9E3779B97F4A7C15ULL, stContext);
+				core.NewGame((uint32_t)u64Seed);
+				for (uint32_t m = 0; m < stOptions.u32Moves && core.GetStatus() == Game2048_Core::InGame; ++m)
+				{
+					Board u64Board = core.GetPackedBoard();
+					++mapLocal[Board_Packed::Canonical(u64Board)];
+
+					if (!core.ProcessMove((Game2048_Core::Direction)upPolicy->Choose(u64Board)))
+					{
+						break;//策略必须给出有效方向，这里仅作保护
+					}
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mtxMerge);
+			for (const auto &[u64Board, u32Count] : mapLocal)
+			{
+				mapVisits[u64Board] += u32Count;
+			}
+		});
+
+		return mapVisits;
+	}
+
+	//搜索所有待定局面，结果写入vecTodo
+	void Search(std::vector<Game2048_Book::Entry> &vecTodo)
+	{
+		std::atomic<size_t> szNext{ 0 };
+		const Game2048_Evaluator &evaluator = stOptions.stContext.pEvaluator != nullptr ? *stOptions.stContext.pEvaluator : Evaluator_Empty::Instance();
+
+		RunThreads([&](uint32_t) -> void
+		{
+			Policy_Expectimax policy(evaluator, stOptions.u32SearchDepth, stOptions.stContext.bCanonical);
+			while (true)
+			{
+				size_t i = szNext.fetch_add(1, std::memory_order_relaxed);
+				if (i >= vecTodo.size())
+				{
+					break;
+				}
+
+				Game2048_Book::Entry &stEntry = vecTodo[i];
+				float fValue = 0.0f;
+				stEntry.u8Move = (uint8_t)policy.Choose(stEntry.u64Board, fValue);
+				stEntry.fValue = fValue;
+			}
+		});
+	}
+
+	bool Write(void) const
+	{
+		std::vector<Game2048_Book::Entry> vecSorted{};
+		vecSorted.reserve(mapEntries.size());
+		for (const auto &it : mapEntries)
+		{
+			vecSorted.push_back(it.second);
+		}
+		std::sort(vecSorted.begin(), vecSorted.end(),
+			[](const Game2048_Book::Entry &l, const Game2048_Book::Entry &r) -> bool
+			{
+				return l.u64Board < r.u64Board;
+			});
+
+		Game2048_Book::File_Header stHeader{};
+		stHeader.u32Magic = Game2048_Book::u32Magic;
+		stHeader.u16Version = Game2048_Book::u16Version;
+		stHeader.u64EntryCount = vecSorted.size();
+
+		std::string strTemp = std::string(stOptions.pOutput) + ".tmp";
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		bool bRet =
+			fwrite(&stHeader, sizeof(stHeader), 1, pFile) == 1 &&
+			fwrite(vecSorted.data(), sizeof(Game2048_Book::Entry), vecSorted.size(), pFile) == vecSorted.size();
+		bRet = fclose(pFile) == 0 && bRet;
+
+		std::error_code ec{};
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, stOptions.pOutput, ec);
+		}
+		if (!bRet || ec)
+		{
+			std::filesystem::remove(strTemp, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+public:
+	Game2048_BookBuilder(const Options &_stOptions) :
+		stOptions(_stOptions),
+		u32Threads(_stOptions.u32Threads != 0 ? _stOptions.u32Threads : std::thread::hardware_concurrency()),
+		mapEntries()
+	{
+		u32Threads = u32Threads != 0 ? u32Threads : 1;
+	}
+	~Game2048_BookBuilder(void) = default;
+
+	Game2048_BookBuilder(const Game2048_BookBuilder &) = delete;
+	Game2048_BookBuilder &operator=(const Game2048_BookBuilder &) = delete;
+
+	bool Build(void)
+	{
+		LoadExisting();
+		size_t szExisting = mapEntries.size();
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		Visit_Map mapVisits = Collect();
+		auto tpCollect = std::chrono::steady_clock::now();
+
+		//已有条目累加次数，新达到阈值或深度不够的局面重新搜索
+		std::vector<Game2048_Book::Entry> vecTodo{};
+		uint64_t u64Visits = 0;
+		for (const auto &[u64Board, u32Count] : mapVisits)
+		{
+			u64Visits += u32Count;
+
+			auto it = mapEntries.find(u64Board);
+			uint32_t u32Total = u32Count + (it != mapEntries.end() ? it->second.u32Visits : 0);
+			if (it != mapEntries.end())
+			{
+				it->second.u32Visits = u32Total;
+				if (it->second.u8Depth >= stOptions.u32SearchDepth)
+				{
+					continue;
+				}
+			}
+			else if (u32Total < stOptions.u32MinVisits)
+			{
+				continue;
+			}
+
+			Game2048_Book::Entry stEntry{};
+			stEntry.u64Board = u64Board;
+			stEntry.u32Visits = u32Total;
+			stEntry.u8Depth = (uint8_t)stOptions.u32SearchDepth;
+			vecTodo.push_back(stEntry);
+		}
+
+		Search(vecTodo);
+		auto tpSearch = std::chrono::steady_clock::now();
+
+		for (const auto &it : vecTodo)
+		{
+			mapEntries[it.u64Board] = it;
+		}
+
+		printf("Collected:[%" PRIu64 " games, %" PRIu64 " positions, %zu distinct] %.3f s\n",
+			stOptions.u64Games, u64Visits, mapVisits.size(), std::chrono::duration<double>(tpCollect - tpBeg).count());
+		printf("Searched:[%zu at depth %" PRIu32 "] %.3f s\n",
+			vecTodo.size(), stOptions.u32SearchDepth, std::chrono::duration<double>(tpSearch - tpCollect).count());
+		printf("Entries:[%zu, %zu before]\n", mapEntries.size(), szExisting);
+
+		return Write();
+	}
+
+private:
+	static int Info(const Command_Line &cmd, const char *pPath)
+	{
+		Game2048_Book book{};
+		if (!book.Open(pPath))
+		{
+			fprintf(stderr, "Error: cannot open book [%s]\n", pPath);
+			return 1;
+		}
+
+		const char *pBoard = cmd.GetString("board");
+		if (pBoard != nullptr)
+		{
+			Board u64Board = strtoull(pBoard, nullptr, 16);
+			Game2048_Book::Direction dMove;
+			float fValue;
+			if (!book.Lookup(u64Board, dMove, fValue))
+			{
+				printf("Board:[%016" PRIx64 "] not in book\n", u64Board);
+				return 0;
+			}
+
+			constexpr const static char *pNames[] = { "Up", "Down", "Left", "Right" };
+			printf("Board:[%016" PRIx64 "] Move:[%s] Value:[%.1f]\n", u64Board, pNames[dMove], fValue);
+			return 0;
+		}
+
+		uint64_t u64Visits = 0;
+		for (uint64_t i = 0; i < book.Count(); ++i)
+		{
+			u64Visits += book.Entries()[i].u32Visits;
+		}
+		printf("Entries:[%" PRIu64 "] Visits:[%" PRIu64 "] Size:[%" PRIu64 " B]\n",
+			book.Count(), u64Visits, (uint64_t)(sizeof(Game2048_Book::File_Header) + book.Count() * sizeof(Game2048_Book::Entry)));
+
+		//出现最多的局面
+		std::vector<const Game2048_Book::Entry *> vecTop{};
+		for (uint64_t i = 0; i < book.Count(); ++i)
+		{
+			vecTop.push_back(&book.Entries()[i]);
+		}
+		size_t szTop = (size_t)cmd.GetU64("top", 10);
+		szTop = szTop < vecTop.size() ? szTop : vecTop.size();
+		std::partial_sort(vecTop.begin(), vecTop.begin() + szTop, vecTop.end(),
+			[](const Game2048_Book::Entry *l, const Game2048_Book::Entry *r) -> bool
+			{
+				return l->u32Visits > r->u32Visits;
+			});
+		for (size_t i = 0; i < szTop; ++i)
+		{
+			printf("  %016" PRIx64 " Visits:[%" PRIu32 "] Move:[%u] Value:[%.1f] Depth:[%u]\n",
+				vecTop[i]->u64Board, vecTop[i]->u32Visits, (unsigned)vecTop[i]->u8Move, vecTop[i]->fValue, (unsigned)vecTop[i]->u8Depth);
+		}
+
+		return 0;
+	}
+
+	static int Build(const Command_Line &cmd, const char *pPath)
+	{
+		Options stOptions{};
+		stOptions.pOutput = pPath;
+		stOptions.u64Games = cmd.GetU64("games", stOptions.u64Games);
+		stOptions.u32Moves = (uint32_t)cmd.GetU64("moves", stOptions.u32Moves);
+		stOptions.u32MinVisits = (uint32_t)cmd.GetU64("min-visits", stOptions.u32MinVisits);
+		stOptions.u32Threads = (uint32_t)cmd.GetU64("threads", stOptions.u32Threads);
+		stOptions.u32SeedBase = cmd.HasFlag("seed") ? (uint32_t)cmd.GetU64("seed", 0) : std::random_device{}();//默认每次不同，增量构建覆盖更多对局
+		stOptions.pPolicy = cmd.GetString("policy", stOptions.pPolicy);
+
+		Game2048_Policy_Options policyOptions{};
+		if (!policyOptions.Load(cmd, false))
+		{
+			return 1;
+		}
+		stOptions.stContext = policyOptions.stContext;
+
+		stOptions.u32SearchDepth = (uint32_t)cmd.GetU64("search-depth", stOptions.stContext.u32Depth + 1);
+
+		if (Game2048_Policy::Create(stOptions.pPolicy, 0, stOptions.stContext) == nullptr)
+		{
+			fprintf(stderr, "Error: unknown policy [%s]\n", stOptions.pPolicy);
+			return 1;
+		}
+		if (stOptions.u32SearchDepth == 0 || stOptions.u32SearchDepth > UINT8_MAX)
+		{
+			fprintf(stderr, "Error: --search-depth must be in [1, 255]\n");
+			return 1;
+		}
+
+		Game2048_BookBuilder builder(stOptions);
+		if (!builder.Build())
+		{
+			fprintf(stderr, "Error: cannot write book [%s]\n", pPath);
+			return 1;
+		}
+
+		return 0;
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		std::string_view svCommand = cmd.Positional(1);
+		std::string_view svPath = cmd.Positional(2);
+		if (svPath.empty())
+		{
+			fprintf(stderr, "Usage: Game2048 book build|info <file> [options]\n");
+			return 1;
+		}
+
+		if (svCommand == "build")
+		{
+			return Build(cmd, svPath.data());
+		}
+		else if (svCommand == "info")
+		{
+			return Info(cmd, svPath.data());
+		}
+
+		fprintf(stderr, "Error: unknown book command [%.*s]\n", (int)svCommand.size(), svCommand.data());
+		return 1;
+	}
+};
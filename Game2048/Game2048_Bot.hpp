@@ -0,0 +1,372 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <io.h>
+	#include <fcntl.h>
+#elif defined(__linux__)
+	#include <errno.h>
+	#include <unistd.h>
+#endif
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Game2048_Core.hpp"
+
+/*
+外部程序对接的管道协议：通过stdin/stdout交换状态与移动，不经过终端，对局规则与随机数与交互模式完全相同（Game2048_Core）
+
+文本协议（默认），每个请求一行：
+	由w/s/a/d组成的一串  依次执行这些移动（一行可以批量多步），对局结束后剩余的移动被忽略
+	n [种子]             新开一局，不给种子则从当前随机数流派生
+	空行                 只查询状态
+	q                    退出
+	每个请求回复一行："棋盘 分数 状态 有效步数\n"，棋盘为16位十六进制压缩棋盘（见Board_Packed.hpp），
+	状态0进行中 1胜利 2失败，有效步数为本次请求中真正改变了棋盘的移动数，格式错误回复"E 原因\n"（该请求中的移动一步都不执行）
+
+二进制协议（--binary），请求以1字节开头：
+	0x00~0x7F  后跟该数量的移动字节（0上 1下 2左 3右），数量为0即查询
+	0x80       新开一局，种子从当前随机数流派生
+	0x81       新开一局，后跟4字节小端种子
+	0xFF       退出
+	每个请求回复16字节：棋盘u64、分数u32、状态u8、有效步数u8、保留u16，全部小端
+
+启动时先输出一次初始状态。输入缓冲中的完整请求全部处理完才一次性写出回复，
+一问一答的程序每步只有一次读写系统调用，流水线发送的程序可以成批处理
+*/
+class Game2048_Bot
+{
+private:
+	constexpr const static inline size_t szReadSize = 64 * 1024;
+
+	Game2048_Core core;
+	bool bBinary;
+
+	std::vector<uint8_t> vecIn;
+	size_t szInBeg;//未处理请求的开头
+	size_t szInEnd;//已读入数据的结尾
+	std::vector<uint8_t> vecOut;
+
+	uint64_t u64Requests;
+	uint64_t u64Moves;
+
+private:
+	static long ReadInput(uint8_t *pBuffer, size_t szSize)
+	{
+#if defined(_WIN32)
+		return _read(0, pBuffer, (unsigned)szSize);
+#else
+		while (true)
+		{
+			ssize_t sszRead = read(STDIN_FILENO, pBuffer, szSize);
+			if (sszRead < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return (long)sszRead;
+		}
+#endif
+	}
+
+	bool FlushOutput(void)
+	{
+		size_t szPos = 0;
+		while (szPos < vecOut.size())
+		{
+#if defined(_WIN32)
+			long lWrite = _write(1, vecOut.data() + szPos, (unsigned)(vecOut.size() - szPos));
+#else
+			long lWrite = (long)write(STDOUT_FILENO, vecOut.data() + szPos, vecOut.size() - szPos);
+			if (lWrite < 0 && errno == EINTR)
+			{
+				continue;
+			}
+#endif
+			if (lWrite <= 0)
+			{
+				return false;
+			}
+			szPos += (size_t)lWrite;
+		}
+
+		vecOut.clear();
+		return true;
+	}
+
+	//执行一步，返回是否改变了棋盘
+	bool Move(uint8_t u8Dir)
+	{
+		if (core.GetStatus() != Game2048_Core::InGame)
+		{
+			return false;
+		}
+
+		++u64Moves;
+		return core.ProcessMove((Game2048_Core::Direction)u8Dir);
+	}
+
+	void AppendState(uint32_t u32Applied)
+	{
+		uint64_t u64Score = core.GetScore();
+		if (!bBinary)
+		{
+			char cLine[80];
+			int iLen = snprintf(cLine, sizeof(cLine), "%016" PRIx64 " %" PRIu64 " %u %" PRIu32 "\n",
+				core.GetPackedBoard(), u64Score, (unsigned)core.GetStatus(), u32Applied);
+			vecOut.insert(vecOut.end(), cLine, cLine + iLen);
+			return;
+		}
+
+		uint8_t u8Reply[16] = {};
+		uint64_t u64Board = core.GetPackedBoard();
+		uint32_t u32Score = u64Score < UINT32_MAX ? (uint32_t)u64Score : UINT32_MAX;
+		for (size_t i = 0; i < 8; ++i)
+		{
+			u8Reply[i] = (uint8_t)(u64Board >> (i * 8));
+		}
+		for (size_t i = 0; i < 4; ++i)
+		{
+			u8Reply[8 + i] = (uint8_t)(u32Score >> (i * 8));
+		}
+		u8Reply[12] = (uint8_t)core.GetStatus();
+		u8Reply[13] = (uint8_t)(u32Applied < 0xFF ? u32Applied : 0xFF);
+		vecOut.insert(vecOut.end(), u8Reply, u8Reply + sizeof(u8Reply));
+	}
+
+	void AppendError(const char *pReason)
+	{
+		vecOut.push_back('E');
+		vecOut.push_back(' ');
+		vecOut.insert(vecOut.end(), pReason, pReason + strlen(pReason));
+		vecOut.push_back('\n');
+	}
+
+	//处理一个文本请求（不含换行），返回false代表退出
+	bool ProcessLine(const char *pLine, size_t szLen)
+	{
+		if (szLen != 0 && pLine[szLen - 1] == '\r')
+		{
+			--szLen;
+		}
+
+		if (szLen != 0 && pLine[0] == 'q')
+		{
+			return false;
+		}
+
+		if (szLen != 0 && pLine[0] == 'n')
+		{
+			uint32_t u32Seed;
+			if (szLen > 1)
+			{
+				char cSeed[32] = {};
+				memcpy(cSeed, pLine + 1, szLen - 1 < sizeof(cSeed) - 1 ? szLen - 1 : sizeof(cSeed) - 1);
+				char *pEnd = nullptr;
+				u32Seed = (uint32_t)strtoull(cSeed, &pEnd, 10);
+				if (pEnd == cSeed)
+				{
+					AppendError("bad seed");
+					return true;
+				}
+			}
+			else
+			{
+				u32Seed = core.DeriveNextSeed();
+			}
+
+			core.NewGame(u32Seed);
+			AppendState(0);
+			return true;
+		}
+
+		//先检查整行，含有非法字符时不执行任何移动，否则回复中缺少已经改变的状态
+		for (size_t i = 0; i < szLen; ++i)
+		{
+			if (pLine[i] != 'w' && pLine[i] != 's' && pLine[i] != 'a' && pLine[i] != 'd')
+			{
+				AppendError("bad move");
+				return true;
+			}
+		}
+
+		uint32_t u32Applied = 0;
+		for (size_t i = 0; i < szLen; ++i)
+		{
+			char c = pLine[i];
+			u32Applied += Move(c == 'w' ? Game2048_Core::Up : c == 's' ? Game2048_Core::Dn : c == 'a' ? Game2048_Core::Lt : Game2048_Core::Rt);
+		}
+
+		AppendState(u32Applied);
+		return true;
+	}
+
+	//处理输入缓冲中所有完整的请求，返回false代表退出
+	bool ProcessInput(void)
+	{
+		while (szInBeg < szInEnd)
+		{
+			const uint8_t *pBeg = vecIn.data() + szInBeg;
+			size_t szAvail = szInEnd - szInBeg;
+
+			if (!bBinary)
+			{
+				const uint8_t *pEnd = (const uint8_t *)memchr(pBeg, '\n', szAvail);
+				if (pEnd == nullptr)
+				{
+					return true;
+				}
+
+				szInBeg += (size_t)(pEnd - pBeg) + 1;
+				++u64Requests;
+				if (!ProcessLine((const char *)pBeg, (size_t)(pEnd - pBeg)))
+				{
+					return false;
+				}
+				continue;
+			}
+
+			uint8_t u8Head = pBeg[0];
+			if (u8Head == 0xFF)
+			{
+				return false;
+			}
+
+			size_t szNeed = u8Head < 0x80 ? 1 + (size_t)u8Head : u8Head == 0x81 ? 5 : 1;
+			if (szAvail < szNeed)
+			{
+				return true;
+			}
+			szInBeg += szNeed;
+			++u64Requests;
+
+			if (u8Head < 0x80)
+			{
+				uint32_t u32Applied = 0;
+				for (size_t i = 1; i < szNeed; ++i)
+				{
+					u32Applied += Move(pBeg[i] & 0x03);
+				}
+				AppendState(u32Applied);
+			}
+			else
+			{
+				uint32_t u32Seed = u8Head == 0x81 ?
+					(uint32_t)pBeg[1] | (uint32_t)pBeg[2] << 8 | (uint32_t)pBeg[3] << 16 | (uint32_t)pBeg[4] << 24 :
+					core.DeriveNextSeed();
+				core.NewGame(u32Seed);
+				AppendState(0);
+			}
+		}
+
+		return true;
+	}
+
+public:
+	Game2048_Bot(uint32_t u32Seed, bool _bBinary) :
+		core(u32Seed),
+		bBinary(_bBinary),
+		vecIn(),
+		szInBeg(0),
+		szInEnd(0),
+		vecOut(),
+		u64Requests(0),
+		u64Moves(0)
+	{}
+	~Game2048_Bot(void) = default;
+
+	Game2048_Bot(const Game2048_Bot &) = delete;
+	Game2048_Bot &operator=(const Game2048_Bot &) = delete;
+
+	//运行直到收到退出请求或stdin结束，输出失败返回false
+	bool Run(void)
+	{
+#if defined(_WIN32)
+		_setmode(0, _O_BINARY);
+		_setmode(1, _O_BINARY);
+#endif
+		core.NewGame();
+		AppendState(0);
+
+		vecIn.resize(szReadSize);
+		while (true)
+		{
+			//阻塞读之前先把已有回复写出去
+			if (!FlushOutput())
+			{
+				return false;
+			}
+
+			//把未处理完的半个请求挪到开头
+			memmove(vecIn.data(), vecIn.data() + szInBeg, szInEnd - szInBeg);
+			szInEnd -= szInBeg;
+			szInBeg = 0;
+			if (vecIn.size() - szInEnd < szReadSize / 2)
+			{
+				vecIn.resize(vecIn.size() * 2);
+			}
+
+			long lRead = ReadInput(vecIn.data() + szInEnd, vecIn.size() - szInEnd);
+			if (lRead <= 0)
+			{
+				break;
+			}
+			szInEnd += (size_t)lRead;
+
+			if (!ProcessInput())
+			{
+				break;
+			}
+		}
+
+		return FlushOutput();
+	}
+
+	uint64_t GetRequests(void) const
+	{
+		return u64Requests;
+	}
+
+	uint64_t GetMoves(void) const
+	{
+		return u64Moves;
+	}
+
+	/*
+	用法：
+		Game2048 bot [--seed S] [--binary] [--stats]
+		--stats 结束时向stderr输出请求数、移动数与每秒移动数
+	*/
+	static int Main(const Command_Line &cmd)
+	{
+		uint32_t u32Seed = cmd.HasFlag("seed") ? (uint32_t)cmd.GetU64("seed", 0) : std::random_device{}();
+		Game2048_Bot bot(u32Seed, cmd.HasFlag("binary"));
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		bool bRet = bot.Run();
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		if (cmd.HasFlag("stats"))
+		{
+			double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+			fprintf(stderr, "Requests:[%" PRIu64 "] Moves:[%" PRIu64 "] Time:[%.3f s] %.0f moves/s\n",
+				bot.GetRequests(), bot.GetMoves(), dSeconds, bot.GetMoves() / dSeconds);
+		}
+
+		if (!bRet)
+		{
+			fprintf(stderr, "Error: failed to write to stdout\n");
+			return 1;
+		}
+
+		return 0;
+	}
+};
@@ -0,0 +1,781 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <random>
+#include <span>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <assert.h>
+
+#include "Game2048_Record.hpp"
+#include "Board_Packed.hpp"
+#include "Board_Wide.hpp"
+#include "Game2048_Profile.hpp"
+
+/*
+游戏规则:
+
+在4*4的界面内，一开始会出现两个数字，这两个数字有可能是2或者4，
+任何时候，数字2出现的概率相对4较大，也就是90%出现2，10%出现4。
+
+玩家每次可以选择上下左右其中一个方向去滑动，
+如果当前方向无法滑动，则什么也不做，
+否则滑动所有的数字方块都会往滑动的方向靠拢，
+相同数字的方块在靠拢时会相加合并成一个，不同的数字则靠拢堆放，
+每次移动方向上的每一排，已经合并过的数字不会与下一个合并，
+即便下一个数字的值可以继续合并，也只会进行堆放，
+移动或合并后，在剩余的空白处生成一个数字2或者4。
+注解：
+	一排2 2 2 2合并之后是4 4，而不是8
+	一排2 2 4  合并之后是4 4，而不是8
+	也就是已经合并过的数字不会参与下次合并
+
+一旦获得任意一个相加后的值为2048的数字，则游戏成功。
+如果没有任何空白的移动空间，且没有任何相邻的数可以合并，则游戏失败。
+
+分数计算：
+每次产生合并时，合并的值增加到分数上
+比如一次移动中，2与2合并得到4，当前加4分
+或者一次移动中，4与4合并得到8，2与2合并得到4，当前加12分
+*/
+
+/*
+游戏状态核心：只包含棋盘、分数、状态与随机数，不涉及任何输入输出，
+可以被控制台界面、回放、批量模拟等任意前端驱动。
+
+随机数只使用mt19937_64的原始输出（标准保证跨平台结果一致），
+不使用标准库分布（各标准库实现不同），所以相同种子在任何平台上都会产生完全相同的对局
+
+同时维护棋盘的64bit Zobrist哈希：每个(格子, 指数)对应一个固定随机数，哈希为所有非空格子对应随机数的异或，
+在移动、合并与生成时增量更新，置换表与重复局面检测可以直接使用而无须重新计算
+
+规则（目标数字、生成的两种数字、每步生成个数、胜利后是否继续）是编译期模板参数，见Game2048_Rules，
+每种规则各自实例化为完整内联的引擎，不在热路径上做任何运行期判断，Game2048_Core即经典规则
+方向、状态等与规则无关的定义放在Game2048_Core_Base，所有规则共用
+*/
+class Game2048_Core_Base
+{
+public:
+	using Direction_Raw = uint8_t;
+	enum Direction : Direction_Raw
+	{
+		Up = 0,
+		Dn,
+		Lt,
+		Rt,
+		Enum_End,
+	};
+
+	enum GameStatus
+	{
+		InGame = 0,
+		WinGame,
+		LostGame,
+	};
+
+	struct Pos
+	{
+	public:
+		int64_t i64X, i64Y;
+
+	public:
+		Pos operator+(const Pos &_Right) const
+		{
+			return {
+				i64X + _Right.i64X,
+				i64Y + _Right.i64Y,
+			};
+		}
+
+		Pos operator-(const Pos &_Right) const
+		{
+			return {
+				i64X - _Right.i64X,
+				i64Y - _Right.i64Y,
+			};
+		}
+
+		Pos &operator+=(const Pos &_Right)
+		{
+			i64X += _Right.i64X;
+			i64Y += _Right.i64Y;
+
+			return *this;
+		}
+
+		Pos &operator-=(const Pos &_Right)
+		{
+			i64X -= _Right.i64X;
+			i64Y -= _Right.i64Y;
+
+			return *this;
+		}
+
+		bool operator==(const Pos &_Right) const
+		{
+			return i64X == _Right.i64X && i64Y == _Right.i64Y;
+		}
+
+		bool operator!=(const Pos &_Right) const
+		{
+			return i64X != _Right.i64X || i64Y != _Right.i64Y;
+		}
+	};
+
+public:
+	constexpr const static inline size_t szWidth = 4;
+	constexpr const static inline size_t szHeight = 4;
+	constexpr const static inline size_t szTotalSize = szWidth * szHeight;
+	constexpr const static inline uint8_t u8NoSpawn = 0xFF;
+};
+
+/*
+规则参数：
+	u64WinTile         合并出该数字即胜利，0为没有目标（一直玩到失败）
+	u64SpawnLow/High   生成的两种数字，按构造时的生成权重选择（默认90%/10%），某个权重为0即只生成另一种
+	szSpawnPerMove     每次有效移动后生成的个数（空格子不够时生成到满为止）
+	szInitialSpawns    开局生成的个数
+	bContinueAfterWin  为true时到达目标后状态仍为进行中并继续生成，HasReachedWin记录是否到达过
+也可以自行定义带有这些成员的结构体作为规则
+
+录像与快照不记录规则，只能由相同规则的引擎回放与恢复
+
+bProfile为true时ProcessMove与Spawn带有耗时统计（见Game2048_Profile.hpp，运行时开启），只用于交互模式（Game2048_Core_Interactive），
+自我对弈、训练等实例化不编译这两个计时点，热路径上没有任何开销
+*/
+template<uint64_t _u64WinTile, uint64_t _u64SpawnLow, uint64_t _u64SpawnHigh, size_t _szSpawnPerMove, bool _bContinueAfterWin>
+struct Game2048_Rules
+{
+	constexpr const static inline uint64_t u64WinTile = _u64WinTile;
+	constexpr const static inline uint64_t u64SpawnLow = _u64SpawnLow;
+	constexpr const static inline uint64_t u64SpawnHigh = _u64SpawnHigh;
+	constexpr const static inline size_t szSpawnPerMove = _szSpawnPerMove;
+	constexpr const static inline size_t szInitialSpawns = 2;
+	constexpr const static inline bool bContinueAfterWin = _bContinueAfterWin;
+};
+
+using Game2048_Rules_Classic = Game2048_Rules<2048, 2, 4, 1, false>;
+using Game2048_Rules_Endless = Game2048_Rules<2048, 2, 4, 1, true>;
+
+template<typename Rules, bool bProfile = false>
+class Game2048_Core_Basic : public Game2048_Core_Base
+{
+	static_assert(std::has_single_bit(Rules::u64SpawnLow) && Rules::u64SpawnLow >= 2, "spawn value must be a power of 2");
+	static_assert(std::has_single_bit(Rules::u64SpawnHigh) && Rules::u64SpawnHigh >= 2, "spawn value must be a power of 2");
+	static_assert(Rules::u64WinTile == 0 || std::has_single_bit(Rules::u64WinTile), "win tile must be 0 or a power of 2");
+	static_assert(Rules::szSpawnPerMove >= 1 && Rules::szInitialSpawns <= szTotalSize, "bad spawn count");
+
+public:
+	using Rules_Type = Rules;
+
+private:
+	uint64_t u64Tile[szHeight][szWidth];//空格子为0
+
+	size_t szEmptyCount;//空余的的格子数
+	uint64_t u64GameScore;//游戏分数
+	GameStatus enGameStatus;//游戏状态
+	bool bReachedWin;//是否合并出过目标数字（胜利后继续的规则下状态不会变为WinGame）
+
+	uint32_t u32GameSeed;//当前对局的种子
+	double dSpawnWeights_2;//数字2的生成权重
+	double dSpawnWeights_4;//数字4的生成权重
+	std::mt19937_64 randGen;//梅森旋转算法随机数生成器
+	uint64_t u64RandDraws;//播种后取过的随机数个数，种子加上它即为完整的随机数状态
+
+	uint8_t u8LastSpawn;//最近一次生成的位置与数值，见GetLastSpawn
+
+	Game2048_Record *pRecord;//录像（可为空）
+
+	uint64_t u64ZobristKey;//当前棋盘的Zobrist哈希
+
+private:
+	//====================Zobrist哈希====================
+	constexpr const static inline size_t szZobristExponents = 64;//u64的格子最大为2^63
+
+	//编译期用SplitMix64生成，跨平台一致，空格子（指数0）为0
+	constexpr const static inline auto u64ZobristTable = []() constexpr
+	{
+		std::array<std::array<uint64_t, szZobristExponents>, szTotalSize> arrTable{};
+		uint64_t u64State = 0x2048204820482048ULL;
+		for (auto &arrCell : arrTable)
+		{
+			for (size_t e = 1; e < szZobristExponents; ++e)
+			{
+				uint64_t z = (u64State += 0x9E3779B97F4A7C15ULL);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				arrCell[e] = z ^ (z >> 31);
+			}
+		}
+		return arrTable;
+	}();
+
+	static uint64_t ZobristOf(size_t szIndex, uint64_t u64Value)
+	{
+		return u64Value != 0 ? u64ZobristTable[szIndex][std::countr_zero(u64Value)] : 0;
+	}
+
+	static size_t IndexOf(const Pos &posTarget)
+	{
+		return (size_t)(posTarget.i64Y * szWidth + posTarget.i64X);
+	}
+
+	//完整重新计算，只在恢复状态时使用
+	uint64_t ComputeZobristKey(void) const
+	{
+		uint64_t u64Key = 0;
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			u64Key ^= ZobristOf(i, ((const uint64_t *)u64Tile)[i]);
+		}
+
+		return u64Key;
+	}
+
+private:
+	//====================辅助函数====================
+	std::span<uint64_t, szTotalSize> TileFlatView(void)//提供二维数组的一维平坦视图
+	{
+		return std::span<uint64_t, szTotalSize>{ (uint64_t *)u64Tile, szTotalSize };
+	}
+
+	uint64_t NextRand(void)
+	{
+		++u64RandDraws;
+		return randGen();
+	}
+
+	uint64_t &GetTile(const Pos &posTarget)
+	{
+		return u64Tile[posTarget.i64Y][posTarget.i64X];
+	}
+
+	uint64_t GenerateRandTileVal(void)
+	{
+		constexpr const static uint64_t u64PossibleValues[] = { Rules::u64SpawnLow, Rules::u64SpawnHigh };
+
+		//取高53bit转换为[0,1)的浮点数，按权重比例选择
+		double dRand = (double)(NextRand() >> 11) * 0x1.0p-53;
+		size_t szIndex = dRand * (dSpawnWeights_2 + dSpawnWeights_4) < dSpawnWeights_2 ? 0 : 1;
+
+		return u64PossibleValues[szIndex];
+	}
+
+	bool IsTilePosValid(const Pos &p) const
+	{
+		return p.i64X >= 0 && p.i64X < (int64_t)szWidth &&
+			   p.i64Y >= 0 && p.i64Y < (int64_t)szHeight;
+	}
+
+	//====================刷出数字====================
+	bool HasPossibleMerges(void) const
+	{
+		//查找所有格子的相邻，如果没有任何相邻且数值相同的格子，那么游戏失败
+		for (size_t Y = 0; Y < szHeight; ++Y)
+		{
+			for (size_t X = 0; X < szWidth; ++X)
+			{
+				uint64_t u64Cur = u64Tile[Y][X];
+
+				//向右向下检测（避免越界）
+				if ((X + 1 < szWidth && u64Tile[Y][X + 1] == u64Cur) ||
+					(Y + 1 < szHeight && u64Tile[Y + 1][X] == u64Cur))
+				{
+					return true;//有可合并的
+				}
+			}
+		}
+
+		//所有检测都没返回，那么不存在可合并情况，游戏失败
+		return false;
+	}
+
+	bool SpawnRandomTile(void)
+	{
+		Game2048_Profile::Scope_If<bProfile> profile(Game2048_Profile::Stage_Spawn);
+
+		if (szEmptyCount == 0)
+		{
+			return false;
+		}
+
+		//还有空间，递减空格子数
+		--szEmptyCount;
+
+		//在剩余格子中均匀生成，范围[0, szEmptyCount]，因为取到端点，所以前面先递减
+		//格子数最多16，64bit取模的偏差可以忽略
+		auto targetPos = NextRand() % (szEmptyCount + 1);
+
+		//遍历并找到第targetPos个格子
+		for (auto &it : TileFlatView())
+		{
+			if (it != 0)//不是空格，继续
+			{
+				continue;
+			}
+
+			if (targetPos != 0)//是空格，当前是目标位置吗
+			{
+				--targetPos;//不是就递减并继续
+				continue;
+			}
+
+			//是目标位置，生成并退出
+			it = GenerateRandTileVal();
+			u8LastSpawn = (uint8_t)(&it - (uint64_t *)u64Tile) | (it != Rules::u64SpawnLow ? 0x10 : 0x00);
+			u64ZobristKey ^= ZobristOf(&it - (uint64_t *)u64Tile, it);
+			break;
+		}
+
+		//检测必须在生成后，因为前面先进行递减然后才进行生成
+		if (szEmptyCount == 0)//只要没有剩余空间，就进行合并检测
+		{
+			if (!HasPossibleMerges())//没有任何一个方向可以合并
+			{
+				enGameStatus = LostGame;//设置输
+			}
+		}
+
+		return true;
+	}
+
+	//====================移动合并====================
+	bool MoveOrMergeTile(const Pos &posTarget, Pos &posLast, Direction dMove)
+	{
+		if (GetTile(posTarget) == 0)//直到非0
+		{
+			return false;
+		}
+
+		//反向移动量数组
+		constexpr const static Pos arrReverseMoveDeltas[Direction::Enum_End] =
+		{
+			{ 0, 1 },//[Up] -> Dn
+			{ 0,-1 },//[Dn] -> Up
+
+			{ 1, 0 },//[Lt] -> Rt
+			{-1, 0 },//[Rt] -> Lt
+		};
+
+		auto &valTarget = GetTile(posTarget);
+		auto &valLast = GetTile(posLast);
+
+		//原始位置的数字无论如何都会离开
+		u64ZobristKey ^= ZobristOf(IndexOf(posTarget), valTarget);
+
+		if (valLast == 0)//空位置，移动
+		{
+			valLast = valTarget;//移动后可能下次会触发合并，无须更新posLast
+			u64ZobristKey ^= ZobristOf(IndexOf(posLast), valLast);
+		}
+		else if (valLast == valTarget)//值相等，合并
+		{
+			u64ZobristKey ^= ZobristOf(IndexOf(posLast), valLast);
+			valLast += valTarget;
+			u64ZobristKey ^= ZobristOf(IndexOf(posLast), valLast);
+			posLast += arrReverseMoveDeltas[dMove];//合并后下次不能判断当前位置，移动到新位置
+
+			++szEmptyCount;//合并后更新空位计数
+			u64GameScore += valLast;//合并后更新分数
+
+			//如果任何一个合并获得目标数字（经典规则为2048）
+			if constexpr (Rules::u64WinTile != 0)
+			{
+				if (valLast == Rules::u64WinTile)
+				{
+					bReachedWin = true;
+					if constexpr (!Rules::bContinueAfterWin)
+					{
+						enGameStatus = WinGame;//则设置游戏状态为赢
+					}
+				}
+			}
+		}
+		else//值不相等，也不为空，移动到旁边堆放
+		{
+			//当前位置无法使用，移动到新位置
+			posLast += arrReverseMoveDeltas[dMove];
+			if (posLast == posTarget)//如果新位置和当前位置相同则跳过
+			{
+				u64ZobristKey ^= ZobristOf(IndexOf(posTarget), valTarget);//没有离开，撤销前面的更新
+				return false;
+			}
+
+			//进行移动
+			auto &valNewLast = GetTile(posLast);
+			assert(valNewLast == 0);//这里必然是0
+			valNewLast = valTarget;//移动后下次可能触发合并，无须更新posLast
+			u64ZobristKey ^= ZobristOf(IndexOf(posLast), valNewLast);
+		}
+
+		//清空原始位置
+		valTarget = 0;
+
+		return true;
+	}
+
+public:
+	//构造
+	Game2048_Core_Basic(uint32_t u32Seed = std::random_device{}(), double _dSpawnWeights_2 = 0.9, double _dSpawnWeights_4 = 0.1) :
+		u64Tile{},
+
+		szEmptyCount(szTotalSize),
+		u64GameScore(0),
+		enGameStatus(),
+		bReachedWin(false),
+
+		u32GameSeed(u32Seed),
+		dSpawnWeights_2(_dSpawnWeights_2),
+		dSpawnWeights_4(_dSpawnWeights_4),
+		randGen(u32Seed),
+		u64RandDraws(0),
+
+		u8LastSpawn(u8NoSpawn),
+
+		pRecord(nullptr),
+
+		u64ZobristKey(0)
+	{}
+	~Game2048_Core_Basic(void) = default;
+
+	Game2048_Core_Basic(const Game2048_Core_Basic &) = default;
+	Game2048_Core_Basic(Game2048_Core_Basic &&) = default;
+	Game2048_Core_Basic &operator=(const Game2048_Core_Basic &) = default;
+	Game2048_Core_Basic &operator=(Game2048_Core_Basic &&) = default;
+
+	//====================对局控制====================
+	//用当前种子重新开始一局（相同种子与相同移动序列必然得到相同对局）
+	void NewGame(void)
+	{
+		//重新播种，使每一局都只由种子决定
+		randGen.seed(u32GameSeed);
+		u64RandDraws = 0;
+
+		//清除格子数据
+		std::ranges::fill(TileFlatView(), (uint64_t)0);
+		//设置空余的格子数为最大值
+		szEmptyCount = szTotalSize;
+		//空棋盘的哈希为0
+		u64ZobristKey = 0;
+		//设置游戏分数为0
+		u64GameScore = 0;
+		//设置游戏状态为游戏中
+		enGameStatus = InGame;
+		bReachedWin = false;
+
+		//开始新的录像
+		if (pRecord != nullptr)
+		{
+			pRecord->Reset(u32GameSeed, dSpawnWeights_2, dSpawnWeights_4);
+		}
+
+		//在地图中随机两点生成（经典规则）
+		for (size_t i = 0; i < Rules::szInitialSpawns; ++i)
+		{
+			SpawnRandomTile();
+		}
+	}
+
+	//用新种子开始一局
+	void NewGame(uint32_t u32Seed)
+	{
+		u32GameSeed = u32Seed;
+		NewGame();
+	}
+
+	//从当前随机数流中派生下一局的种子，使整个会话只由初始种子决定
+	uint32_t DeriveNextSeed(void)
+	{
+		return (uint32_t)NextRand();
+	}
+
+	bool ProcessMove(Direction dMove)
+	{
+		Game2048_Profile::Scope_If<bProfile> profile(Game2048_Profile::Stage_ProcessMove);
+
+		if (enGameStatus != InGame)//不是游戏状态，直接退出
+		{
+			return false;
+		}
+
+		u8LastSpawn = u8NoSpawn;
+
+		//判断方向，左右则水平，否则垂直
+		bool bHorizontal = (dMove == Lt || dMove == Rt);
+
+		//计算外层大小
+		int64_t i64OuterEnd = bHorizontal ? szHeight : szWidth;//外层仅结束有影响，固定从0开始到结尾
+
+		//计算内层大小
+		int64_t i64InnerFirst, i64InnerBeg, i64InnerEnd, i64InnerStep;
+		if (dMove == Up || dMove == Lt)//正序
+		{
+			i64InnerFirst = 0;//第一个元素的索引
+			i64InnerBeg = i64InnerFirst + 1;//这里从1访问是因为第一排本身就是顶格的，没有移动的必要
+			i64InnerEnd = bHorizontal ? szWidth : szHeight;//正序上边界（不会访问）
+			i64InnerStep = i64InnerFirst + 1;//正序
+		}
+		else//倒序
+		{
+			i64InnerFirst = (bHorizontal ? szWidth : szHeight) - 1;//最后一个元素的索引
+			i64InnerBeg = i64InnerFirst - 1;//这里从i64InnerFirst - 1访问是因为最后一排本身就是顶格的，没有移动的必要
+			i64InnerEnd = -1;//倒序下边界（不会访问）
+			i64InnerStep = -1;//倒序
+		}
+
+
+		//确认是否进行过移动
+		bool bMove = false;
+		for (int64_t i64Outer = 0; i64Outer != i64OuterEnd; ++i64Outer)//外层循环固定形式
+		{
+			//默认状态为可合并，对于移动方向的一排中的每两个只能存在一次合并，多排之间互不影响
+			//实际上，只要确认上一次是否发生过合并，如果发生过，那么本次不允许合并，就会进行堆放，下次则继续允许合并，这样就能完成防止重复合并的逻辑
+
+			//这里上一个合并的坐标初始化为这一行的起始坐标
+			Pos pLast = bHorizontal ? Pos{ i64InnerFirst, i64Outer } : Pos{ i64Outer, i64InnerFirst };
+			//目标存在外层循环固定值，根据移动方向初始化
+			Pos pTarget = bHorizontal ? Pos{ 0, i64Outer } : Pos{ i64Outer, 0 };
+
+			for (int64_t i64Inner = i64InnerBeg; i64Inner != i64InnerEnd; i64Inner += i64InnerStep)//根据实际水平或垂直处理内层
+			{
+				//根据移动方向更新变动的值
+				if (bHorizontal)
+				{
+					pTarget.i64X = i64Inner;
+				}
+				else
+				{
+					pTarget.i64Y = i64Inner;
+				}
+
+				//移动与合并，合并时会设置是否赢，内部不会重复检测当前游戏状态，因为可能同时出现多个2048
+				//返回值代表是否触发过合并或移动，以确认是否需要触发重绘与新值生成
+				bMove |= MoveOrMergeTile(pTarget, pLast, dMove);
+			}
+		}
+
+		if (bMove && enGameStatus == InGame)//移动过且还是游戏状态，如果上面已经赢了，就没必要生成新值了，直接跳过
+		{
+			for (size_t i = 0; i < Rules::szSpawnPerMove; ++i)
+			{
+				SpawnRandomTile();//这里会设置是否输，没有空格子时什么也不做
+			}
+		}
+
+		if (bMove && pRecord != nullptr)//只记录有效移动
+		{
+			pRecord->Append(dMove);
+			pRecord->SetResult(u64GameScore, enGameStatus);
+		}
+
+		return bMove;
+	}
+
+	//====================快照====================
+	//完整的对局状态，随机数状态用种子与已取个数表示，恢复时重新播种并跳过相应个数
+	struct State
+	{
+		uint64_t u64Tile[szTotalSize];
+		uint64_t u64GameScore;
+		uint32_t u32GameStatus;
+		uint32_t u32GameSeed;
+		double dSpawnWeights_2;
+		double dSpawnWeights_4;
+		uint64_t u64RandDraws;
+	};
+
+	State GetState(void) const
+	{
+		State stState{};
+		std::ranges::copy(std::span<const uint64_t, szTotalSize>{ (const uint64_t *)u64Tile, szTotalSize }, stState.u64Tile);
+		stState.u64GameScore = u64GameScore;
+		stState.u32GameStatus = enGameStatus;
+		stState.u32GameSeed = u32GameSeed;
+		stState.dSpawnWeights_2 = dSpawnWeights_2;
+		stState.dSpawnWeights_4 = dSpawnWeights_4;
+		stState.u64RandDraws = u64RandDraws;
+
+		return stState;
+	}
+
+	//恢复时discard的随机数个数上限，正常对局远达不到，损坏的快照不会让恢复长时间运行
+	constexpr const static inline uint64_t u64MaxRandDraws = (uint64_t)1 << 28;
+
+	//格子必须是0或者2的幂（不小于2），已取随机数个数必须与棋盘相符，否则拒绝恢复
+	bool SetState(const State &stState)
+	{
+		size_t szEmpty = 0;
+		uint64_t u64TileSum = 0;
+		for (auto u64Val : stState.u64Tile)
+		{
+			if (u64Val == 1 || (u64Val & (u64Val - 1)) != 0)
+			{
+				return false;
+			}
+
+			szEmpty += u64Val == 0;
+			u64TileSum = u64TileSum + u64Val >= u64TileSum ? u64TileSum + u64Val : UINT64_MAX;//饱和加
+		}
+
+		if (stState.u32GameStatus > LostGame)
+		{
+			return false;
+		}
+
+		//合并不改变数字和，每次生成至少加u64SpawnLow并取2个随机数（位置与数值），派生下一局种子再取1个
+		uint64_t u64Spawns = u64TileSum / Rules::u64SpawnLow;
+		if (stState.u64RandDraws > u64MaxRandDraws ||
+			stState.u64RandDraws > (u64Spawns < u64MaxRandDraws ? u64Spawns : u64MaxRandDraws) * 2 + 1)
+		{
+			return false;
+		}
+
+		std::ranges::copy(stState.u64Tile, TileFlatView().begin());
+		szEmptyCount = szEmpty;
+		u64GameScore = stState.u64GameScore;
+		enGameStatus = (GameStatus)stState.u32GameStatus;
+		bReachedWin = enGameStatus == WinGame;
+		if constexpr (Rules::u64WinTile != 0)
+		{
+			for (auto u64Val : stState.u64Tile)
+			{
+				bReachedWin |= u64Val >= Rules::u64WinTile;
+			}
+		}
+
+		u32GameSeed = stState.u32GameSeed;
+		dSpawnWeights_2 = stState.dSpawnWeights_2;
+		dSpawnWeights_4 = stState.dSpawnWeights_4;
+
+		randGen.seed(u32GameSeed);
+		randGen.discard(stState.u64RandDraws);
+		u64RandDraws = stState.u64RandDraws;
+
+		u8LastSpawn = u8NoSpawn;
+		u64ZobristKey = ComputeZobristKey();
+
+		return true;
+	}
+
+	//====================状态访问====================
+	//设置录像，之后的NewGame与有效移动都会写入录像，传入nullptr停止录像
+	void SetRecord(Game2048_Record *_pRecord)
+	{
+		pRecord = _pRecord;
+	}
+
+	const uint64_t (&GetTiles(void) const)[szHeight][szWidth]
+	{
+		return u64Tile;
+	}
+
+	//转换为压缩棋盘，超过32768的数字会被截断为32768
+	Board_Packed::Board GetPackedBoard(void) const
+	{
+		Board_Packed::Board u64Board = 0;
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			uint8_t u8Exp = Board_Packed::ValueToExponent(((const uint64_t *)u64Tile)[i]);
+			u64Board |= (Board_Packed::Board)(u8Exp < Board_Packed::u8MaxExponent ? u8Exp : Board_Packed::u8MaxExponent) << (i * 4);
+		}
+
+		return u64Board;
+	}
+
+	//转换为宽压缩棋盘，不截断
+	Board_Wide::Board GetWideBoard(void) const
+	{
+		Board_Wide::Board stBoard{};
+		for (size_t i = 0; i < szTotalSize; ++i)
+		{
+			stBoard = Board_Wide::SetCell(stBoard, i, Board_Packed::ValueToExponent(((const uint64_t *)u64Tile)[i]));
+		}
+
+		return stBoard;
+	}
+
+	//最近一次ProcessMove生成的数字：低4bit为格子下标（行优先），第4bit为0代表2、为1代表4（其它规则下为两种生成数字中的小/大者）
+	//每步生成多个时为最后一个
+	//没有生成（赢了或者无效移动）则为u8NoSpawn
+	uint8_t GetLastSpawn(void) const
+	{
+		return u8LastSpawn;
+	}
+
+	size_t GetEmptyCount(void) const
+	{
+		return szEmptyCount;
+	}
+
+	uint64_t GetScore(void) const
+	{
+		return u64GameScore;
+	}
+
+	GameStatus GetStatus(void) const
+	{
+		return enGameStatus;
+	}
+
+	bool HasReachedWin(void) const
+	{
+		return bReachedWin;
+	}
+
+	//当前棋盘的Zobrist哈希（增量维护，O(1)），只由格子决定，与分数、种子等无关
+	uint64_t GetZobristKey(void) const
+	{
+		return u64ZobristKey;
+	}
+
+	uint32_t GetSeed(void) const
+	{
+		return u32GameSeed;
+	}
+
+	double GetSpawnWeights_2(void) const
+	{
+		return dSpawnWeights_2;
+	}
+
+	double GetSpawnWeights_4(void) const
+	{
+		return dSpawnWeights_4;
+	}
+
+	//调试
+#ifdef _DEBUG
+	void Debug(void)
+	{
+		u64Tile[0][0] = 0;
+		u64Tile[0][1] = 2;
+		u64Tile[0][2] = 4;
+		u64Tile[0][3] = 8;
+
+		u64Tile[1][0] = 16;
+		u64Tile[1][1] = 32;
+		u64Tile[1][2] = 64;
+		u64Tile[1][3] = 128;
+
+		u64Tile[2][0] = 256;
+		u64Tile[2][1] = 512;
+		u64Tile[2][2] = 1024;
+		u64Tile[2][3] = 2048;
+
+		u64Tile[3][0] = 4096;
+		u64Tile[3][1] = 8192;
+		u64Tile[3][2] = 0;
+		u64Tile[3][3] = 0;
+
+		szEmptyCount = 3;
+		u64GameScore = UINT64_MAX;
+		u64ZobristKey = ComputeZobristKey();
+	}
+#endif
+};
+
+using Game2048_Core = Game2048_Core_Basic<Game2048_Rules_Classic>;
+using Game2048_Core_Interactive = Game2048_Core_Basic<Game2048_Rules_Classic, true>;//交互会话使用，规则相同，带耗时统计
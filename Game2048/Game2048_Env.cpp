@@ -0,0 +1,88 @@
+﻿#include <new>
+
+#include "Game2048_Env.h"
+#include "Game2048_EnvPool.hpp"
+
+//C接口只是Game2048_EnvPool的薄包装，异常不能穿过C边界，全部转换为返回值
+
+struct Game2048_Env_Pool
+{
+	Game2048_EnvPool pool;
+
+	Game2048_Env_Pool(size_t szCount, uint64_t u64Seed, uint32_t u32Threads) :
+		pool(szCount, u64Seed, u32Threads)
+	{}
+};
+
+uint32_t Game2048_Env_AbiVersion(void)
+{
+	return GAME2048_ENV_ABI_VERSION;
+}
+
+Game2048_Env_Pool *Game2048_Env_Create(uint32_t u32Count, uint64_t u64Seed, uint32_t u32Threads)
+{
+	if (u32Count == 0)
+	{
+		return NULL;
+	}
+
+	try
+	{
+		return new Game2048_Env_Pool(u32Count, u64Seed, u32Threads);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void Game2048_Env_Destroy(Game2048_Env_Pool *pPool)
+{
+	delete pPool;
+}
+
+uint32_t Game2048_Env_Count(const Game2048_Env_Pool *pPool)
+{
+	return pPool != NULL ? (uint32_t)pPool->pool.Count() : 0;
+}
+
+int Game2048_Env_SetBuffers(Game2048_Env_Pool *pPool, const Game2048_Env_Buffers *pBuffers)
+{
+	if (pPool == NULL || pBuffers == NULL)
+	{
+		return -1;
+	}
+
+	Game2048_EnvPool::Buffers stBuffers{};
+	stBuffers.pObservations = pBuffers->pObservations;
+	stBuffers.pBoards = pBuffers->pBoards;
+	stBuffers.pRewards = pBuffers->pRewards;
+	stBuffers.pDones = pBuffers->pDones;
+	stBuffers.pLegalMasks = pBuffers->pLegalMasks;
+	stBuffers.pEpisodeScores = pBuffers->pEpisodeScores;
+	pPool->pool.SetBuffers(stBuffers);
+
+	return 0;
+}
+
+int Game2048_Env_Reset(Game2048_Env_Pool *pPool)
+{
+	if (pPool == NULL)
+	{
+		return -1;
+	}
+
+	pPool->pool.Reset();
+	return 0;
+}
+
+int Game2048_Env_Step(Game2048_Env_Pool *pPool, const uint8_t *pActions)
+{
+	if (pPool == NULL || pActions == NULL)
+	{
+		return -1;
+	}
+
+	pPool->pool.Step(pActions);
+	return 0;
+}
@@ -0,0 +1,80 @@
+﻿#ifndef GAME2048_ENV_H
+#define GAME2048_ENV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+批量强化学习环境的C接口（Game2048_Env动态库），规则与输出格式见Game2048_EnvPool.hpp
+
+典型用法：
+	Game2048_Env_Pool *pPool = Game2048_Env_Create(N, 种子, 0);
+	Game2048_Env_Buffers stBuffers = { 观测, NULL, 奖励, 结束, 掩码, 分数 };
+	Game2048_Env_SetBuffers(pPool, &stBuffers);
+	Game2048_Env_Reset(pPool);
+	while (...)
+	{
+		//根据观测与掩码填写动作
+		Game2048_Env_Step(pPool, pActions);
+	}
+	Game2048_Env_Destroy(pPool);
+
+ABI约定：只增加新函数，不修改已有函数与结构体，不兼容的改动会增加GAME2048_ENV_ABI_VERSION
+*/
+
+#if defined(_WIN32)
+	#if defined(GAME2048_ENV_BUILD)
+		#define GAME2048_ENV_API __declspec(dllexport)
+	#else
+		#define GAME2048_ENV_API __declspec(dllimport)
+	#endif
+#else
+	#define GAME2048_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GAME2048_ENV_ABI_VERSION 1
+#define GAME2048_ENV_ACTIONS 4
+#define GAME2048_ENV_PLANES 16
+#define GAME2048_ENV_CELLS 16
+#define GAME2048_ENV_OBSERVATION_SIZE (GAME2048_ENV_PLANES * GAME2048_ENV_CELLS)
+
+typedef struct Game2048_Env_Pool Game2048_Env_Pool;
+
+//输出缓冲区，均为N个元素（观测为N*GAME2048_ENV_OBSERVATION_SIZE字节），可以为NULL
+typedef struct Game2048_Env_Buffers
+{
+	uint8_t *pObservations;
+	uint64_t *pBoards;
+	float *pRewards;
+	uint8_t *pDones;
+	uint8_t *pLegalMasks;
+	uint32_t *pEpisodeScores;
+} Game2048_Env_Buffers;
+
+//返回GAME2048_ENV_ABI_VERSION，用于检查头文件与动态库是否匹配
+GAME2048_ENV_API uint32_t Game2048_Env_AbiVersion(void);
+
+//创建N个环境，u32Threads为0则使用硬件线程数，失败返回NULL
+GAME2048_ENV_API Game2048_Env_Pool *Game2048_Env_Create(uint32_t u32Count, uint64_t u64Seed, uint32_t u32Threads);
+GAME2048_ENV_API void Game2048_Env_Destroy(Game2048_Env_Pool *pPool);
+
+GAME2048_ENV_API uint32_t Game2048_Env_Count(const Game2048_Env_Pool *pPool);
+
+//设置输出缓冲区，之后的Reset与Step直接写入，缓冲区必须在下一次设置或销毁前保持有效
+GAME2048_ENV_API int Game2048_Env_SetBuffers(Game2048_Env_Pool *pPool, const Game2048_Env_Buffers *pBuffers);
+
+//重开所有环境，成功返回0
+GAME2048_ENV_API int Game2048_Env_Reset(Game2048_Env_Pool *pPool);
+
+//pActions为N个动作（0上 1下 2左 3右），成功返回0
+GAME2048_ENV_API int Game2048_Env_Step(Game2048_Env_Pool *pPool, const uint8_t *pActions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
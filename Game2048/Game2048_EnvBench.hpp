@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <chrono>
+#include <memory>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Fast_Rand.hpp"
+#include "Game2048_EnvPool.hpp"
+
+/*
+批量环境的吞吐量测试：动作由合法掩码查表随机选择，只计Step本身的耗时
+
+用法：
+	Game2048 envbench [--envs N] [--steps S] [--threads T] [--seed S] [--planes]
+	--planes 同时输出one-hot观测平面（默认只输出压缩棋盘）
+*/
+class Game2048_EnvBench
+{
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		uint64_t u64Envs = cmd.GetU64("envs", 65536);
+		uint64_t u64Steps = cmd.GetU64("steps", 1000);
+		uint32_t u32Threads = (uint32_t)cmd.GetU64("threads", 0);
+		uint64_t u64Seed = cmd.GetU64("seed", 0);
+		bool bPlanes = cmd.HasFlag("planes");
+
+		if (u64Envs == 0 || u64Steps == 0)
+		{
+			fprintf(stderr, "Error: --envs and --steps must be positive\n");
+			return 1;
+		}
+
+		Game2048_EnvPool pool((size_t)u64Envs, u64Seed, u32Threads);
+
+		std::unique_ptr<uint8_t[]> upObservations = bPlanes ? std::make_unique<uint8_t[]>(u64Envs * Game2048_EnvPool::szObservationSize) : nullptr;
+		std::unique_ptr<uint64_t[]> upBoards = std::make_unique<uint64_t[]>(u64Envs);
+		std::unique_ptr<float[]> upRewards = std::make_unique<float[]>(u64Envs);
+		std::unique_ptr<uint8_t[]> upDones = std::make_unique<uint8_t[]>(u64Envs);
+		std::unique_ptr<uint8_t[]> upLegalMasks = std::make_unique<uint8_t[]>(u64Envs);
+		std::unique_ptr<uint32_t[]> upEpisodeScores = std::make_unique<uint32_t[]>(u64Envs);
+		std::unique_ptr<uint8_t[]> upActions = std::make_unique<uint8_t[]>(u64Envs);
+
+		Game2048_EnvPool::Buffers stBuffers{};
+		stBuffers.pObservations = upObservations.get();
+		stBuffers.pBoards = upBoards.get();
+		stBuffers.pRewards = upRewards.get();
+		stBuffers.pDones = upDones.get();
+		stBuffers.pLegalMasks = upLegalMasks.get();
+		stBuffers.pEpisodeScores = upEpisodeScores.get();
+		pool.SetBuffers(stBuffers);
+		pool.Reset();
+
+		//u8Pick[m][r]：掩码m下第r%合法数个合法方向，掩码为0时随便给一个（不会发生，结束的对局已被重开）
+		uint8_t u8Pick[16][4] = {};
+		for (size_t m = 0; m < 16; ++m)
+		{
+			uint8_t u8Legal[4] = {};
+			size_t szLegal = 0;
+			for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+			{
+				if (m & ((size_t)1 << d))
+				{
+					u8Legal[szLegal++] = d;
+				}
+			}
+			for (size_t r = 0; r < 4; ++r)
+			{
+				u8Pick[m][r] = szLegal != 0 ? u8Legal[r % szLegal] : 0;
+			}
+		}
+
+		Fast_Rand rand(u64Seed ^ 0x5EED);
+		double dStepSeconds = 0;
+		uint64_t u64Episodes = 0;
+		uint64_t u64ScoreSum = 0;
+		for (uint64_t s = 0; s < u64Steps; ++s)
+		{
+			uint64_t u64Bits = 0;
+			for (uint64_t i = 0; i < u64Envs; ++i)
+			{
+				if (i % 32 == 0)
+				{
+					u64Bits = rand();
+				}
+				upActions[i] = u8Pick[upLegalMasks[i]][u64Bits & 3];
+				u64Bits >>= 2;
+			}
+
+			auto tpBeg = std::chrono::steady_clock::now();
+			pool.Step(upActions.get());
+			auto tpEnd = std::chrono::steady_clock::now();
+			dStepSeconds += std::chrono::duration<double>(tpEnd - tpBeg).count();
+
+			for (uint64_t i = 0; i < u64Envs; ++i)
+			{
+				if (upDones[i] != 0)
+				{
+					++u64Episodes;
+					u64ScoreSum += upEpisodeScores[i];
+				}
+			}
+		}
+
+		uint64_t u64TotalSteps = u64Envs * u64Steps;
+		printf("Envs:[%" PRIu64 "] Threads:[%zu] Planes:[%s] Steps:[%" PRIu64 "] Time:[%.3f s] %.2fM steps/s\n",
+			u64Envs, pool.ThreadCount(), bPlanes ? "yes" : "no", u64TotalSteps, dStepSeconds, u64TotalSteps / dStepSeconds / 1e6);
+		printf("Episodes:[%" PRIu64 "] AvgScore:[%.1f]\n",
+			u64Episodes, u64Episodes != 0 ? (double)u64ScoreSum / u64Episodes : 0.0);
+
+		return 0;
+	}
+};
@@ -0,0 +1,307 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Board_Packed.hpp"
+#include "Fast_Rand.hpp"
+
+/*
+批量强化学习环境：N个对局以结构数组保存（棋盘、随机数状态、分数各一个数组），
+每次Step用动作数组推进所有对局，把观测、奖励、结束标志与合法动作掩码直接写入调用方提供的缓冲区
+
+规则：
+	动作为Direction（0上 1下 2左 3右），无效动作不改变局面，奖励为0
+	奖励为本步合并得分，移动后没有任何有效方向即结束（达到2048不结束）
+	结束的对局在同一次Step内自动重开，此时写出的观测为新对局的初始局面，pEpisodeScores为结束对局的分数
+
+输出（任意一项可以为空，为空则不写）：
+	pObservations  [N][16][16] uint8，第e个平面的第i格为1代表第i格（行优先）的指数为e
+	pBoards        [N] 压缩棋盘（见Board_Packed.hpp）
+	pRewards       [N] float
+	pDones         [N] uint8
+	pLegalMasks    [N] uint8，第d位为1代表方向d有效
+	pEpisodeScores [N] uint32，只在结束时写入
+
+多线程时N个对局按连续区间分给各线程，各线程只写自己区间内的输出
+*/
+class Game2048_EnvPool
+{
+public:
+	constexpr const static inline size_t szPlanes = 16;
+	constexpr const static inline size_t szObservationSize = szPlanes * Board_Packed::szTotalSize;
+
+	struct Buffers
+	{
+		uint8_t *pObservations = nullptr;
+		uint64_t *pBoards = nullptr;
+		float *pRewards = nullptr;
+		uint8_t *pDones = nullptr;
+		uint8_t *pLegalMasks = nullptr;
+		uint32_t *pEpisodeScores = nullptr;
+	};
+
+private:
+	size_t szCount;
+	std::unique_ptr<Board_Packed::Board[]> upBoards;
+	std::unique_ptr<uint64_t[]> upRandStates;
+	std::unique_ptr<uint32_t[]> upScores;
+	Buffers stBuffers;
+
+	//线程池：主线程处理第0段，其余线程等待新任务编号
+	std::vector<std::thread> vecThreads;
+	std::mutex mtxTask;
+	std::condition_variable cvTask;
+	std::condition_variable cvDone;
+	uint64_t u64TaskGeneration;
+	size_t szPending;
+	bool bStop;
+	const uint8_t *pTaskActions;//为空代表重开所有对局
+
+private:
+	//u8Legal为当前棋盘的合法掩码，调用方大多已经算过
+	void WriteOutputs(size_t i, uint8_t u8Legal)
+	{
+		Board_Packed::Board u64Board = upBoards[i];
+		if (stBuffers.pBoards != nullptr)
+		{
+			stBuffers.pBoards[i] = u64Board;
+		}
+		if (stBuffers.pLegalMasks != nullptr)
+		{
+			stBuffers.pLegalMasks[i] = u8Legal;
+		}
+		if (stBuffers.pObservations != nullptr)
+		{
+			uint8_t *pObs = stBuffers.pObservations + i * szObservationSize;
+			memset(pObs, 0, szObservationSize);
+			for (size_t c = 0; c < Board_Packed::szTotalSize; ++c)
+			{
+				pObs[Board_Packed::GetCell(u64Board, c) * Board_Packed::szTotalSize + c] = 1;
+			}
+		}
+	}
+
+	void ResetOne(size_t i, Fast_Rand &rand)
+	{
+		upBoards[i] = Board_Packed::SpawnRandom(Board_Packed::SpawnRandom(0, rand), rand);
+		upScores[i] = 0;
+	}
+
+	void ResetRange(size_t szBeg, size_t szEnd)
+	{
+		for (size_t i = szBeg; i < szEnd; ++i)
+		{
+			Fast_Rand rand(upRandStates[i]);
+			ResetOne(i, rand);
+			upRandStates[i] = rand.GetState();
+
+			if (stBuffers.pRewards != nullptr)
+			{
+				stBuffers.pRewards[i] = 0.0f;
+			}
+			if (stBuffers.pDones != nullptr)
+			{
+				stBuffers.pDones[i] = 0;
+			}
+			WriteOutputs(i, Board_Packed::LegalMoves(upBoards[i]));
+		}
+	}
+
+	void StepRange(size_t szBeg, size_t szEnd, const uint8_t *pActions)
+	{
+		for (size_t i = szBeg; i < szEnd; ++i)
+		{
+			Board_Packed::Board u64Board = upBoards[i];
+			uint8_t u8Action = pActions[i];
+			uint8_t u8Legal = 0;
+			uint32_t u32Reward = 0;
+			uint8_t u8Done = 0;
+
+			Board_Packed::Board u64After = u8Action < Board_Packed::Enum_End ? Board_Packed::Move(u64Board, (Board_Packed::Direction)u8Action, u32Reward) : u64Board;
+			if (u64After != u64Board)
+			{
+				Fast_Rand rand(upRandStates[i]);
+				u64After = Board_Packed::SpawnRandom(u64After, rand);
+				upScores[i] += u32Reward;
+
+				upBoards[i] = u64After;
+				u8Legal = Board_Packed::LegalMoves(u64After);
+				if (u8Legal == 0)
+				{
+					u8Done = 1;
+					if (stBuffers.pEpisodeScores != nullptr)
+					{
+						stBuffers.pEpisodeScores[i] = upScores[i];
+					}
+					ResetOne(i, rand);
+					u8Legal = Board_Packed::LegalMoves(upBoards[i]);
+				}
+				upRandStates[i] = rand.GetState();
+			}
+			else
+			{
+				u8Legal = Board_Packed::LegalMoves(u64Board);//无效动作，局面未变
+			}
+
+			if (stBuffers.pRewards != nullptr)
+			{
+				stBuffers.pRewards[i] = (float)u32Reward;
+			}
+			if (stBuffers.pDones != nullptr)
+			{
+				stBuffers.pDones[i] = u8Done;
+			}
+			WriteOutputs(i, u8Legal);
+		}
+	}
+
+	void RunSlice(size_t szSlice, const uint8_t *pActions)
+	{
+		size_t szSlices = vecThreads.size() + 1;
+		size_t szBeg = szCount * szSlice / szSlices;
+		size_t szEnd = szCount * (szSlice + 1) / szSlices;
+
+		if (pActions != nullptr)
+		{
+			StepRange(szBeg, szEnd, pActions);
+		}
+		else
+		{
+			ResetRange(szBeg, szEnd);
+		}
+	}
+
+	void Worker(size_t szSlice)
+	{
+		uint64_t u64Seen = 0;
+		while (true)
+		{
+			const uint8_t *pActions = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mtxTask);
+				cvTask.wait(lock, [&](void) -> bool { return bStop || u64TaskGeneration != u64Seen; });
+				if (bStop)
+				{
+					return;
+				}
+				u64Seen = u64TaskGeneration;
+				pActions = pTaskActions;
+			}
+
+			RunSlice(szSlice, pActions);
+
+			std::lock_guard<std::mutex> lock(mtxTask);
+			if (--szPending == 0)
+			{
+				cvDone.notify_one();
+			}
+		}
+	}
+
+	void Run(const uint8_t *pActions)
+	{
+		if (vecThreads.empty())
+		{
+			RunSlice(0, pActions);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mtxTask);
+			pTaskActions = pActions;
+			szPending = vecThreads.size();
+			++u64TaskGeneration;
+		}
+		cvTask.notify_all();
+
+		RunSlice(0, pActions);
+
+		std::unique_lock<std::mutex> lock(mtxTask);
+		cvDone.wait(lock, [&](void) -> bool { return szPending == 0; });
+	}
+
+public:
+	//u32Threads为0则使用硬件线程数，每个线程至少分到4096个对局，否则线程切换得不偿失
+	Game2048_EnvPool(size_t _szCount, uint64_t u64Seed, uint32_t u32Threads) :
+		szCount(_szCount),
+		upBoards(std::make_unique<Board_Packed::Board[]>(_szCount)),
+		upRandStates(std::make_unique<uint64_t[]>(_szCount)),
+		upScores(std::make_unique<uint32_t[]>(_szCount)),
+		stBuffers(),
+		vecThreads(),
+		mtxTask(),
+		cvTask(),
+		cvDone(),
+		u64TaskGeneration(0),
+		szPending(0),
+		bStop(false),
+		pTaskActions(nullptr)
+	{
+		//每个对局各自的随机数流
+		Fast_Rand randSeed(u64Seed);
+		for (size_t i = 0; i < szCount; ++i)
+		{
+			upRandStates[i] = randSeed();
+		}
+
+		u32Threads = u32Threads != 0 ? u32Threads : std::thread::hardware_concurrency();
+		size_t szMaxThreads = szCount / 4096;
+		size_t szThreads = u32Threads < szMaxThreads ? u32Threads : szMaxThreads;
+		for (size_t i = 1; i < szThreads; ++i)
+		{
+			vecThreads.emplace_back(&Game2048_EnvPool::Worker, this, i);
+		}
+
+		Board_Packed::Move(0, Board_Packed::Up);//提前构建行表
+	}
+	~Game2048_EnvPool(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mtxTask);
+			bStop = true;
+		}
+		cvTask.notify_all();
+		for (auto &it : vecThreads)
+		{
+			it.join();
+		}
+	}
+
+	Game2048_EnvPool(const Game2048_EnvPool &) = delete;
+	Game2048_EnvPool &operator=(const Game2048_EnvPool &) = delete;
+
+	size_t Count(void) const
+	{
+		return szCount;
+	}
+
+	size_t ThreadCount(void) const
+	{
+		return vecThreads.size() + 1;
+	}
+
+	//之后的Reset与Step都写入这些缓冲区，缓冲区由调用方持有
+	void SetBuffers(const Buffers &_stBuffers)
+	{
+		stBuffers = _stBuffers;
+	}
+
+	//重开所有对局并写出初始观测
+	void Reset(void)
+	{
+		Run(nullptr);
+	}
+
+	//pActions为N个动作
+	void Step(const uint8_t *pActions)
+	{
+		Run(pActions);
+	}
+};
@@ -0,0 +1,534 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include <vector>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Mapped_File.hpp"
+
+/*
+训练数据导出格式（列式、分块、定长记录，小端序）：
+
+	[File_Header，占满一个4096字节的页]
+	[块 0][块 1]...
+
+每块固定容纳u32ChunkCapacity条记录（4096的倍数），块内按列连续存放：
+	[u64 棋盘 * 容量][u8 合法移动掩码 * 容量][u8 选择的移动 * 容量][u32 本步得分 * 容量][u64 最终分数 * 容量]
+所以每一列在文件内都4096字节对齐，消费者mmap之后可以直接把某一列当作数组使用，
+最后一块未满的部分填0，有效记录总数见u64RecordCount
+
+写入时整块在对齐的内存缓冲区中填满后交给后台线程一次写出（双缓冲，模拟线程不等待磁盘），
+Linux下可选O_DIRECT绕过页缓存
+*/
+class Game2048_Export
+{
+public:
+	constexpr const static inline uint32_t u32Magic = 0x44543247;//'G2TD'
+	constexpr const static inline uint16_t u16Version = 1;
+	constexpr const static inline size_t szAlignment = 4096;
+	constexpr const static inline uint32_t u32DefaultChunkCapacity = 65536;
+
+	struct File_Header
+	{
+		uint32_t u32Magic;
+		uint16_t u16Version;
+		uint16_t u16ColumnCount;
+		uint32_t u32ChunkCapacity;
+		uint32_t u32Reserved;
+		uint64_t u64RecordCount;
+		uint64_t u64ChunkCount;
+		uint64_t u64GameCount;
+	};
+
+	//一条记录（仅用于在对局进行中暂存，文件内按列存放）
+	struct Record
+	{
+		uint64_t u64Board;
+		uint8_t u8LegalMask;
+		uint8_t u8Move;
+		uint32_t u32Reward;
+	};
+
+	enum Column
+	{
+		Col_Board = 0,
+		Col_LegalMask,
+		Col_Move,
+		Col_Reward,
+		Col_FinalScore,
+		Col_Enum_End,
+	};
+
+	constexpr const static inline size_t szColumnSize[Col_Enum_End] = { 8, 1, 1, 4, 8 };
+
+	static uint64_t ColumnOffset(Column enColumn, uint32_t u32Capacity)
+	{
+		uint64_t u64Offset = 0;
+		for (size_t i = 0; i < (size_t)enColumn; ++i)
+		{
+			u64Offset += szColumnSize[i] * u32Capacity;
+		}
+
+		return u64Offset;
+	}
+
+	static uint64_t ChunkSize(uint32_t u32Capacity)
+	{
+		return ColumnOffset(Col_Enum_End, u32Capacity);
+	}
+};
+
+//单局记录的暂存，最终分数要等对局结束才能确定
+class Game2048_Export_Game
+{
+	friend class Game2048_Export_Writer;
+
+private:
+	std::vector<Game2048_Export::Record> vecRecords;
+	uint64_t u64FinalScore;
+
+public:
+	Game2048_Export_Game(void) :
+		vecRecords(),
+		u64FinalScore(0)
+	{}
+	~Game2048_Export_Game(void) = default;
+
+	void Begin(void)
+	{
+		vecRecords.clear();
+		u64FinalScore = 0;
+	}
+
+	void Push(uint64_t u64Board, uint8_t u8LegalMask, uint8_t u8Move, uint32_t u32Reward)
+	{
+		vecRecords.push_back({ u64Board, u8LegalMask, u8Move, u32Reward });
+	}
+
+	void Finish(uint64_t _u64FinalScore)
+	{
+		u64FinalScore = _u64FinalScore;
+	}
+};
+
+//流式写入，可被多个模拟线程共用（调用方负责加锁）
+class Game2048_Export_Writer
+{
+private:
+#if defined(__linux__)
+	int iFd;
+#else
+	FILE *pFile;
+#endif
+	uint8_t *pChunk;//对齐的块缓冲区，正在填充
+	uint8_t *pPending;//对齐的块缓冲区，正在由后台线程写出
+	uint8_t *pHeaderPage;//对齐的文件头页
+	uint32_t u32Capacity;
+	uint32_t u32Filled;//当前块已填充的记录数
+	Game2048_Export::File_Header stHeader;
+
+	//后台写出线程
+	std::thread thdWriter;
+	std::mutex mtxWriter;
+	std::condition_variable cvWriter;
+	bool bPending;//pPending中有待写出的块
+	bool bStop;
+	bool bWriteFailed;
+	uint64_t u64PendingOffset;
+
+private:
+	template<typename T>
+	T *ColumnPtr(Game2048_Export::Column enColumn)
+	{
+		return (T *)(pChunk + Game2048_Export::ColumnOffset(enColumn, u32Capacity));
+	}
+
+	bool WriteAt(const void *pData, size_t szSize, uint64_t u64Offset)
+	{
+#if defined(__linux__)
+		const uint8_t *pCur = (const uint8_t *)pData;
+		while (szSize != 0)
+		{
+			ssize_t sszWrite = pwrite(iFd, pCur, szSize, (off_t)u64Offset);
+			if (sszWrite <= 0)
+			{
+				return false;
+			}
+
+			pCur += sszWrite;
+			szSize -= (size_t)sszWrite;
+			u64Offset += (uint64_t)sszWrite;
+		}
+
+		return true;
+#else
+		return _fseeki64(pFile, (long long)u64Offset, SEEK_SET) == 0 && fwrite(pData, 1, szSize, pFile) == szSize;
+#endif
+	}
+
+	void WriterThread(void)
+	{
+		std::unique_lock<std::mutex> lock(mtxWriter);
+		while (true)
+		{
+			cvWriter.wait(lock, [&](void) -> bool { return bPending || bStop; });
+			if (!bPending)
+			{
+				return;
+			}
+
+			//写出时不持有锁，模拟线程可以继续填充另一个缓冲区
+			lock.unlock();
+			bool bRet = WriteAt(pPending, (size_t)Game2048_Export::ChunkSize(u32Capacity), u64PendingOffset);
+			lock.lock();
+
+			bWriteFailed = bWriteFailed || !bRet;
+			bPending = false;
+			cvWriter.notify_all();
+		}
+	}
+
+	//等待后台线程写完上一块
+	void WaitPending(std::unique_lock<std::mutex> &lock)
+	{
+		cvWriter.wait(lock, [&](void) -> bool { return !bPending; });
+	}
+
+	bool FlushChunk(void)
+	{
+		if (u32Filled == 0)
+		{
+			return true;
+		}
+
+		//未满部分填0，块始终整块写出，保证定长与对齐
+		if (u32Filled != u32Capacity)
+		{
+			for (size_t i = 0; i < Game2048_Export::Col_Enum_End; ++i)
+			{
+				auto enColumn = (Game2048_Export::Column)i;
+				uint8_t *pColumn = ColumnPtr<uint8_t>(enColumn);
+				size_t szElem = Game2048_Export::szColumnSize[i];
+				memset(pColumn + szElem * u32Filled, 0, szElem * (u32Capacity - u32Filled));
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(mtxWriter);
+		WaitPending(lock);
+
+		//交换缓冲区，交给后台线程写出
+		std::swap(pChunk, pPending);
+		u64PendingOffset = Game2048_Export::szAlignment + stHeader.u64ChunkCount * Game2048_Export::ChunkSize(u32Capacity);
+		bPending = true;
+		cvWriter.notify_all();
+
+		++stHeader.u64ChunkCount;
+		u32Filled = 0;
+
+		return !bWriteFailed;
+	}
+
+	bool WriteHeader(void)
+	{
+		memset(pHeaderPage, 0, Game2048_Export::szAlignment);
+		memcpy(pHeaderPage, &stHeader, sizeof(stHeader));
+		return WriteAt(pHeaderPage, Game2048_Export::szAlignment, 0);
+	}
+
+	void FreeBuffers(void)
+	{
+		if (pChunk != nullptr)
+		{
+			operator delete(pChunk, std::align_val_t(Game2048_Export::szAlignment));
+			pChunk = nullptr;
+		}
+		if (pPending != nullptr)
+		{
+			operator delete(pPending, std::align_val_t(Game2048_Export::szAlignment));
+			pPending = nullptr;
+		}
+		if (pHeaderPage != nullptr)
+		{
+			operator delete(pHeaderPage, std::align_val_t(Game2048_Export::szAlignment));
+			pHeaderPage = nullptr;
+		}
+	}
+
+public:
+	Game2048_Export_Writer(void) :
+#if defined(__linux__)
+		iFd(-1),
+#else
+		pFile(NULL),
+#endif
+		pChunk(nullptr),
+		pPending(nullptr),
+		pHeaderPage(nullptr),
+		u32Capacity(0),
+		u32Filled(0),
+		stHeader{},
+
+		thdWriter(),
+		mtxWriter(),
+		cvWriter(),
+		bPending(false),
+		bStop(false),
+		bWriteFailed(false),
+		u64PendingOffset(0)
+	{}
+	~Game2048_Export_Writer(void)
+	{
+		Close();
+	}
+
+	Game2048_Export_Writer(const Game2048_Export_Writer &) = delete;
+	Game2048_Export_Writer &operator=(const Game2048_Export_Writer &) = delete;
+
+	//u32ChunkCapacity必须是4096的倍数，bDirect仅在Linux下有效，文件系统不支持时自动退回普通写入
+	bool Open(const char *pPath, bool bDirect = false, uint32_t u32ChunkCapacity = Game2048_Export::u32DefaultChunkCapacity)
+	{
+		Close();
+
+		if (u32ChunkCapacity == 0 || u32ChunkCapacity % Game2048_Export::szAlignment != 0)
+		{
+			return false;
+		}
+
+#if defined(__linux__)
+		int iFlags = O_WRONLY | O_CREAT | O_TRUNC;
+		iFd = bDirect ? open(pPath, iFlags | O_DIRECT, 0644) : -1;
+		if (iFd < 0)
+		{
+			iFd = open(pPath, iFlags, 0644);
+		}
+		if (iFd < 0)
+		{
+			return false;
+		}
+#else
+		(void)bDirect;
+		pFile = fopen(pPath, "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+#endif
+
+		u32Capacity = u32ChunkCapacity;
+		u32Filled = 0;
+		pChunk = (uint8_t *)operator new((size_t)Game2048_Export::ChunkSize(u32Capacity), std::align_val_t(Game2048_Export::szAlignment));
+		pPending = (uint8_t *)operator new((size_t)Game2048_Export::ChunkSize(u32Capacity), std::align_val_t(Game2048_Export::szAlignment));
+		pHeaderPage = (uint8_t *)operator new(Game2048_Export::szAlignment, std::align_val_t(Game2048_Export::szAlignment));
+
+		stHeader = {};
+		stHeader.u32Magic = Game2048_Export::u32Magic;
+		stHeader.u16Version = Game2048_Export::u16Version;
+		stHeader.u16ColumnCount = Game2048_Export::Col_Enum_End;
+		stHeader.u32ChunkCapacity = u32Capacity;
+
+		bPending = false;
+		bStop = false;
+		bWriteFailed = false;
+		thdWriter = std::thread(&Game2048_Export_Writer::WriterThread, this);
+
+		return WriteHeader();
+	}
+
+	//追加一整局，最终分数写入这一局的每一条记录
+	bool Append(const Game2048_Export_Game &game)
+	{
+		if (pChunk == nullptr)
+		{
+			return false;
+		}
+
+		for (const auto &it : game.vecRecords)
+		{
+			ColumnPtr<uint64_t>(Game2048_Export::Col_Board)[u32Filled] = it.u64Board;
+			ColumnPtr<uint8_t>(Game2048_Export::Col_LegalMask)[u32Filled] = it.u8LegalMask;
+			ColumnPtr<uint8_t>(Game2048_Export::Col_Move)[u32Filled] = it.u8Move;
+			ColumnPtr<uint32_t>(Game2048_Export::Col_Reward)[u32Filled] = it.u32Reward;
+			ColumnPtr<uint64_t>(Game2048_Export::Col_FinalScore)[u32Filled] = game.u64FinalScore;
+
+			if (++u32Filled == u32Capacity && !FlushChunk())
+			{
+				return false;
+			}
+		}
+
+		stHeader.u64RecordCount += game.vecRecords.size();
+		++stHeader.u64GameCount;
+
+		return true;
+	}
+
+	bool Close(void)
+	{
+		if (pChunk == nullptr)
+		{
+			return false;
+		}
+
+		bool bRet = FlushChunk();
+
+		//等待最后一块写完并结束后台线程，然后才能回写文件头
+		{
+			std::unique_lock<std::mutex> lock(mtxWriter);
+			WaitPending(lock);
+			bStop = true;
+			cvWriter.notify_all();
+		}
+		thdWriter.join();
+
+		bRet = !bWriteFailed && WriteHeader() && bRet;
+
+#if defined(__linux__)
+		bRet = close(iFd) == 0 && bRet;
+		iFd = -1;
+#else
+		bRet = fclose(pFile) == 0 && bRet;
+		pFile = NULL;
+#endif
+		FreeBuffers();
+
+		return bRet;
+	}
+};
+
+//通过内存映射读取，每一列直接指向映射区域
+class Game2048_Export_Reader
+{
+private:
+	Mapped_File mapFile;
+	const Game2048_Export::File_Header *pHeader;
+
+public:
+	struct Chunk_View
+	{
+		std::span<const uint64_t> spBoard;
+		std::span<const uint8_t> spLegalMask;
+		std::span<const uint8_t> spMove;
+		std::span<const uint32_t> spReward;
+		std::span<const uint64_t> spFinalScore;
+	};
+
+public:
+	Game2048_Export_Reader(void) :
+		mapFile(),
+		pHeader(nullptr)
+	{}
+	~Game2048_Export_Reader(void) = default;
+
+	bool Open(const char *pPath)
+	{
+		pHeader = nullptr;
+		if (!mapFile.Open(pPath))
+		{
+			return false;
+		}
+
+		//头部字段不可信：块数用除法检查（乘法可能溢出），块数确定后记录数不超过块容量之和
+		const auto *pFileHeader = mapFile.At<Game2048_Export::File_Header>(0);
+		if (pFileHeader == nullptr ||
+			pFileHeader->u32Magic != Game2048_Export::u32Magic ||
+			pFileHeader->u16Version != Game2048_Export::u16Version ||
+			pFileHeader->u32ChunkCapacity == 0 ||
+			pFileHeader->u32ChunkCapacity % Game2048_Export::szAlignment != 0 ||
+			mapFile.Size() < Game2048_Export::szAlignment ||
+			(mapFile.Size() - Game2048_Export::szAlignment) / Game2048_Export::ChunkSize(pFileHeader->u32ChunkCapacity) < pFileHeader->u64ChunkCount ||
+			pFileHeader->u64RecordCount > pFileHeader->u64ChunkCount * pFileHeader->u32ChunkCapacity)
+		{
+			return false;
+		}
+
+		pHeader = pFileHeader;
+		return true;
+	}
+
+	const Game2048_Export::File_Header &GetHeader(void) const
+	{
+		return *pHeader;
+	}
+
+	uint64_t ChunkCount(void) const
+	{
+		return pHeader->u64ChunkCount;
+	}
+
+	Chunk_View GetChunk(uint64_t u64Chunk) const
+	{
+		uint32_t u32Capacity = pHeader->u32ChunkCapacity;
+		const uint8_t *pChunk = mapFile.Data() + Game2048_Export::szAlignment + u64Chunk * Game2048_Export::ChunkSize(u32Capacity);
+
+		//最后一块只有部分有效
+		uint64_t u64Begin = u64Chunk * u32Capacity;
+		uint64_t u64Left = pHeader->u64RecordCount > u64Begin ? pHeader->u64RecordCount - u64Begin : 0;
+		size_t szCount = (size_t)(u64Left < u32Capacity ? u64Left : u32Capacity);
+
+		auto fColumn = [&](Game2048_Export::Column enColumn) -> const void *
+		{
+			return pChunk + Game2048_Export::ColumnOffset(enColumn, u32Capacity);
+		};
+
+		return Chunk_View{
+			{ (const uint64_t *)fColumn(Game2048_Export::Col_Board), szCount },
+			{ (const uint8_t *)fColumn(Game2048_Export::Col_LegalMask), szCount },
+			{ (const uint8_t *)fColumn(Game2048_Export::Col_Move), szCount },
+			{ (const uint32_t *)fColumn(Game2048_Export::Col_Reward), szCount },
+			{ (const uint64_t *)fColumn(Game2048_Export::Col_FinalScore), szCount },
+		};
+	}
+
+	//用法：Game2048 dataset <文件>，打印概要并检查每条记录的选择是否在合法掩码内
+	static int Main(const Command_Line &cmd)
+	{
+		auto svPath = cmd.Positional(1);
+
+		if (svPath.empty())
+		{
+			fprintf(stderr, "Usage: Game2048 dataset <file>\n");
+			return 1;
+		}
+
+		Game2048_Export_Reader reader{};
+		if (!reader.Open(svPath.data()))
+		{
+			fprintf(stderr, "Error: cannot open dataset [%s] or it is corrupted\n", svPath.data());
+			return 1;
+		}
+
+		const auto &stHeader = reader.GetHeader();
+		uint64_t u64Invalid = 0;
+		uint64_t u64RewardSum = 0;
+		for (uint64_t i = 0; i < reader.ChunkCount(); ++i)
+		{
+			auto view = reader.GetChunk(i);
+			for (size_t j = 0; j < view.spBoard.size(); ++j)
+			{
+				u64Invalid += (view.spLegalMask[j] & (1 << view.spMove[j])) == 0;
+				u64RewardSum += view.spReward[j];
+			}
+		}
+
+		printf("Games:[%" PRIu64 "] Records:[%" PRIu64 "] Chunks:[%" PRIu64 "] ChunkCapacity:[%" PRIu32 "]\n",
+			stHeader.u64GameCount, stHeader.u64RecordCount, stHeader.u64ChunkCount, stHeader.u32ChunkCapacity);
+		printf("RewardSum:[%" PRIu64 "] IllegalMoves:[%" PRIu64 "]\n", u64RewardSum, u64Invalid);
+
+		return u64Invalid == 0 ? 0 : 1;
+	}
+};
@@ -0,0 +1,384 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+
+/*
+行表启发评估：对所有65536种压缩行预先计算一个分数，棋盘的评估值为4行与4列（转置后的行）共8次查表之和，
+作为expectimax叶子的评估时每秒可以评估上亿个局面
+
+每行的分数：
+	基础分 + 空格子数*空格权重 + 可合并数*合并权重
+	- 单调性权重 * min(向左递增的违反量, 向右递增的违反量)（违反量为相邻两格 指数^单调性幂 之差）
+	- 数字和权重 * sum(指数^数字和幂)
+基础分保证非死局的评估值为正，死局在expectimax中为0，相当于失败惩罚
+行与其反转的分数相同，行与列使用同一张表，所以评估值对8种对称不变，可以使用规范形式的缓存
+
+权重文件为文本，每行"名称 值"，#开头为注释，未出现的项保持默认值，名称见stWeightNames，
+可以用heuristic模式--save写出默认权重再修改，修改后无须重新编译即可在selfplay或tournament中用--heuristic比较
+*/
+class Game2048_Heuristic : public Game2048_Evaluator
+{
+public:
+	struct Weights
+	{
+		float fBase = 200000.0f;
+		float fEmpty = 270.0f;
+		float fMerges = 700.0f;
+		float fMonotonicityPower = 4.0f;
+		float fMonotonicity = 47.0f;
+		float fSumPower = 3.5f;
+		float fSum = 11.0f;
+	};
+
+	struct Weight_Name
+	{
+		const char *pName;
+		float Weights:: *pMember;
+	};
+
+	constexpr const static inline Weight_Name stWeightNames[] =
+	{
+		{ "base", &Weights::fBase },
+		{ "empty", &Weights::fEmpty },
+		{ "merges", &Weights::fMerges },
+		{ "monotonicity_power", &Weights::fMonotonicityPower },
+		{ "monotonicity", &Weights::fMonotonicity },
+		{ "sum_power", &Weights::fSumPower },
+		{ "sum", &Weights::fSum },
+	};
+
+private:
+	Weights stWeights;
+	std::unique_ptr<float[]> upRowTable;//szRowCount项，256KB
+
+private:
+	void BuildTable(void)
+	{
+		//指数的幂只有16种，先算好
+		float fMonoPow[Board_Packed::u8MaxExponent + 1];
+		float fSumPow[Board_Packed::u8MaxExponent + 1];
+		for (uint8_t e = 0; e <= Board_Packed::u8MaxExponent; ++e)
+		{
+			fMonoPow[e] = powf((float)e, stWeights.fMonotonicityPower);
+			fSumPow[e] = powf((float)e, stWeights.fSumPower);
+		}
+
+		for (size_t i = 0; i < Board_Packed::szRowCount; ++i)
+		{
+			uint8_t u8Cell[Board_Packed::szWidth];
+			for (size_t x = 0; x < Board_Packed::szWidth; ++x)
+			{
+				u8Cell[x] = (uint8_t)((i >> (x * 4)) & 0x0F);
+			}
+
+			float fSum = 0.0f;
+			uint32_t u32Empty = 0;
+			for (size_t x = 0; x < Board_Packed::szWidth; ++x)
+			{
+				fSum += fSumPow[u8Cell[x]];
+				u32Empty += u8Cell[x] == 0;
+			}
+
+			//可合并数：跳过空格后连续相同的一段长度为n时计n
+			uint32_t u32Merges = 0;
+			uint8_t u8Prev = 0;
+			uint32_t u32Run = 0;
+			for (size_t x = 0; x < Board_Packed::szWidth; ++x)
+			{
+				if (u8Cell[x] == 0)
+				{
+					continue;
+				}
+
+				if (u8Cell[x] == u8Prev)
+				{
+					++u32Run;
+				}
+				else if (u32Run != 0)
+				{
+					u32Merges += u32Run + 1;
+					u32Run = 0;
+				}
+				u8Prev = u8Cell[x];
+			}
+			u32Merges += u32Run != 0 ? u32Run + 1 : 0;
+
+			float fMonoLeft = 0.0f;
+			float fMonoRight = 0.0f;
+			for (size_t x = 1; x < Board_Packed::szWidth; ++x)
+			{
+				if (u8Cell[x - 1] > u8Cell[x])
+				{
+					fMonoLeft += fMonoPow[u8Cell[x - 1]] - fMonoPow[u8Cell[x]];
+				}
+				else
+				{
+					fMonoRight += fMonoPow[u8Cell[x]] - fMonoPow[u8Cell[x - 1]];
+				}
+			}
+
+			upRowTable[i] = stWeights.fBase +
+				stWeights.fEmpty * (float)u32Empty +
+				stWeights.fMerges * (float)u32Merges -
+				stWeights.fMonotonicity * (fMonoLeft < fMonoRight ? fMonoLeft : fMonoRight) -
+				stWeights.fSum * fSum;
+		}
+	}
+
+public:
+	Game2048_Heuristic(void) :
+		Game2048_Heuristic(Weights{})
+	{}
+	Game2048_Heuristic(const Weights &_stWeights) :
+		stWeights(_stWeights),
+		upRowTable(std::make_unique<float[]>(Board_Packed::szRowCount))
+	{
+		BuildTable();
+	}
+	~Game2048_Heuristic(void) = default;
+
+	Game2048_Heuristic(const Game2048_Heuristic &) = delete;
+	Game2048_Heuristic &operator=(const Game2048_Heuristic &) = delete;
+
+	const Weights &GetWeights(void) const
+	{
+		return stWeights;
+	}
+
+	void SetWeights(const Weights &_stWeights)
+	{
+		stWeights = _stWeights;
+		BuildTable();
+	}
+
+	float EvaluateRow(Board_Packed::Row u16Row) const
+	{
+		return upRowTable[u16Row];
+	}
+
+	float Evaluate(Board u64Board) const override
+	{
+		Board u64Transpose = Board_Packed::Transpose(u64Board);
+		return
+			upRowTable[Board_Packed::GetRow(u64Board, 0)] +
+			upRowTable[Board_Packed::GetRow(u64Board, 1)] +
+			upRowTable[Board_Packed::GetRow(u64Board, 2)] +
+			upRowTable[Board_Packed::GetRow(u64Board, 3)] +
+			upRowTable[Board_Packed::GetRow(u64Transpose, 0)] +
+			upRowTable[Board_Packed::GetRow(u64Transpose, 1)] +
+			upRowTable[Board_Packed::GetRow(u64Transpose, 2)] +
+			upRowTable[Board_Packed::GetRow(u64Transpose, 3)];
+	}
+
+	//读取权重文件并重建行表，失败时输出原因并保持原来的权重
+	bool Load(const char *pPath)
+	{
+		FILE *pFile = fopen(pPath, "rb");
+		if (pFile == NULL)
+		{
+			fprintf(stderr, "Error: cannot open heuristic weights [%s]\n", pPath);
+			return false;
+		}
+
+		Weights stNew = stWeights;
+		char cLine[256];
+		uint32_t u32Line = 0;
+		bool bRet = true;
+		while (bRet && fgets(cLine, sizeof(cLine), pFile) != NULL)
+		{
+			++u32Line;
+
+			char cName[64] = {};
+			char cValue[64] = {};
+			int iFields = sscanf(cLine, "%63s %63s", cName, cValue);
+			if (iFields <= 0 || cName[0] == '#')
+			{
+				continue;
+			}
+
+			char *pEnd = nullptr;
+			float fValue = iFields == 2 ? strtof(cValue, &pEnd) : 0.0f;
+			if (iFields != 2 || pEnd == cValue || *pEnd != '\0' || !isfinite(fValue))
+			{
+				fprintf(stderr, "Error: [%s:%" PRIu32 "] expected \"name value\"\n", pPath, u32Line);
+				bRet = false;
+				break;
+			}
+
+			bool bFound = false;
+			for (const auto &it : stWeightNames)
+			{
+				if (strcmp(it.pName, cName) == 0)
+				{
+					stNew.*it.pMember = fValue;
+					bFound = true;
+					break;
+				}
+			}
+
+			if (!bFound)
+			{
+				fprintf(stderr, "Error: [%s:%" PRIu32 "] unknown weight [%s]\n", pPath, u32Line, cName);
+				bRet = false;
+			}
+		}
+
+		fclose(pFile);
+		if (bRet)
+		{
+			SetWeights(stNew);
+		}
+
+		return bRet;
+	}
+
+	//写出当前权重（原子替换）
+	bool Save(const char *pPath) const
+	{
+		std::string strTemp = std::string(pPath) + ".tmp";
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		fprintf(pFile, "# Game2048 heuristic weights\n");
+		for (const auto &it : stWeightNames)
+		{
+			fprintf(pFile, "%s %.9g\n", it.pName, stWeights.*it.pMember);
+		}
+
+		bool bRet = fclose(pFile) == 0;
+		std::error_code ec;
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, pPath, ec);
+			bRet = !ec;
+		}
+		if (!bRet)
+		{
+			std::filesystem::remove(strTemp, ec);
+		}
+
+		return bRet;
+	}
+
+	//命令行--heuristic：default为默认权重，否则为权重文件
+	bool LoadOption(const char *pOption)
+	{
+		return strcmp(pOption, "default") == 0 || Load(pOption);
+	}
+};
+
+/*
+启发评估测试：输出权重，测量建表耗时与对真实局面的评估速度，并与只数空格子的默认评估对比
+
+用法：
+	Game2048 heuristic [--heuristic 文件] [--save 文件] [--games N] [--seed S] [--repeat R]
+	--save 把当前权重写入文件（可作为调整权重的起点）
+*/
+class Game2048_Heuristic_Bench
+{
+private:
+	//返回每秒评估次数，结果累加到fSink防止被优化掉
+	static double Measure(const Game2048_Evaluator &evaluator, const std::vector<Board_Packed::Board> &vecBoards, uint64_t u64Repeat, float &fSink)
+	{
+		auto tpBeg = std::chrono::steady_clock::now();
+		for (uint64_t r = 0; r < u64Repeat; ++r)
+		{
+			for (Board_Packed::Board u64Board : vecBoards)
+			{
+				fSink += evaluator.Evaluate(u64Board);
+			}
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		return dSeconds > 0 ? (double)vecBoards.size() * u64Repeat / dSeconds : 0.0;
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		uint64_t u64Games = cmd.GetU64("games", 100);
+		uint32_t u32SeedBase = (uint32_t)cmd.GetU64("seed", 0);
+		uint64_t u64Repeat = cmd.GetU64("repeat", 100);
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		Game2048_Heuristic heuristic{};
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		const char *pHeuristicPath = cmd.GetString("heuristic");
+		if (pHeuristicPath != nullptr && !heuristic.LoadOption(pHeuristicPath))
+		{
+			return 1;
+		}
+
+		const Game2048_Heuristic::Weights &stWeights = heuristic.GetWeights();
+		for (const auto &it : Game2048_Heuristic::stWeightNames)
+		{
+			printf("%s %.9g\n", it.pName, stWeights.*it.pMember);
+		}
+
+		const char *pSavePath = cmd.GetString("save");
+		if (pSavePath != nullptr)
+		{
+			if (!heuristic.Save(pSavePath))
+			{
+				fprintf(stderr, "Error: cannot save heuristic weights [%s]\n", pSavePath);
+				return 1;
+			}
+			printf("Saved:[%s]\n", pSavePath);
+		}
+
+		//收集真实对局中的棋盘
+		std::vector<Board_Packed::Board> vecBoards{};
+		{
+			auto upPolicy = Game2048_Policy::Create("greedy", 0);
+			Game2048_Core core(0);
+			for (uint64_t g = 0; g < u64Games; ++g)
+			{
+				core.NewGame((uint32_t)(u32SeedBase + g));
+				while (core.GetStatus() == Game2048_Core::InGame)
+				{
+					vecBoards.push_back(core.GetPackedBoard());
+					core.ProcessMove((Game2048_Core::Direction)upPolicy->Choose(core.GetPackedBoard()));
+				}
+			}
+		}
+
+		if (vecBoards.empty())
+		{
+			fprintf(stderr, "Error: no boards to evaluate\n");
+			return 1;
+		}
+
+		float fSink = 0.0f;
+		double dHeuristic = Measure(heuristic, vecBoards, u64Repeat, fSink);
+		double dEmpty = Measure(Evaluator_Empty::Instance(), vecBoards, u64Repeat, fSink);
+
+		printf("Build:[%.3f ms] Boards:[%zu] Repeat:[%" PRIu64 "]\n",
+			std::chrono::duration<double, std::milli>(tpEnd - tpBeg).count(), vecBoards.size(), u64Repeat);
+		printf("heuristic %.1fM evals/s\n", dHeuristic / 1e6);
+		printf("empty     %.1fM evals/s\n", dEmpty / 1e6);
+		printf("Checksum:[%g]\n", (double)fSink);
+
+		return 0;
+	}
+};
@@ -0,0 +1,721 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Cpu_Topology.hpp"
+#include "Board_Packed.hpp"
+#include "Mapped_File.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+
+/*
+N元组网络：选取棋盘上若干组固定形状的格子（元组），每组格子的指数拼接为下标查表得到权重，
+所有元组在8种对称（旋转与镜像）下的权重之和即为局面价值。
+默认使用4个6格元组，每个元组16^6个float权重
+
+权重文件格式（小端序）：
+	[u32 魔数 'G2NT'][u16 版本][u16 元组大小][u32 元组个数][u32 保留]
+	[u8 元组格子下标 * 元组个数 * 元组大小]
+	[填充到4096字节]
+	[f32 权重表 * 元组个数 * 16^元组大小]
+权重表4096字节对齐，评估时可以直接mmap只读使用，无须读入内存
+
+多线程训练时多个线程不加锁地同时读写同一份权重（Hogwild），
+此时必须使用EvaluateAs/UpdateAs的Relaxed或Atomic版本，Save也按relaxed原子读取，可以在训练中途随时保存
+*/
+class Game2048_NTuple : public Game2048_Evaluator
+{
+public:
+	constexpr const static inline uint32_t u32Magic = 0x544E3247;//'G2NT'
+	constexpr const static inline uint16_t u16Version = 1;
+	constexpr const static inline size_t szTupleSize = 6;
+	constexpr const static inline size_t szMaxTupleCount = 8;
+	constexpr const static inline size_t szSymmetryCount = 8;
+	constexpr const static inline size_t szTableSize = (size_t)1 << (4 * szTupleSize);
+	constexpr const static inline size_t szHeaderSize = 4096;
+
+	//权重读写方式
+	enum Update_Mode
+	{
+		Update_Plain,//普通读写，只能单线程使用
+		Update_Relaxed,//relaxed原子读与写，多个线程同时更新同一权重时可能丢失其中一次（Hogwild）
+		Update_Atomic,//relaxed原子加（CAS循环），不丢失更新，冲突时稍慢
+	};
+
+	//默认元组（格子下标为y*4+x）
+	constexpr const static inline uint8_t u8DefaultTuples[][szTupleSize] =
+	{
+		{ 0, 1, 2, 3, 4, 5 },
+		{ 4, 5, 6, 7, 8, 9 },
+		{ 0, 1, 2, 4, 5, 6 },
+		{ 4, 5, 6, 8, 9, 10 },
+	};
+
+private:
+	struct File_Header
+	{
+		uint32_t u32Magic;
+		uint16_t u16Version;
+		uint16_t u16TupleSize;
+		uint32_t u32TupleCount;
+		uint32_t u32Reserved;
+		uint8_t u8Tuples[szMaxTupleCount][szTupleSize];
+	};
+
+	size_t szTupleCount;
+	uint8_t u8Tuples[szMaxTupleCount][szTupleSize];//原始元组
+	uint8_t u8Cells[szMaxTupleCount][szSymmetryCount][szTupleSize];//每种对称下的格子下标，下标0为最低4bit
+
+	const float *pTables;//szTupleCount张连续的权重表
+	std::unique_ptr<float[]> upOwned;//可写的权重（训练时）
+	Mapped_File mapFile;//只读映射的权重（评估时）
+
+private:
+	//格子下标在第szSym种对称下的位置
+	static uint8_t SymmetryCell(uint8_t u8Cell, size_t szSym)
+	{
+		size_t x = u8Cell % 4, y = u8Cell / 4;
+		if (szSym & 4)//转置
+		{
+			size_t t = x;
+			x = y;
+			y = t;
+		}
+		if (szSym & 1)//水平镜像
+		{
+			x = 3 - x;
+		}
+		if (szSym & 2)//垂直镜像
+		{
+			y = 3 - y;
+		}
+
+		return (uint8_t)(y * 4 + x);
+	}
+
+	void SetTuples(const uint8_t (*pTuples)[szTupleSize], size_t _szTupleCount)
+	{
+		szTupleCount = _szTupleCount;
+		for (size_t t = 0; t < szTupleCount; ++t)
+		{
+			for (size_t k = 0; k < szTupleSize; ++k)
+			{
+				u8Tuples[t][k] = pTuples[t][k];
+				for (size_t s = 0; s < szSymmetryCount; ++s)
+				{
+					u8Cells[t][s][k] = SymmetryCell(pTuples[t][k], s);
+				}
+			}
+		}
+	}
+
+	static float LoadWeight(const float &fWeight)
+	{
+		return std::atomic_ref<float>(const_cast<float &>(fWeight)).load(std::memory_order_relaxed);
+	}
+
+	size_t TupleIndex(Board u64Board, size_t t, size_t s) const
+	{
+		const uint8_t *pCells = u8Cells[t][s];
+		size_t szIndex = 0;
+		for (size_t k = 0; k < szTupleSize; ++k)
+		{
+			szIndex |= (size_t)Board_Packed::GetCell(u64Board, pCells[k]) << (4 * k);
+		}
+
+		return szIndex;
+	}
+
+public:
+	Game2048_NTuple(void) :
+		szTupleCount(0),
+		u8Tuples{},
+		u8Cells{},
+		pTables(nullptr),
+		upOwned(),
+		mapFile()
+	{}
+	~Game2048_NTuple(void) = default;
+
+	Game2048_NTuple(const Game2048_NTuple &) = delete;
+	Game2048_NTuple &operator=(const Game2048_NTuple &) = delete;
+
+	//分配全0的可写权重
+	void Allocate(void)
+	{
+		mapFile.Close();
+		SetTuples(u8DefaultTuples, sizeof(u8DefaultTuples) / sizeof(u8DefaultTuples[0]));
+		upOwned = std::make_unique<float[]>(szTupleCount * szTableSize);
+		pTables = upOwned.get();
+	}
+
+	//bWritable为false时只读映射文件（零拷贝），否则读入可写内存继续训练
+	bool Load(const char *pPath, bool bWritable)
+	{
+		pTables = nullptr;
+		upOwned.reset();
+
+		if (!mapFile.Open(pPath))
+		{
+			return false;
+		}
+
+		const File_Header *pHeader = mapFile.At<File_Header>(0);
+		if (pHeader == nullptr ||
+			pHeader->u32Magic != u32Magic ||
+			pHeader->u16Version != u16Version ||
+			pHeader->u16TupleSize != szTupleSize ||
+			pHeader->u32TupleCount == 0 || pHeader->u32TupleCount > szMaxTupleCount)
+		{
+			mapFile.Close();
+			return false;
+		}
+
+		SetTuples(pHeader->u8Tuples, pHeader->u32TupleCount);
+		const float *pMapped = mapFile.At<float>(szHeaderSize, szTupleCount * szTableSize);
+		if (pMapped == nullptr)
+		{
+			mapFile.Close();
+			return false;
+		}
+
+		if (bWritable)
+		{
+			upOwned = std::make_unique<float[]>(szTupleCount * szTableSize);
+			memcpy(upOwned.get(), pMapped, szTupleCount * szTableSize * sizeof(float));
+			mapFile.Close();
+			pTables = upOwned.get();
+		}
+		else
+		{
+			pTables = pMapped;
+		}
+
+		return true;
+	}
+
+	//先写临时文件再重命名，训练中途保存也不会破坏已有的权重文件，同一时间只能有一个线程保存
+	bool Save(const char *pPath) const
+	{
+		std::string strTemp = std::string(pPath) + ".tmp";
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		//局部缓冲，多个网络（或多个线程）可以同时保存
+		std::vector<uint8_t> vecHeaderPage(szHeaderSize, 0);
+
+		File_Header stHeader{};
+		stHeader.u32Magic = u32Magic;
+		stHeader.u16Version = u16Version;
+		stHeader.u16TupleSize = szTupleSize;
+		stHeader.u32TupleCount = (uint32_t)szTupleCount;
+		memcpy(stHeader.u8Tuples, u8Tuples, sizeof(u8Tuples));
+		memcpy(vecHeaderPage.data(), &stHeader, sizeof(stHeader));
+
+		bool bRet = fwrite(vecHeaderPage.data(), 1, vecHeaderPage.size(), pFile) == vecHeaderPage.size();
+
+		//按块原子读取后写出，其他线程可以同时继续更新权重
+		std::vector<float> vecBuffer(16384);
+		size_t szCount = szTupleCount * szTableSize;
+		for (size_t i = 0; bRet && i < szCount; i += vecBuffer.size())
+		{
+			size_t szBlock = szCount - i < vecBuffer.size() ? szCount - i : vecBuffer.size();
+			for (size_t k = 0; k < szBlock; ++k)
+			{
+				vecBuffer[k] = LoadWeight(pTables[i + k]);
+			}
+			bRet = fwrite(vecBuffer.data(), sizeof(float), szBlock, pFile) == szBlock;
+		}
+		bRet = fclose(pFile) == 0 && bRet;
+
+		std::error_code ec{};
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, pPath, ec);
+		}
+		if (!bRet || ec)
+		{
+			std::filesystem::remove(strTemp, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool IsWritable(void) const
+	{
+		return upOwned != nullptr;
+	}
+
+	size_t FeatureCount(void) const
+	{
+		return szTupleCount * szSymmetryCount;
+	}
+
+	template<Update_Mode enMode>
+	float EvaluateAs(Board u64Board) const
+	{
+		float fSum = 0.0f;
+		for (size_t t = 0; t < szTupleCount; ++t)
+		{
+			const float *pTable = pTables + t * szTableSize;
+			for (size_t s = 0; s < szSymmetryCount; ++s)
+			{
+				const float &fWeight = pTable[TupleIndex(u64Board, t, s)];
+				if constexpr (enMode == Update_Plain)
+				{
+					fSum += fWeight;
+				}
+				else
+				{
+					fSum += LoadWeight(fWeight);
+				}
+			}
+		}
+
+		return fSum;
+	}
+
+	//每个特征的权重都加上fDelta，只能用于可写权重
+	template<Update_Mode enMode>
+	void UpdateAs(Board u64Board, float fDelta)
+	{
+		float *pWritable = upOwned.get();
+		for (size_t t = 0; t < szTupleCount; ++t)
+		{
+			float *pTable = pWritable + t * szTableSize;
+			for (size_t s = 0; s < szSymmetryCount; ++s)
+			{
+				float &fWeight = pTable[TupleIndex(u64Board, t, s)];
+				if constexpr (enMode == Update_Plain)
+				{
+					fWeight += fDelta;
+				}
+				else if constexpr (enMode == Update_Relaxed)
+				{
+					std::atomic_ref<float> arWeight(fWeight);
+					arWeight.store(arWeight.load(std::memory_order_relaxed) + fDelta, std::memory_order_relaxed);
+				}
+				else
+				{
+					std::atomic_ref<float>(fWeight).fetch_add(fDelta, std::memory_order_relaxed);
+				}
+			}
+		}
+	}
+
+	float Evaluate(Board u64Board) const override
+	{
+		return EvaluateAs<Update_Plain>(u64Board);
+	}
+
+	void Update(Board u64Board, float fDelta)
+	{
+		UpdateAs<Update_Plain>(u64Board, fDelta);
+	}
+};
+
+/*
+TD(0)自我对弈训练（学习移动后棋盘的价值）：
+	每步选择 得分+V(移动后棋盘) 最大的方向，
+	用 本步得分+V(本次移动后棋盘) 作为上一次移动后棋盘的目标值，V(上一次) += α*(目标-V(上一次))，
+	对局结束时上一次移动后棋盘的目标值为0
+环境使用无界面的Game2048_Core_Basic与endless规则（到达2048后继续，否则价值函数学不到2048之后的局面），
+	每一局都可以用种子与移动序列在同一规则下回放，WinRate为到达过2048的比例
+
+单线程时第i局的种子为起始种子+i，结果可复现；
+--threads大于1时每个线程各自对弈（各自的引擎与随机数），不加锁地同时更新共享权重，结果不再可复现：
+	--update relaxed 原子读写，偶尔丢失并发的更新（默认，最快）
+	--update atomic  原子加，不丢失更新
+	每--checkpoint秒由主线程保存一次权重，保存时工作线程不停止
+	--pin 多线程时按NUMA拓扑（见Cpu_Topology.hpp）把工作线程绑定到CPU，结束时输出各节点的吞吐；
+		权重是所有线程共同写入的同一份，无法按节点复制
+
+用法：
+	Game2048 train [--epochs E] [--games 每轮局数] [--alpha α] [--seed S] [--weights 输出文件] [--init 初始权重]
+		[--threads T] [--update relaxed|atomic] [--checkpoint 秒] [--pin]
+*/
+class Game2048_NTuple_Trainer
+{
+public:
+	using Train_Core = Game2048_Core_Basic<Game2048_Rules_Endless>;
+
+	struct Epoch_Result
+	{
+		uint64_t u64Games = 0;
+		uint64_t u64Moves = 0;
+		uint64_t u64ScoreSum = 0;
+		uint64_t u64Wins = 0;
+		uint8_t u8MaxExponent = 0;
+	};
+
+private:
+	struct Shared
+	{
+		Game2048_NTuple &ntuple;
+		const float fAlpha;
+		const uint32_t u32SeedBase;
+		const uint64_t u64TotalGames;
+		const Cpu_Topology *const pTopology;//非空时绑定工作线程
+
+		std::atomic<uint64_t> u64NextGame{ 0 };
+		//每局结束时累加一次，不影响吞吐
+		std::atomic<uint64_t> u64Games{ 0 };
+		std::atomic<uint64_t> u64Moves{ 0 };
+		std::atomic<uint64_t> u64ScoreSum{ 0 };
+		std::atomic<uint64_t> u64Wins{ 0 };
+		std::atomic<uint8_t> u8MaxExponent{ 0 };
+
+		//每个节点的工作线程数与对局结果，线程结束时合并
+		std::mutex mtxNodes;
+		std::vector<uint32_t> vecNodeWorkers;
+		std::vector<Epoch_Result> vecNodeResults;
+
+		Shared(Game2048_NTuple &_ntuple, float _fAlpha, uint32_t _u32SeedBase, uint64_t _u64TotalGames, const Cpu_Topology *_pTopology) :
+			ntuple(_ntuple),
+			fAlpha(_fAlpha),
+			u32SeedBase(_u32SeedBase),
+			u64TotalGames(_u64TotalGames),
+			pTopology(_pTopology),
+			vecNodeWorkers(_pTopology != nullptr ? _pTopology->NodeCount() : 1),
+			vecNodeResults(_pTopology != nullptr ? _pTopology->NodeCount() : 1)
+		{}
+
+		Epoch_Result Get(void) const
+		{
+			Epoch_Result stResult{};
+			stResult.u64Games = u64Games.load(std::memory_order_relaxed);
+			stResult.u64Moves = u64Moves.load(std::memory_order_relaxed);
+			stResult.u64ScoreSum = u64ScoreSum.load(std::memory_order_relaxed);
+			stResult.u64Wins = u64Wins.load(std::memory_order_relaxed);
+			return stResult;
+		}
+	};
+
+	template<Game2048_NTuple::Update_Mode enMode>
+	static void Worker(Shared &stShared, uint32_t u32WorkerIndex)
+	{
+		Cpu_Topology::Slot stSlot{};
+		if (stShared.pTopology != nullptr)
+		{
+			stSlot = stShared.pTopology->SlotOf(u32WorkerIndex);
+			Cpu_Topology::PinCurrentThread(stSlot.u32Cpu);
+		}
+
+		Train_Core core(0);
+		Epoch_Result stNodeLocal{};
+		while (true)
+		{
+			uint64_t u64Game = stShared.u64NextGame.fetch_add(1, std::memory_order_relaxed);
+			if (u64Game >= stShared.u64TotalGames)
+			{
+				break;
+			}
+
+			Epoch_Result stLocal{};
+			TrainGame<enMode>(stShared.ntuple, core, (uint32_t)(stShared.u32SeedBase + u64Game), stShared.fAlpha, stLocal);
+
+			stShared.u64Moves.fetch_add(stLocal.u64Moves, std::memory_order_relaxed);
+			stShared.u64ScoreSum.fetch_add(stLocal.u64ScoreSum, std::memory_order_relaxed);
+			stShared.u64Wins.fetch_add(stLocal.u64Wins, std::memory_order_relaxed);
+			uint8_t u8Max = stShared.u8MaxExponent.load(std::memory_order_relaxed);
+			while (stLocal.u8MaxExponent > u8Max && !stShared.u8MaxExponent.compare_exchange_weak(u8Max, stLocal.u8MaxExponent, std::memory_order_relaxed))
+			{
+				continue;
+			}
+			stShared.u64Games.fetch_add(1, std::memory_order_relaxed);
+
+			++stNodeLocal.u64Games;
+			stNodeLocal.u64Moves += stLocal.u64Moves;
+		}
+
+		std::lock_guard<std::mutex> lock(stShared.mtxNodes);
+		++stShared.vecNodeWorkers[stSlot.szNode];
+		stShared.vecNodeResults[stSlot.szNode].u64Games += stNodeLocal.u64Games;
+		stShared.vecNodeResults[stSlot.szNode].u64Moves += stNodeLocal.u64Moves;
+	}
+
+	//定时保存线程，与工作线程并行读取权重
+	static void Checkpoint(const Game2048_NTuple &ntuple, const char *pWeights, double dCheckpointSeconds, const std::atomic<bool> &bStop, std::atomic<bool> &bFailed)
+	{
+		auto tpLast = std::chrono::steady_clock::now();
+		while (!bStop.load(std::memory_order_relaxed))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			if (std::chrono::duration<double>(std::chrono::steady_clock::now() - tpLast).count() < dCheckpointSeconds)
+			{
+				continue;
+			}
+
+			if (!ntuple.Save(pWeights))
+			{
+				fprintf(stderr, "Error: cannot save checkpoint [%s]\n", pWeights);
+				bFailed.store(true, std::memory_order_relaxed);
+			}
+			tpLast = std::chrono::steady_clock::now();
+		}
+	}
+
+	//多线程训练，轮次按完成的局数划分，主线程负责输出
+	static bool TrainParallel(Game2048_NTuple &ntuple, uint32_t u32Threads, Game2048_NTuple::Update_Mode enMode, uint64_t u64Epochs, uint64_t u64Games,
+		float fAlpha, uint32_t u32SeedBase, const char *pWeights, double dCheckpointSeconds, const Cpu_Topology *pTopology)
+	{
+		Shared stShared(ntuple, fAlpha, u32SeedBase, u64Epochs * u64Games, pTopology);
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		std::vector<std::thread> vecThreads;
+		for (uint32_t i = 0; i < u32Threads; ++i)
+		{
+			vecThreads.emplace_back(enMode == Game2048_NTuple::Update_Atomic ? Worker<Game2048_NTuple::Update_Atomic> : Worker<Game2048_NTuple::Update_Relaxed>, std::ref(stShared), i);
+		}
+
+		std::atomic<bool> bStop{ false };
+		std::atomic<bool> bFailed{ false };
+		std::thread thCheckpoint(Checkpoint, std::cref(ntuple), pWeights, dCheckpointSeconds, std::cref(bStop), std::ref(bFailed));
+
+		Epoch_Result stLast{};
+		auto tpEpoch = std::chrono::steady_clock::now();
+		for (uint64_t e = 0; e < u64Epochs;)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			auto tpNow = std::chrono::steady_clock::now();
+			Epoch_Result stNow = stShared.Get();
+			if (stNow.u64Games >= (e + 1) * u64Games)
+			{
+				Epoch_Result stDelta{};
+				stDelta.u64Games = stNow.u64Games - stLast.u64Games;
+				stDelta.u64Moves = stNow.u64Moves - stLast.u64Moves;
+				stDelta.u64ScoreSum = stNow.u64ScoreSum - stLast.u64ScoreSum;
+				stDelta.u64Wins = stNow.u64Wins - stLast.u64Wins;
+				stDelta.u8MaxExponent = stShared.u8MaxExponent.exchange(0, std::memory_order_relaxed);
+				PrintEpoch(e, stDelta, std::chrono::duration<double>(tpNow - tpEpoch).count());
+
+				//一次等待可能跨过多轮，剩下的轮次合并到本轮输出中
+				while (e < u64Epochs && stNow.u64Games >= (e + 1) * u64Games)
+				{
+					++e;
+				}
+				stLast = stNow;
+				tpEpoch = tpNow;
+			}
+		}
+
+		for (auto &it : vecThreads)
+		{
+			it.join();
+		}
+		bStop.store(true, std::memory_order_relaxed);
+		thCheckpoint.join();
+
+		if (pTopology != nullptr)
+		{
+			double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tpBeg).count();
+			for (size_t i = 0; i < stShared.vecNodeResults.size(); ++i)
+			{
+				const Epoch_Result &stNode = stShared.vecNodeResults[i];
+				uint32_t u32Workers = stShared.vecNodeWorkers[i];
+				printf("Node:[%" PRIu32 "] Workers:[%" PRIu32 "] Games:[%" PRIu64 "] Moves:[%" PRIu64 "] %.0f moves/s, %.0f moves/s per worker\n",
+					pTopology->GetNode(i).u32Id, u32Workers, stNode.u64Games, stNode.u64Moves,
+					stNode.u64Moves / dSeconds, u32Workers != 0 ? stNode.u64Moves / dSeconds / u32Workers : 0.0);
+			}
+		}
+
+		return !bFailed.load(std::memory_order_relaxed);
+	}
+
+public:
+	//训练一局，fAlpha已除以特征数
+	template<Game2048_NTuple::Update_Mode enMode = Game2048_NTuple::Update_Plain>
+	static void TrainGame(Game2048_NTuple &ntuple, Train_Core &core, uint32_t u32Seed, float fAlpha, Epoch_Result &stResult)
+	{
+		core.NewGame(u32Seed);
+
+		bool bHasPrev = false;
+		Board_Packed::Board u64PrevAfter = 0;
+
+		while (core.GetStatus() == Train_Core::InGame)
+		{
+			Board_Packed::Board u64Board = core.GetPackedBoard();
+
+			//选择得分加移动后价值最大的方向
+			Board_Packed::Direction dBest = Board_Packed::Enum_End;
+			Board_Packed::Board u64BestAfter = 0;
+			float fBestValue = 0.0f;
+			float fBestAfterValue = 0.0f;
+			uint32_t u32BestScore = 0;
+
+			for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+			{
+				uint32_t u32Score = 0;
+				Board_Packed::Board u64After = Board_Packed::Move(u64Board, (Board_Packed::Direction)d, u32Score);
+				if (u64After == u64Board)
+				{
+					continue;
+				}
+
+				float fAfterValue = ntuple.EvaluateAs<enMode>(u64After);
+				float fValue = (float)u32Score + fAfterValue;
+				if (dBest == Board_Packed::Enum_End || fValue > fBestValue)
+				{
+					fBestValue = fValue;
+					fBestAfterValue = fAfterValue;
+					u64BestAfter = u64After;
+					u32BestScore = u32Score;
+					dBest = (Board_Packed::Direction)d;
+				}
+			}
+
+			if (bHasPrev)
+			{
+				float fError = (float)u32BestScore + fBestAfterValue - ntuple.EvaluateAs<enMode>(u64PrevAfter);
+				ntuple.UpdateAs<enMode>(u64PrevAfter, fAlpha * fError);
+			}
+
+			bHasPrev = true;
+			u64PrevAfter = u64BestAfter;
+
+			if (dBest == Board_Packed::Enum_End || !core.ProcessMove((Train_Core::Direction)dBest))
+			{
+				break;//状态为InGame时必然存在有效方向，这里仅作保护
+			}
+			++stResult.u64Moves;
+		}
+
+		//终局：没有后续价值
+		if (bHasPrev)
+		{
+			ntuple.UpdateAs<enMode>(u64PrevAfter, fAlpha * (0.0f - ntuple.EvaluateAs<enMode>(u64PrevAfter)));
+		}
+
+		Board_Packed::Board u64Final = core.GetPackedBoard();
+		uint8_t u8MaxExp = Board_Packed::MaxExponent(u64Final);
+
+		++stResult.u64Games;
+		stResult.u64ScoreSum += core.GetScore();
+		stResult.u64Wins += core.HasReachedWin();
+		stResult.u8MaxExponent = u8MaxExp > stResult.u8MaxExponent ? u8MaxExp : stResult.u8MaxExponent;
+	}
+
+	static void PrintEpoch(uint64_t u64Epoch, const Epoch_Result &stResult, double dSeconds)
+	{
+		printf("Epoch:[%" PRIu64 "] Games:[%" PRIu64 "] AvgScore:[%.1f] WinRate:[%.2f%%] MaxTile:[%" PRIu64 "] %.0f games/s, %.0f moves/s\n",
+			u64Epoch, stResult.u64Games,
+			(double)stResult.u64ScoreSum / stResult.u64Games,
+			100.0 * stResult.u64Wins / stResult.u64Games,
+			Board_Packed::ExponentToValue(stResult.u8MaxExponent),
+			stResult.u64Games / dSeconds, stResult.u64Moves / dSeconds);
+		fflush(stdout);
+	}
+
+	static int Main(const Command_Line &cmd)
+	{
+		uint64_t u64Epochs = cmd.GetU64("epochs", 10);
+		uint64_t u64Games = cmd.GetU64("games", 10000);
+		double dAlpha = cmd.GetDouble("alpha", 0.1);
+		uint32_t u32SeedBase = (uint32_t)cmd.GetU64("seed", 0);
+		const char *pWeights = cmd.GetString("weights", "Game2048.ntw");
+		const char *pInit = cmd.GetString("init");
+		uint32_t u32Threads = (uint32_t)cmd.GetU64("threads", 1);//0为硬件线程数
+		std::string_view svUpdate = cmd.GetString("update", "relaxed");
+		double dCheckpointSeconds = cmd.GetDouble("checkpoint", 60.0);
+		bool bPin = cmd.HasFlag("pin");
+
+		u32Threads = u32Threads != 0 ? u32Threads : std::thread::hardware_concurrency();
+		u32Threads = u32Threads != 0 ? u32Threads : 1;
+
+		if (u64Games == 0)
+		{
+			fprintf(stderr, "Error: nothing to train\n");
+			return 1;
+		}
+
+		Game2048_NTuple::Update_Mode enMode;
+		if (svUpdate == "relaxed")
+		{
+			enMode = Game2048_NTuple::Update_Relaxed;
+		}
+		else if (svUpdate == "atomic")
+		{
+			enMode = Game2048_NTuple::Update_Atomic;
+		}
+		else
+		{
+			fprintf(stderr, "Error: unknown update mode [%.*s]\n", (int)svUpdate.size(), svUpdate.data());
+			return 1;
+		}
+
+		auto upNTuple = std::make_unique<Game2048_NTuple>();
+		if (pInit != nullptr)
+		{
+			if (!upNTuple->Load(pInit, true))
+			{
+				fprintf(stderr, "Error: cannot load weights [%s]\n", pInit);
+				return 1;
+			}
+		}
+		else
+		{
+			upNTuple->Allocate();
+		}
+
+		float fAlpha = (float)(dAlpha / upNTuple->FeatureCount());
+
+		if (u32Threads > 1)
+		{
+			Cpu_Topology topology{};
+			if (bPin)
+			{
+				topology.Discover();
+				topology.Print(stdout);
+			}
+			if (!TrainParallel(*upNTuple, u32Threads, enMode, u64Epochs, u64Games, fAlpha, u32SeedBase, pWeights, dCheckpointSeconds, bPin ? &topology : nullptr) ||
+				!upNTuple->Save(pWeights))
+			{
+				fprintf(stderr, "Error: cannot save weights [%s]\n", pWeights);
+				return 1;
+			}
+			return 0;
+		}
+
+		Train_Core core(0);
+
+		for (uint64_t e = 0; e < u64Epochs; ++e)
+		{
+			Epoch_Result stResult{};
+			auto tpBeg = std::chrono::steady_clock::now();
+			for (uint64_t g = 0; g < u64Games; ++g)
+			{
+				TrainGame(*upNTuple, core, (uint32_t)(u32SeedBase + e * u64Games + g), fAlpha, stResult);
+			}
+			auto tpEnd = std::chrono::steady_clock::now();
+
+			PrintEpoch(e, stResult, std::chrono::duration<double>(tpEnd - tpBeg).count());
+
+			if (!upNTuple->Save(pWeights))
+			{
+				fprintf(stderr, "Error: cannot save weights [%s]\n", pWeights);
+				return 1;
+			}
+		}
+
+		return 0;
+	}
+};
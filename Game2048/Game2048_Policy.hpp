@@ -0,0 +1,498 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+#include "Board_Packed.hpp"
+#include "Game2048_Book.hpp"
+#include "Fast_Rand.hpp"
+
+//局面评估：估计一个移动后（生成数字前）的棋盘之后还能获得的分数，必须可以被多个线程同时调用
+class Game2048_Evaluator
+{
+public:
+	using Board = Board_Packed::Board;
+
+public:
+	virtual ~Game2048_Evaluator(void) = default;
+
+	virtual float Evaluate(Board u64Board) const = 0;
+};
+
+//默认评估：只看空格子数，没有提供其它评估时使用
+class Evaluator_Empty : public Game2048_Evaluator
+{
+public:
+	float Evaluate(Board u64Board) const override
+	{
+		return (float)Board_Packed::CountEmpty(u64Board) * 64.0f;
+	}
+
+	static const Evaluator_Empty &Instance(void)
+	{
+		static const Evaluator_Empty stInstance{};
+		return stInstance;
+	}
+};
+
+//AI策略：根据压缩棋盘选择一个移动方向，调用时棋盘必须至少存在一个有效方向
+//策略对象可能带有状态（随机数、缓存等），每个线程各自持有一个实例
+class Game2048_Policy
+{
+public:
+	using Board = Board_Packed::Board;
+	using Direction = Board_Packed::Direction;
+
+	//创建策略时的共享参数，指针指向的对象由调用方持有，生存期必须长于策略
+	struct Context
+	{
+		const Game2048_Evaluator *pEvaluator = nullptr;//为空则使用Evaluator_Empty（ntuple策略必须提供）
+		uint32_t u32Depth = 2;//expectimax搜索的移动层数
+		bool bCanonical = true;//expectimax缓存以对称规范形式为键（评估函数必须对称不变）
+		uint32_t u32Rollouts = 32;//montecarlo每个方向的随机模拟局数
+		const Game2048_Book *pBook = nullptr;//开局库，非空时任何策略都先查库，命中则不再搜索
+	};
+
+	//开局库的查询统计
+	struct Book_Stats
+	{
+		uint64_t u64Lookups = 0;
+		uint64_t u64Hits = 0;
+	};
+
+public:
+	virtual ~Game2048_Policy(void) = default;
+
+	virtual const char *Name(void) const = 0;
+	virtual Direction Choose(Board u64Board) = 0;
+
+	//没有使用开局库的策略返回nullptr
+	virtual const Book_Stats *GetBookStats(void) const
+	{
+		return nullptr;
+	}
+
+	//按名称创建策略，不存在（或缺少必须的参数）返回nullptr
+	static std::unique_ptr<Game2048_Policy> Create(std::string_view svName, uint64_t u64Seed, const Context &stContext);
+	static std::unique_ptr<Game2048_Policy> Create(std::string_view svName, uint64_t u64Seed);
+};
+
+//随机选择一个有效方向
+class Policy_Random : public Game2048_Policy
+{
+private:
+	Fast_Rand randGen;
+
+public:
+	Policy_Random(uint64_t u64Seed) :
+		randGen(u64Seed)
+	{}
+
+	const char *Name(void) const override
+	{
+		return "random";
+	}
+
+	Direction Choose(Board u64Board) override
+	{
+		uint8_t u8Mask = Board_Packed::LegalMoves(u64Board);
+		uint32_t u32Nth = randGen.Below((uint32_t)std::popcount(u8Mask));
+
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			if ((u8Mask & (1 << d)) != 0 && u32Nth-- == 0)
+			{
+				return (Direction)d;
+			}
+		}
+
+		return Board_Packed::Up;
+	}
+};
+
+//贪心：选择本步得分最高的方向，分数相同则选择空格子更多的
+class Policy_Greedy : public Game2048_Policy
+{
+public:
+	const char *Name(void) const override
+	{
+		return "greedy";
+	}
+
+	Direction Choose(Board u64Board) override
+	{
+		Direction dBest = Board_Packed::Up;
+		int64_t i64BestValue = -1;
+
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			uint32_t u32Score = 0;
+			Board u64Next = Board_Packed::Move(u64Board, (Direction)d, u32Score);
+			if (u64Next == u64Board)
+			{
+				continue;
+			}
+
+			int64_t i64Value = (int64_t)u32Score * 16 + (int64_t)Board_Packed::CountEmpty(u64Next);
+			if (i64Value > i64BestValue)
+			{
+				i64BestValue = i64Value;
+				dBest = (Direction)d;
+			}
+		}
+
+		return dBest;
+	}
+};
+
+//一层贪心：选择 本步得分+评估(移动后棋盘) 最大的方向，即TD学习时使用的选择方式
+class Policy_Afterstate : public Game2048_Policy
+{
+private:
+	const Game2048_Evaluator &evaluator;
+
+public:
+	Policy_Afterstate(const Game2048_Evaluator &_evaluator) :
+		evaluator(_evaluator)
+	{}
+
+	const char *Name(void) const override
+	{
+		return "ntuple";
+	}
+
+	Direction Choose(Board u64Board) override
+	{
+		Direction dBest = Board_Packed::Up;
+		float fBestValue = -std::numeric_limits<float>::infinity();//评估值可能为负
+
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			uint32_t u32Score = 0;
+			Board u64After = Board_Packed::Move(u64Board, (Direction)d, u32Score);
+			if (u64After == u64Board)
+			{
+				continue;
+			}
+
+			float fValue = (float)u32Score + evaluator.Evaluate(u64After);
+			if (fValue > fBestValue)
+			{
+				fBestValue = fValue;
+				dBest = (Direction)d;
+			}
+		}
+
+		return dBest;
+	}
+};
+
+//期望最大搜索：移动层取最大，生成层按概率（90%为2，10%为4，位置均匀）取期望，
+//到达深度或者路径概率过低时用评估函数估值，同一次选择内用缓存合并重复局面，
+//缓存键默认使用对称规范形式，8个互相对称的局面共用一项
+class Policy_Expectimax : public Game2048_Policy
+{
+public:
+	struct Cache_Stats
+	{
+		uint64_t u64Lookups = 0;
+		uint64_t u64Hits = 0;
+		uint64_t u64Entries = 0;//每次选择结束时缓存项数之和
+	};
+
+private:
+	struct Cache_Entry
+	{
+		uint32_t u32Depth;
+		float fValue;
+	};
+
+	constexpr const static inline float fProbThreshold = 0.0001f;
+
+	const Game2048_Evaluator &evaluator;
+	uint32_t u32Depth;
+	bool bCanonical;
+	std::unordered_map<Board, Cache_Entry> mapCache;//生成层的缓存
+	Cache_Stats stStats;
+
+private:
+	//移动层
+	float MaxNode(Board u64Board, uint32_t u32Remain, float fProb)
+	{
+		float fBest = -std::numeric_limits<float>::infinity();
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			uint32_t u32Score = 0;
+			Board u64After = Board_Packed::Move(u64Board, (Direction)d, u32Score);
+			if (u64After == u64Board)
+			{
+				continue;
+			}
+
+			float fValue = (float)u32Score + ChanceNode(u64After, u32Remain - 1, fProb);
+			fBest = fValue > fBest ? fValue : fBest;
+		}
+
+		return fBest != -std::numeric_limits<float>::infinity() ? fBest : 0.0f;//没有有效移动（死局）则为0
+	}
+
+	//生成层（u64Board为移动后的棋盘）
+	float ChanceNode(Board u64Board, uint32_t u32Remain, float fProb)
+	{
+		if (u32Remain == 0 || fProb < fProbThreshold)
+		{
+			return evaluator.Evaluate(u64Board);
+		}
+
+		Board u64Key = bCanonical ? Board_Packed::Canonical(u64Board) : u64Board;
+		++stStats.u64Lookups;
+		auto it = mapCache.find(u64Key);
+		if (it != mapCache.end() && it->second.u32Depth >= u32Remain)
+		{
+			++stStats.u64Hits;
+			return it->second.fValue;
+		}
+
+		size_t szEmpty = Board_Packed::CountEmpty(u64Board);
+		float fSum = 0.0f;
+		for (size_t i = 0; i < Board_Packed::szTotalSize; ++i)
+		{
+			if (Board_Packed::GetCell(u64Board, i) != 0)
+			{
+				continue;
+			}
+
+			fSum += 0.9f * MaxNode(Board_Packed::SetCell(u64Board, i, 1), u32Remain, fProb * 0.9f / szEmpty);
+			fSum += 0.1f * MaxNode(Board_Packed::SetCell(u64Board, i, 2), u32Remain, fProb * 0.1f / szEmpty);
+		}
+
+		float fValue = szEmpty != 0 ? fSum / szEmpty : 0.0f;
+		mapCache[u64Key] = { u32Remain, fValue };
+
+		return fValue;
+	}
+
+public:
+	Policy_Expectimax(const Game2048_Evaluator &_evaluator, uint32_t _u32Depth, bool _bCanonical) :
+		evaluator(_evaluator),
+		u32Depth(_u32Depth != 0 ? _u32Depth : 1),
+		bCanonical(_bCanonical),
+		mapCache(),
+		stStats()
+	{}
+
+	const Cache_Stats &GetCacheStats(void) const
+	{
+		return stStats;
+	}
+
+	const char *Name(void) const override
+	{
+		return "expectimax";
+	}
+
+	Direction Choose(Board u64Board) override
+	{
+		float fValue;
+		return Choose(u64Board, fValue);
+	}
+
+	//同时返回所选方向的期望值（本步得分+之后的期望得分），构建开局库时使用
+	Direction Choose(Board u64Board, float &fValue)
+	{
+		mapCache.clear();
+
+		Direction dBest = Board_Packed::Up;
+		float fBestValue = -std::numeric_limits<float>::infinity();//评估值可能为负
+
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			uint32_t u32Score = 0;
+			Board u64After = Board_Packed::Move(u64Board, (Direction)d, u32Score);
+			if (u64After == u64Board)
+			{
+				continue;
+			}
+
+			float fValue = (float)u32Score + ChanceNode(u64After, u32Depth - 1, 1.0f);
+			if (fValue > fBestValue)
+			{
+				fBestValue = fValue;
+				dBest = (Direction)d;
+			}
+		}
+
+		stStats.u64Entries += mapCache.size();
+
+		fValue = fBestValue != -std::numeric_limits<float>::infinity() ? fBestValue : 0.0f;
+		return dBest;
+	}
+};
+
+//蒙特卡洛：每个有效方向各进行若干局随机模拟直到无法移动，选择 本步得分+模拟平均得分 最大的方向
+class Policy_MonteCarlo : public Game2048_Policy
+{
+private:
+	Fast_Rand randGen;
+	uint32_t u32Rollouts;
+
+private:
+	//从生成数字前的棋盘开始随机走到底，返回获得的分数
+	uint64_t Rollout(Board u64Board)
+	{
+		uint64_t u64Score = 0;
+		while (true)
+		{
+			u64Board = Board_Packed::SpawnRandom(u64Board, randGen);
+
+			uint8_t u8Mask = Board_Packed::LegalMoves(u64Board);
+			if (u8Mask == 0)
+			{
+				return u64Score;
+			}
+
+			uint32_t u32Nth = randGen.Below((uint32_t)std::popcount(u8Mask));
+			uint8_t d = 0;
+			while ((u8Mask & (1 << d)) == 0 || u32Nth-- != 0)
+			{
+				++d;
+			}
+
+			uint32_t u32Score = 0;
+			u64Board = Board_Packed::Move(u64Board, (Direction)d, u32Score);
+			u64Score += u32Score;
+		}
+	}
+
+public:
+	Policy_MonteCarlo(uint64_t u64Seed, uint32_t _u32Rollouts) :
+		randGen(u64Seed),
+		u32Rollouts(_u32Rollouts != 0 ? _u32Rollouts : 1)
+	{}
+
+	const char *Name(void) const override
+	{
+		return "montecarlo";
+	}
+
+	Direction Choose(Board u64Board) override
+	{
+		Direction dBest = Board_Packed::Up;
+		uint64_t u64BestValue = 0;
+		bool bFound = false;
+
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			uint32_t u32Score = 0;
+			Board u64After = Board_Packed::Move(u64Board, (Direction)d, u32Score);
+			if (u64After == u64Board)
+			{
+				continue;
+			}
+
+			//各方向模拟局数相同，直接比较总和
+			uint64_t u64Value = (uint64_t)u32Score * u32Rollouts;
+			for (uint32_t r = 0; r < u32Rollouts; ++r)
+			{
+				u64Value += Rollout(u64After);
+			}
+
+			if (!bFound || u64Value > u64BestValue)
+			{
+				u64BestValue = u64Value;
+				dBest = (Direction)d;
+				bFound = true;
+			}
+		}
+
+		return dBest;
+	}
+};
+
+//开局库：先查库，命中且方向有效则直接返回，否则交给内部策略
+//库为只读映射，查找不加锁，所有线程的策略实例共用同一个库对象
+class Policy_Book : public Game2048_Policy
+{
+private:
+	const Game2048_Book &book;
+	std::unique_ptr<Game2048_Policy> upInner;
+	Book_Stats stStats;
+
+public:
+	Policy_Book(const Game2048_Book &_book, std::unique_ptr<Game2048_Policy> _upInner) :
+		book(_book),
+		upInner(std::move(_upInner)),
+		stStats()
+	{}
+
+	const Book_Stats *GetBookStats(void) const override
+	{
+		return &stStats;
+	}
+
+	const char *Name(void) const override
+	{
+		return upInner->Name();
+	}
+
+	Direction Choose(Board u64Board) override
+	{
+		++stStats.u64Lookups;
+
+		Direction dMove;
+		float fValue;
+		if (book.Lookup(u64Board, dMove, fValue) && Board_Packed::Move(u64Board, dMove) != u64Board)
+		{
+			++stStats.u64Hits;
+			return dMove;
+		}
+
+		return upInner->Choose(u64Board);
+	}
+};
+
+inline std::unique_ptr<Game2048_Policy> Game2048_Policy::Create(std::string_view svName, uint64_t u64Seed, const Context &stContext)
+{
+	if (stContext.pBook != nullptr)
+	{
+		Context stInner = stContext;
+		stInner.pBook = nullptr;
+
+		auto upInner = Create(svName, u64Seed, stInner);
+		return upInner != nullptr ? std::make_unique<Policy_Book>(*stContext.pBook, std::move(upInner)) : nullptr;
+	}
+
+	const Game2048_Evaluator &evaluator = stContext.pEvaluator != nullptr ? *stContext.pEvaluator : Evaluator_Empty::Instance();
+
+	if (svName == "random")
+	{
+		return std::make_unique<Policy_Random>(u64Seed);
+	}
+	else if (svName == "greedy")
+	{
+		return std::make_unique<Policy_Greedy>();
+	}
+	else if (svName == "montecarlo")
+	{
+		return std::make_unique<Policy_MonteCarlo>(u64Seed, stContext.u32Rollouts);
+	}
+	else if (svName == "ntuple" && stContext.pEvaluator != nullptr)
+	{
+		return std::make_unique<Policy_Afterstate>(evaluator);
+	}
+	else if (svName == "expectimax")
+	{
+		return std::make_unique<Policy_Expectimax>(evaluator, stContext.u32Depth, stContext.bCanonical);
+	}
+
+	return nullptr;
+}
+
+inline std::unique_ptr<Game2048_Policy> Game2048_Policy::Create(std::string_view svName, uint64_t u64Seed)
+{
+	return Create(svName, u64Seed, Context{});
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Command_Line.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_NTuple.hpp"
+#include "Game2048_Heuristic.hpp"
+#include "Game2048_Book.hpp"
+
+/*
+各模式共用的策略参数：从命令行读取并加载，结果填入Context
+	--depth D        expectimax搜索的移动层数
+	--rollouts R     montecarlo每个方向的模拟局数
+	--weights 文件   N元组网络权重作为评估函数
+	--heuristic 值   行表启发评估（default或权重文件），不能与--weights同时使用
+	--book 文件      开局库（仅在Load时要求读取开局库的模式中有效）
+评估函数与开局库由本对象持有，Context中的指针指向它们，所以本对象的生存期必须长于用Context创建的策略
+*/
+class Game2048_Policy_Options
+{
+public:
+	Game2048_Policy::Context stContext;
+
+private:
+	Game2048_NTuple ntuple;
+	Game2048_Heuristic heuristic;
+	Game2048_Book book;
+	const char *pWeightsPath;
+	const char *pHeuristicPath;
+	const char *pBookPath;
+
+public:
+	Game2048_Policy_Options(void) :
+		stContext(),
+		ntuple(),
+		heuristic(),
+		book(),
+		pWeightsPath(nullptr),
+		pHeuristicPath(nullptr),
+		pBookPath(nullptr)
+	{}
+	~Game2048_Policy_Options(void) = default;
+
+	Game2048_Policy_Options(const Game2048_Policy_Options &) = delete;
+	Game2048_Policy_Options &operator=(const Game2048_Policy_Options &) = delete;
+
+	//失败时已向stderr输出原因
+	bool Load(const Command_Line &cmd, bool bWithBook)
+	{
+		stContext.u32Depth = (uint32_t)cmd.GetU64("depth", stContext.u32Depth);
+		stContext.u32Rollouts = (uint32_t)cmd.GetU64("rollouts", stContext.u32Rollouts);
+
+		pWeightsPath = cmd.GetString("weights");
+		if (pWeightsPath != nullptr)
+		{
+			if (!ntuple.Load(pWeightsPath, false))
+			{
+				fprintf(stderr, "Error: cannot load weights [%s]\n", pWeightsPath);
+				return false;
+			}
+			stContext.pEvaluator = &ntuple;
+		}
+
+		pHeuristicPath = cmd.GetString("heuristic");
+		if (pHeuristicPath != nullptr)
+		{
+			if (pWeightsPath != nullptr)
+			{
+				fprintf(stderr, "Error: --weights and --heuristic cannot be used together\n");
+				return false;
+			}
+			if (!heuristic.LoadOption(pHeuristicPath))
+			{
+				return false;
+			}
+			stContext.pEvaluator = &heuristic;
+		}
+
+		pBookPath = bWithBook ? cmd.GetString("book") : nullptr;
+		if (pBookPath != nullptr)
+		{
+			if (!book.Open(pBookPath))
+			{
+				fprintf(stderr, "Error: cannot open book [%s]\n", pBookPath);
+				return false;
+			}
+			stContext.pBook = &book;
+		}
+
+		return true;
+	}
+
+	const char *GetWeightsPath(void) const
+	{
+		return pWeightsPath;
+	}
+
+	const char *GetHeuristicPath(void) const
+	{
+		return pHeuristicPath;
+	}
+
+	const char *GetBookPath(void) const
+	{
+		return pBookPath;
+	}
+
+	const Game2048_Book &GetBook(void) const
+	{
+		return book;
+	}
+};
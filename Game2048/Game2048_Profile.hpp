@@ -0,0 +1,209 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+#include "Log_Histogram.hpp"
+
+/*
+热路径耗时统计：按阶段记录到HDR风格的直方图（见Log_Histogram.hpp，相对误差约3%），退出时输出各阶段的分位数
+
+计时使用TSC（x86上的rdtsc，其它平台退化为steady_clock纳秒），启用时与退出时各对照steady_clock一次换算为纳秒
+每个线程各自持有一组直方图，记录时没有任何同步，输出时合并（此时所有工作线程必须已经结束）
+
+未启用时每个计时点只有一次对全局开关的判断，不读时钟也不写内存
+Game2048_Core中的计时点（ProcessMove与Spawn）用Scope_If按实例化编译：只有交互模式的引擎（Game2048_Core_Interactive）带有，
+	自我对弈、训练等每秒执行数百万步的引擎实例完全没有开销
+启用：命令行--profile或环境变量GAME2048_PROFILE非空（见main.cpp），任意模式均可使用
+
+阶段之间可以嵌套：ProcessMove包含Spawn（交互模式中按键回调只返回输入，移动在会话协程中执行，不计入Dispatch）
+*/
+class Game2048_Profile
+{
+public:
+	enum Stage : uint8_t
+	{
+		Stage_KeyDecode = 0,//按键解码（从读到第一个字节开始，不含等待按键的时间）
+		Stage_Dispatch,//按键查表与回调
+		Stage_ProcessMove,
+		Stage_Spawn,
+		Stage_Render,
+		Stage_Flush,//终端输出刷新
+		Stage_End,
+	};
+
+	constexpr const static inline char *const pStageName[Stage_End] =
+	{
+		"KeyDecode",
+		"Dispatch",
+		"ProcessMove",
+		"Spawn",
+		"Render",
+		"Flush",
+	};
+
+private:
+	struct Thread_Block
+	{
+		Log_Histogram arrStages[Stage_End];
+	};
+
+	//开关单独放在外面并常量初始化，判断时不需要经过局部静态变量的初始化检查
+	static inline bool bEnabled = false;
+
+	struct Global
+	{
+		std::mutex mtxBlocks;
+		std::vector<Thread_Block *> vecBlocks;//线程结束后仍然保留，退出时合并
+		uint64_t u64TicksBeg = 0;
+		std::chrono::steady_clock::time_point tpBeg{};
+	};
+
+	static Global &GetGlobal(void)
+	{
+		static Global stGlobal{};
+		return stGlobal;
+	}
+
+	static Thread_Block &Local(void)
+	{
+		thread_local Thread_Block *pBlock = nullptr;
+		if (pBlock == nullptr)
+		{
+			pBlock = new Thread_Block{};
+			std::lock_guard<std::mutex> lock(GetGlobal().mtxBlocks);
+			GetGlobal().vecBlocks.push_back(pBlock);
+		}
+
+		return *pBlock;
+	}
+
+	static void DumpAtExit(void)
+	{
+		Dump(stderr);
+	}
+
+public:
+	static uint64_t Ticks(void)
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	static bool IsEnabled(void)
+	{
+		return bEnabled;
+	}
+
+	//必须在启动任何工作线程之前调用，退出时自动输出到stderr
+	static void Enable(void)
+	{
+		if (bEnabled)
+		{
+			return;
+		}
+
+		Global &stGlobal = GetGlobal();
+		stGlobal.tpBeg = std::chrono::steady_clock::now();
+		stGlobal.u64TicksBeg = Ticks();
+		bEnabled = true;
+		atexit(DumpAtExit);
+	}
+
+	static void Record(Stage enStage, uint64_t u64Ticks)
+	{
+		Local().arrStages[enStage].Record(u64Ticks);
+	}
+
+	//作用域计时：构造时读时钟，析构时记录，未启用时什么都不做
+	class Scope
+	{
+	private:
+		Stage enStage;
+		uint64_t u64Beg;
+
+	public:
+		Scope(Stage _enStage) :
+			enStage(_enStage),
+			u64Beg(IsEnabled() ? Ticks() : 0)
+		{}
+		~Scope(void)
+		{
+			if (u64Beg != 0)//Ticks()不会返回0
+			{
+				Record(enStage, Ticks() - u64Beg);
+			}
+		}
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+
+	//编译期关闭的计时点：空对象，连开关也不判断
+	class Scope_Null
+	{
+	public:
+		Scope_Null(Stage)
+		{}
+	};
+
+	template<bool bEnable>
+	using Scope_If = std::conditional_t<bEnable, Scope, Scope_Null>;
+
+	//合并所有线程的直方图并输出，单位为纳秒
+	static void Dump(FILE *pFile)
+	{
+		if (!bEnabled)
+		{
+			return;
+		}
+
+		Global &stGlobal = GetGlobal();
+
+		double dNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - stGlobal.tpBeg).count();
+		double dTicks = (double)(Ticks() - stGlobal.u64TicksBeg);
+		double dNsPerTick = dTicks > 0 ? dNs / dTicks : 1.0;
+
+		std::lock_guard<std::mutex> lock(stGlobal.mtxBlocks);
+		fprintf(pFile, "Profile (ns, %.3f ns/tick):\n", dNsPerTick);
+		fprintf(pFile, "%-12s %12s %10s %10s %10s %10s %10s %10s\n", "Stage", "Count", "Mean", "P50", "P90", "P99", "P99.9", "Max");
+		for (size_t s = 0; s < Stage_End; ++s)
+		{
+			auto upMerged = std::make_unique<Log_Histogram>();
+			for (const Thread_Block *pBlock : stGlobal.vecBlocks)
+			{
+				upMerged->Merge(pBlock->arrStages[s]);
+			}
+			if (upMerged->u64Count == 0)
+			{
+				continue;
+			}
+
+			fprintf(pFile, "%-12s %12" PRIu64 " %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+				pStageName[s], upMerged->u64Count,
+				(double)upMerged->u64Sum / upMerged->u64Count * dNsPerTick,
+				upMerged->Quantile(0.5) * dNsPerTick,
+				upMerged->Quantile(0.9) * dNsPerTick,
+				upMerged->Quantile(0.99) * dNsPerTick,
+				upMerged->Quantile(0.999) * dNsPerTick,
+				upMerged->u64Max * dNsPerTick);
+		}
+	}
+};
@@ -0,0 +1,222 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*
+录像文件格式（小端序，与x86/x64平台内存布局一致）：
+	[u32 魔数 'G2RP'][u16 版本][u16 保留]
+	[u32 种子][u32 保留]
+	[f64 数字2权重][f64 数字4权重]
+	[u64 最终分数][u32 最终状态][u32 保留]
+	[u64 移动步数]
+	[u8 移动流...]//每字节4步，每步2bit，低位在前
+
+只记录真正产生了移动的方向（无效方向不会消耗随机数，也不会改变棋盘），
+回放时用相同的种子与权重重新模拟即可还原每一个中间棋盘
+*/
+
+class Game2048_Record
+{
+public:
+	constexpr const static inline uint32_t u32Magic = 0x50523247;//'G2RP'
+	constexpr const static inline uint16_t u16Version = 1;
+
+private:
+	uint32_t u32Seed;
+	double dSpawnWeights_2;
+	double dSpawnWeights_4;
+
+	uint64_t u64FinalScore;
+	uint32_t u32FinalStatus;
+
+	uint64_t u64MoveCount;
+	std::vector<uint8_t> vecMoves;
+
+private:
+	template<typename T>
+	static bool WriteValue(FILE *pFile, const T &tValue)
+	{
+		return fwrite(&tValue, sizeof(tValue), 1, pFile) == 1;
+	}
+
+	template<typename T>
+	static bool ReadValue(FILE *pFile, T &tValue)
+	{
+		return fread(&tValue, sizeof(tValue), 1, pFile) == 1;
+	}
+
+public:
+	Game2048_Record(void) :
+		u32Seed(0),
+		dSpawnWeights_2(0.9),
+		dSpawnWeights_4(0.1),
+		u64FinalScore(0),
+		u32FinalStatus(0),
+		u64MoveCount(0),
+		vecMoves()
+	{}
+	~Game2048_Record(void) = default;
+
+	Game2048_Record(const Game2048_Record &) = default;
+	Game2048_Record(Game2048_Record &&) = default;
+	Game2048_Record &operator=(const Game2048_Record &) = default;
+	Game2048_Record &operator=(Game2048_Record &&) = default;
+
+	//开始一局新的录像
+	void Reset(uint32_t _u32Seed, double _dSpawnWeights_2, double _dSpawnWeights_4)
+	{
+		u32Seed = _u32Seed;
+		dSpawnWeights_2 = _dSpawnWeights_2;
+		dSpawnWeights_4 = _dSpawnWeights_4;
+
+		u64FinalScore = 0;
+		u32FinalStatus = 0;
+
+		u64MoveCount = 0;
+		vecMoves.clear();
+	}
+
+	//追加一步（仅低2bit有效）
+	void Append(uint8_t u8Direction)
+	{
+		size_t szShift = (u64MoveCount % 4) * 2;
+		if (szShift == 0)
+		{
+			vecMoves.push_back(0);
+		}
+
+		vecMoves.back() |= (u8Direction & 0x03) << szShift;
+		++u64MoveCount;
+	}
+
+	//获取第u64Index步
+	uint8_t Get(uint64_t u64Index) const
+	{
+		return (vecMoves[u64Index / 4] >> ((u64Index % 4) * 2)) & 0x03;
+	}
+
+	void SetResult(uint64_t _u64FinalScore, uint32_t _u32FinalStatus)
+	{
+		u64FinalScore = _u64FinalScore;
+		u32FinalStatus = _u32FinalStatus;
+	}
+
+	uint32_t GetSeed(void) const
+	{
+		return u32Seed;
+	}
+
+	double GetSpawnWeights_2(void) const
+	{
+		return dSpawnWeights_2;
+	}
+
+	double GetSpawnWeights_4(void) const
+	{
+		return dSpawnWeights_4;
+	}
+
+	uint64_t GetFinalScore(void) const
+	{
+		return u64FinalScore;
+	}
+
+	uint32_t GetFinalStatus(void) const
+	{
+		return u32FinalStatus;
+	}
+
+	uint64_t GetMoveCount(void) const
+	{
+		return u64MoveCount;
+	}
+
+	//====================读写文件====================
+	//写入到已打开文件的当前位置，快照文件会内嵌一份录像
+	bool Write(FILE *pFile) const
+	{
+		const uint16_t u16Reserved = 0;
+		const uint32_t u32Reserved = 0;
+
+		return
+			WriteValue(pFile, u32Magic) &&
+			WriteValue(pFile, u16Version) &&
+			WriteValue(pFile, u16Reserved) &&
+			WriteValue(pFile, u32Seed) &&
+			WriteValue(pFile, u32Reserved) &&
+			WriteValue(pFile, dSpawnWeights_2) &&
+			WriteValue(pFile, dSpawnWeights_4) &&
+			WriteValue(pFile, u64FinalScore) &&
+			WriteValue(pFile, u32FinalStatus) &&
+			WriteValue(pFile, u32Reserved) &&
+			WriteValue(pFile, u64MoveCount) &&
+			fwrite(vecMoves.data(), 1, vecMoves.size(), pFile) == vecMoves.size();
+	}
+
+	//u64MaxStreamBytes为移动流最多可占的字节数（文件或快照负载中剩余的大小），步数与之不符则拒绝
+	bool Read(FILE *pFile, uint64_t u64MaxStreamBytes)
+	{
+		uint32_t u32FileMagic = 0;
+		uint16_t u16FileVersion = 0;
+		uint16_t u16Reserved = 0;
+		uint32_t u32Reserved = 0;
+
+		bool bRet =
+			ReadValue(pFile, u32FileMagic) && u32FileMagic == u32Magic &&
+			ReadValue(pFile, u16FileVersion) && u16FileVersion == u16Version &&
+			ReadValue(pFile, u16Reserved) &&
+			ReadValue(pFile, u32Seed) &&
+			ReadValue(pFile, u32Reserved) &&
+			ReadValue(pFile, dSpawnWeights_2) &&
+			ReadValue(pFile, dSpawnWeights_4) &&
+			ReadValue(pFile, u64FinalScore) &&
+			ReadValue(pFile, u32FinalStatus) &&
+			ReadValue(pFile, u32Reserved) &&
+			ReadValue(pFile, u64MoveCount);
+
+		if (bRet)
+		{
+			uint64_t u64StreamBytes = u64MoveCount / 4 + (u64MoveCount % 4 != 0);
+			if (u64StreamBytes > u64MaxStreamBytes)
+			{
+				return false;
+			}
+			vecMoves.resize((size_t)u64StreamBytes);
+			bRet = fread(vecMoves.data(), 1, vecMoves.size(), pFile) == vecMoves.size();
+		}
+
+		return bRet;
+	}
+
+	bool Save(const char *pPath) const
+	{
+		FILE *pFile = fopen(pPath, "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		bool bRet = Write(pFile);
+		return fclose(pFile) == 0 && bRet;
+	}
+
+	bool Load(const char *pPath)
+	{
+		FILE *pFile = fopen(pPath, "rb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		//头部之后剩下的必须正好是移动流
+		long lFileSize = fseek(pFile, 0, SEEK_END) == 0 ? ftell(pFile) : -1;
+		bool bRet = lFileSize >= 0 && fseek(pFile, 0, SEEK_SET) == 0 &&
+			Read(pFile, (uint64_t)lFileSize) &&
+			ftell(pFile) == lFileSize;
+		fclose(pFile);
+		return bRet;
+	}
+};
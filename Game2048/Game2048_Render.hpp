@@ -0,0 +1,228 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>//获取uintxx_t的对应printf格式化串
+#include <string>
+
+#include "Console_Output.hpp"
+#include "Board_Packed.hpp"
+#include "Board_Wide.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Profile.hpp"
+
+//棋盘绘制，交互游戏与回放共用控制台输出，网络等其它前端使用FormatBoard得到相同样式的文本
+//格子宽度至少4，出现超过9999的数字时按最大数字的位数加宽，所有格子同宽
+class Game2048_Render
+{
+private:
+	constexpr const static inline int iMinCellWidth = 4;
+
+	static int CellWidth(uint64_t u64MaxValue)
+	{
+		int iDigits = 1;
+		while (u64MaxValue >= 10)
+		{
+			u64MaxValue /= 10;
+			++iDigits;
+		}
+
+		return iDigits > iMinCellWidth ? iDigits : iMinCellWidth;//最多20
+	}
+
+	//边框行：pLeft ── pMid ── ... ── pRight
+	static std::string BorderLine(int iWidth, const char *pLeft, const char *pMid, const char *pRight)
+	{
+		std::string strLine = pLeft;
+		for (size_t szX = 0; szX < Board_Wide::szWidth; ++szX)
+		{
+			for (int i = 0; i < iWidth; ++i)
+			{
+				strLine += "─";
+			}
+			strLine += szX + 1 != Board_Wide::szWidth ? pMid : pRight;
+		}
+
+		return strLine;
+	}
+
+	static void FormatValues(std::string &strOut, const uint64_t (&u64Values)[Board_Wide::szTotalSize], uint64_t u64Score)
+	{
+		uint64_t u64Max = 0;
+		for (uint64_t u64Value : u64Values)
+		{
+			u64Max = u64Value > u64Max ? u64Value : u64Max;
+		}
+		int iWidth = CellWidth(u64Max);
+
+		char cLine[64];
+		snprintf(cLine, sizeof(cLine), "Score:[%" PRIu64 "]\n", u64Score);
+		strOut += cLine;
+		strOut += BorderLine(iWidth, "┌", "┬", "┐\n");
+
+		for (size_t szY = 0; szY < Board_Wide::szHeight; ++szY)
+		{
+			for (size_t szX = 0; szX < Board_Wide::szWidth; ++szX)
+			{
+				uint64_t u64Value = u64Values[szY * Board_Wide::szWidth + szX];
+				int iLen = u64Value != 0 ? snprintf(cLine, sizeof(cLine), "%" PRIu64, u64Value) : 0;
+				strOut += "│";
+				strOut.append((size_t)(iWidth - iLen), ' ');//右对齐
+				strOut.append(cLine, (size_t)iLen);
+			}
+			strOut += "│\n";
+
+			if (szY + 1 != Board_Wide::szHeight)
+			{
+				strOut += BorderLine(iWidth, "├", "┼", "┤\n");
+			}
+		}
+
+		strOut += BorderLine(iWidth, "└", "┴", "┘\n");
+	}
+
+public:
+	template<typename Core>
+	static void PrintGameBoard(Console_Output &co, const Core &core)//控制台起始坐标，注意不是从0开始的，行列都从1开始
+	{
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_Render);
+
+		co.SetCursorBase();//回到初始位置
+#if defined(_WIN32)//仅Windows下每次都要隐藏，否则窗口改变会自动重新显示
+		co.HideCursor();
+#endif// defined(_WIN32)
+
+		uint64_t u64Max = 0;
+		for (auto &arrRow : core.GetTiles())
+		{
+			for (auto u64Elem : arrRow)
+			{
+				u64Max = u64Elem > u64Max ? u64Elem : u64Max;
+			}
+		}
+		int iWidth = CellWidth(u64Max);
+
+		printf("Score:[%" PRIu64 "]", core.GetScore());//打印分数
+		co.NextLine();
+		printf("%s", BorderLine(iWidth, "┌", "┬", "┐").c_str());//打印开头行
+		co.NextLine();
+
+		size_t szIndexY = 0;//控制最后一行不输出中间行的计数器
+		for (auto &arrRow : core.GetTiles())
+		{
+			for (auto u64Elem : arrRow)
+			{
+				if (u64Elem != 0)
+				{
+					printf("│%*" PRIu64, iWidth, u64Elem);//使用inttypes.h中的格式化串
+				}
+				else
+				{
+					printf("│%*s", iWidth, "");//输出空格以对齐
+				}
+			}
+			printf("│");
+			co.NextLine();
+
+			if (++szIndexY != Game2048_Core::szHeight)//最后一行不输出
+			{
+				printf("%s", BorderLine(iWidth, "├", "┼", "┤").c_str());//输出中间行
+				co.NextLine();
+			}
+		}
+
+		printf("%s", BorderLine(iWidth, "└", "┴", "┘").c_str());//打印结尾行
+		co.NextLine();
+	}
+
+	//从棋盘快照绘制（不需要引擎对象，供独立的绘制线程使用）
+	static void PrintGameBoard(Console_Output &co, const Board_Wide::Board &stBoard, uint64_t u64Score)
+	{
+		Game2048_Profile::Scope profile(Game2048_Profile::Stage_Render);
+
+		co.SetCursorBase();//回到初始位置
+#if defined(_WIN32)//仅Windows下每次都要隐藏，否则窗口改变会自动重新显示
+		co.HideCursor();
+#endif// defined(_WIN32)
+
+		std::string strFrame;
+		FormatBoard(strFrame, stBoard, u64Score);
+
+		//逐行输出，换行交给控制台对象处理
+		size_t szBeg = 0;
+		size_t szEnd;
+		while ((szEnd = strFrame.find('\n', szBeg)) != std::string::npos)
+		{
+			printf("%.*s", (int)(szEnd - szBeg), strFrame.c_str() + szBeg);
+			co.NextLine();
+			szBeg = szEnd + 1;
+		}
+	}
+
+	//把与PrintGameBoard相同样式的画面追加到strOut，每行以\n结尾
+	static void FormatBoard(std::string &strOut, Board_Packed::Board u64Board, uint64_t u64Score)
+	{
+		uint64_t u64Values[Board_Wide::szTotalSize];
+		for (size_t i = 0; i < Board_Packed::szTotalSize; ++i)
+		{
+			u64Values[i] = Board_Packed::ExponentToValue(Board_Packed::GetCell(u64Board, i));
+		}
+
+		FormatValues(strOut, u64Values, u64Score);
+	}
+
+	static void FormatBoard(std::string &strOut, const Board_Wide::Board &stBoard, uint64_t u64Score)
+	{
+		uint64_t u64Values[Board_Wide::szTotalSize];
+		for (size_t i = 0; i < Board_Wide::szTotalSize; ++i)
+		{
+			u64Values[i] = Board_Wide::ExponentToValue(Board_Wide::GetCell(stBoard, i));
+		}
+
+		FormatValues(strOut, u64Values, u64Score);
+	}
+
+	/*
+	把画面从stPrev更新为stCur的ANSI差量追加到strOut：只重写分数行与变化的格子，最后把光标放到画面下一行
+	前提是终端上已经从(1,1)开始显示了stPrev的FormatBoard画面，格子宽度变化时无法只改格子，返回false（需要完整画面）
+	*/
+	static bool FormatBoardDiff(std::string &strOut, const Board_Wide::Board &stPrev, uint64_t u64PrevScore, const Board_Wide::Board &stCur, uint64_t u64Score)
+	{
+		int iWidth = CellWidth(Board_Wide::ExponentToValue(Board_Wide::MaxExponent(stCur)));
+		if (iWidth != CellWidth(Board_Wide::ExponentToValue(Board_Wide::MaxExponent(stPrev))))
+		{
+			return false;
+		}
+
+		char cLine[64];
+		if (u64Score != u64PrevScore)
+		{
+			int iLen = snprintf(cLine, sizeof(cLine), "\033[1;1HScore:[%" PRIu64 "]\033[K", u64Score);
+			strOut.append(cLine, (size_t)iLen);
+		}
+
+		for (size_t i = 0; i < Board_Wide::szTotalSize; ++i)
+		{
+			uint8_t u8Exp = Board_Wide::GetCell(stCur, i);
+			if (u8Exp == Board_Wide::GetCell(stPrev, i))
+			{
+				continue;
+			}
+
+			//第1行分数，第2行上边框，之后格子行与分隔行交替；每格前有一个竖线
+			size_t szRow = 3 + i / Board_Wide::szWidth * 2;
+			size_t szCol = 2 + i % Board_Wide::szWidth * (size_t)(iWidth + 1);
+			int iLen = snprintf(cLine, sizeof(cLine), "\033[%zu;%zuH", szRow, szCol);
+			strOut.append(cLine, (size_t)iLen);
+
+			uint64_t u64Value = Board_Wide::ExponentToValue(u8Exp);
+			iLen = u64Value != 0 ? snprintf(cLine, sizeof(cLine), "%" PRIu64, u64Value) : 0;
+			strOut.append((size_t)(iWidth - iLen), ' ');//右对齐
+			strOut.append(cLine, (size_t)iLen);
+		}
+
+		int iLen = snprintf(cLine, sizeof(cLine), "\033[%zu;1H", 3 + Board_Wide::szHeight * 2);
+		strOut.append(cLine, (size_t)iLen);
+		return true;
+	}
+};
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <chrono>
+#include <thread>
+
+#include "Command_Line.hpp"
+#include "Console_Output.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Record.hpp"
+#include "Game2048_Render.hpp"
+
+/*
+录像回放：用录像中的种子与权重构造游戏核心，按移动流逐步重新模拟，
+从而还原每一个中间棋盘，最终分数与状态必须和录像中记录的一致
+
+用法：
+	Game2048 replay <录像文件> [--headless] [--fps 每秒步数]
+	--headless 不绘制，以引擎全速重新模拟并校验结果
+	--fps      绘制时的回放速率，默认10步每秒，0为不限速
+*/
+class Game2048_Replay
+{
+private:
+	//回调形式：void(const Game2048_Core &core, uint64_t u64Step)，每还原一个棋盘调用一次（包含初始棋盘）
+	template<typename Func>
+	static bool Simulate(const Game2048_Record &record, Game2048_Core &core, Func &&fFunc)
+	{
+		core.NewGame(record.GetSeed());
+		fFunc(core, (uint64_t)0);
+
+		for (uint64_t i = 0; i < record.GetMoveCount(); ++i)
+		{
+			if (!core.ProcessMove((Game2048_Core::Direction)record.Get(i)))
+			{
+				return false;//录像中只有有效移动，这里失败说明录像与引擎不一致
+			}
+
+			fFunc(core, i + 1);
+		}
+
+		return core.GetScore() == record.GetFinalScore() &&
+			   (uint32_t)core.GetStatus() == record.GetFinalStatus();
+	}
+
+	static int RunHeadless(const Game2048_Record &record)
+	{
+		Game2048_Core core(record.GetSeed(), record.GetSpawnWeights_2(), record.GetSpawnWeights_4());
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		bool bMatch = Simulate(record, core, [](const Game2048_Core &, uint64_t) -> void {});
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		printf("Seed:[%" PRIu32 "] Moves:[%" PRIu64 "] Score:[%" PRIu64 "] Status:[%d]\n",
+			record.GetSeed(), record.GetMoveCount(), core.GetScore(), (int)core.GetStatus());
+		printf("Replay %s, %.3f ms (%.0f moves/s)\n",
+			bMatch ? "matched" : "MISMATCHED", dSeconds * 1000.0, dSeconds > 0 ? record.GetMoveCount() / dSeconds : 0.0);
+
+		return bMatch ? 0 : 1;
+	}
+
+	static int RunRender(const Game2048_Record &record, double dMovesPerSecond)
+	{
+		Console_Output co{};
+		Game2048_Core core(record.GetSeed(), record.GetSpawnWeights_2(), record.GetSpawnWeights_4());
+
+		//每步的间隔，0为不限速
+		auto durStep = dMovesPerSecond > 0
+			? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / dMovesPerSecond))
+			: std::chrono::steady_clock::duration::zero();
+		auto tpNext = std::chrono::steady_clock::now();
+
+		co.HideCursor();
+		co.ClearScreen();
+
+		bool bMatch = Simulate(record, core,
+			[&](const Game2048_Core &coreCur, uint64_t u64Step) -> void
+			{
+				Game2048_Render::PrintGameBoard(co, coreCur);
+				printf("Move:[%" PRIu64 "/%" PRIu64 "]", u64Step, record.GetMoveCount());
+				co.NextLine();
+				fflush(stdout);
+
+				tpNext += durStep;
+				std::this_thread::sleep_until(tpNext);
+			});
+
+		printf("Replay %s", bMatch ? "matched" : "MISMATCHED");
+		co.NextLine();
+		co.ShowCursor();
+
+		return bMatch ? 0 : 1;
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		auto svPath = cmd.Positional(1);
+		if (svPath.empty())
+		{
+			fprintf(stderr, "Usage: Game2048 replay <file> [--headless] [--fps N]\n");
+			return 1;
+		}
+
+		Game2048_Record record{};
+		if (!record.Load(svPath.data()))
+		{
+			fprintf(stderr, "Error: cannot load replay file [%s]\n", svPath.data());
+			return 1;
+		}
+
+		if (cmd.HasFlag("headless"))
+		{
+			return RunHeadless(record);
+		}
+
+		return RunRender(record, cmd.GetDouble("fps", 10.0));
+	}
+};
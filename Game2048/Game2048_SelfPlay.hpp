@@ -0,0 +1,428 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Cpu_Topology.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_Policy_Options.hpp"
+#include "Game2048_NTuple.hpp"
+#include "Game2048_Heuristic.hpp"
+#include "Game2048_Book.hpp"
+#include "Game2048_Archive.hpp"
+#include "Game2048_Export.hpp"
+#include "Game2048_Stats.hpp"
+
+/*
+批量自我对弈：多线程用指定策略无界面地进行大量对局，
+第i局的种子为起始种子+i，策略也按局创建、由局号决定随机数种子，所以结果只由起始种子、局数与策略决定（与线程数无关，写入存档与导出的顺序除外）
+分数、步数、最大数字与结局的统计见Game2048_Stats.hpp，每个线程先在本地累计，再合并到共享统计，内存不随局数增长
+
+用法：
+	Game2048 selfplay [--games N] [--seed S] [--threads T] [--policy 名称] [--weights 文件 | --heuristic 文件] [--depth D] [--rollouts R] [--book 文件] [--archive 文件] [--keyframe K] [--export 文件] [--direct] [--dedup] [--progress 秒] [--pin]
+	--weights 使用N元组网络权重作为ntuple与expectimax策略的评估函数，--depth为expectimax搜索深度，--rollouts为montecarlo每个方向的模拟局数
+	--heuristic 改用行表启发评估（见Game2048_Heuristic.hpp），值为权重文件或default
+	--book 先查开局库（见Game2048_Book.hpp），命中则不调用策略，结束时输出命中率
+	--dedup 用引擎维护的Zobrist哈希统计所有对局中出现过的不同局面数
+	--export 导出训练数据（棋盘、合法移动掩码、选择的移动、本步得分、最终分数），--direct使用O_DIRECT写入
+	--progress 运行中每隔指定秒数输出一次当前的统计快照
+	--pin 按NUMA拓扑（见Cpu_Topology.hpp）把工作线程绑定到CPU，多节点时每个节点在本地内存加载一份评估函数，结束时输出各节点的吞吐
+*/
+class Game2048_SelfPlay
+{
+public:
+	struct Options
+	{
+		uint64_t u64Games = 1000;
+		uint32_t u32SeedBase = 0;
+		uint32_t u32Threads = 0;//0为硬件线程数
+		const char *pPolicy = "greedy";
+		Game2048_Policy::Context stContext{};//评估函数由所有线程共享（只读）
+		Game2048_Archive_Writer *pArchive = nullptr;//可为空
+		Game2048_Export_Writer *pExport = nullptr;//可为空
+		bool bDedup = false;
+		double dProgress = 0;//输出统计快照的间隔秒数，0为不输出
+		const Cpu_Topology *pTopology = nullptr;//非空时绑定工作线程
+		std::vector<Game2048_Policy::Context> vecNodeContexts{};//绑定时每个节点使用的上下文（评估函数为本地副本），为空则都使用stContext
+	};
+
+	struct Node_Result
+	{
+		uint32_t u32Workers = 0;
+		uint64_t u64Games = 0;
+		uint64_t u64Moves = 0;
+	};
+
+	struct Result
+	{
+		Game2048_Stats stStats{};//局数、步数、分数等
+		uint64_t u64States = 0;//统计的局面数（开启去重时）
+		uint64_t u64DistinctStates = 0;//其中不同的局面数
+		uint64_t u64BookLookups = 0;//使用开局库时
+		uint64_t u64BookHits = 0;
+		std::vector<Node_Result> vecNodes{};//绑定时每个节点一项，否则只有一项
+		double dSeconds = 0;
+		bool bArchiveFailed = false;//写入失败时所有线程提前停止，结果不完整
+		bool bExportFailed = false;
+	};
+
+private:
+	//开启快照时，线程至少每隔这么久把本地统计合并到共享统计
+	constexpr const static inline std::chrono::milliseconds msMergeInterval{ 250 };
+
+	struct Shared
+	{
+		const Options &stOptions;
+		std::atomic<uint64_t> u64NextGame{ 0 };
+		std::atomic<bool> bFailed{ false };//存档或导出写入失败，工作线程停止领取新的对局
+		std::mutex mtxArchive;//存档写入与结果合并共用
+		std::condition_variable cvDone;//线程结束时通知，用于快照等待
+		uint32_t u32Done = 0;
+
+		Result stResult{};
+		std::unordered_set<uint64_t> setStates;//所有线程见过的局面哈希
+
+		Shared(const Options &_stOptions) :
+			stOptions(_stOptions)
+		{}
+	};
+
+	static void Worker(Shared &stShared, uint32_t u32WorkerIndex)
+	{
+		const Options &stOptions = stShared.stOptions;
+
+		//先绑定再创建策略，策略内部的表也分配在本地节点
+		Cpu_Topology::Slot stSlot{};
+		if (stOptions.pTopology != nullptr)
+		{
+			stSlot = stOptions.pTopology->SlotOf(u32WorkerIndex);
+			Cpu_Topology::PinCurrentThread(stSlot.u32Cpu);
+		}
+		const Game2048_Policy::Context &stContext = stSlot.szNode < stOptions.vecNodeContexts.size() ? stOptions.vecNodeContexts[stSlot.szNode] : stOptions.stContext;
+
+		Game2048_Core core(0);
+		Game2048_Archive_Game archiveGame(stOptions.pArchive != nullptr ? stOptions.pArchive->GetKeyframeInterval() : Game2048_Archive::u32DefaultKeyframeInterval);
+		Game2048_Export_Game exportGame{};
+
+		Result stLocal{};
+		Node_Result stNodeLocal{};
+		auto tpLastMerge = std::chrono::steady_clock::now();
+		std::unordered_set<uint64_t> setStates{};//本线程见过的局面哈希，结束时合并
+		while (true)
+		{
+			uint64_t u64Game = stShared.u64NextGame.fetch_add(1, std::memory_order_relaxed);
+			if (u64Game >= stOptions.u64Games || stShared.bFailed.load(std::memory_order_relaxed))
+			{
+				break;
+			}
+
+			uint64_t u64Seed = (uint64_t)stOptions.u32SeedBase + u64Game;
+			auto upPolicy = Game2048_Policy::Create(stOptions.pPolicy, u64Seed * 0x9E3779B97F4A7C15ULL, stContext);
+			core.NewGame((uint32_t)u64Seed);
+			if (stOptions.pArchive != nullptr)
+			{
+				archiveGame.Begin(core);
+			}
+			if (stOptions.pExport != nullptr)
+			{
+				exportGame.Begin();
+			}
+			if (stOptions.bDedup)
+			{
+				setStates.insert(core.GetZobristKey());
+				++stLocal.u64States;
+			}
+
+			uint64_t u64GameMoves = 0;
+			while (core.GetStatus() == Game2048_Core::InGame)
+			{
+				uint64_t u64Board = core.GetPackedBoard();
+				uint64_t u64ScoreBefore = core.GetScore();
+
+				auto dMove = (Game2048_Core::Direction)upPolicy->Choose(u64Board);
+				if (!core.ProcessMove(dMove))
+				{
+					break;//策略必须给出有效方向，这里仅作保护
+				}
+
+				++u64GameMoves;
+				if (stOptions.pArchive != nullptr)
+				{
+					archiveGame.Push(core, dMove);
+				}
+				if (stOptions.bDedup)
+				{
+					setStates.insert(core.GetZobristKey());
+					++stLocal.u64States;
+				}
+				if (stOptions.pExport != nullptr)
+				{
+					exportGame.Push(u64Board, Board_Packed::LegalMoves(u64Board), dMove, (uint32_t)(core.GetScore() - u64ScoreBefore));
+				}
+			}
+
+			const Game2048_Policy::Book_Stats *pBookStats = upPolicy->GetBookStats();
+			if (pBookStats != nullptr)
+			{
+				stLocal.u64BookLookups += pBookStats->u64Lookups;
+				stLocal.u64BookHits += pBookStats->u64Hits;
+			}
+
+			++stNodeLocal.u64Games;
+			stNodeLocal.u64Moves += u64GameMoves;
+			stLocal.stStats.Record(core.GetScore(), u64GameMoves, Board_Packed::MaxExponent(core.GetPackedBoard()), core.GetStatus());
+
+			if (stOptions.pExport != nullptr)
+			{
+				exportGame.Finish(core.GetScore());
+			}
+
+			if (stOptions.pArchive != nullptr || stOptions.pExport != nullptr)
+			{
+				std::lock_guard<std::mutex> lock(stShared.mtxArchive);
+				if (stShared.bFailed.load(std::memory_order_relaxed))
+				{
+					break;//其他线程已经写入失败，不再追加
+				}
+				if (stOptions.pArchive != nullptr && !stOptions.pArchive->Append(archiveGame))
+				{
+					stShared.stResult.bArchiveFailed = true;
+				}
+				if (stOptions.pExport != nullptr && !stOptions.pExport->Append(exportGame))
+				{
+					stShared.stResult.bExportFailed = true;
+				}
+				if (stShared.stResult.bArchiveFailed || stShared.stResult.bExportFailed)
+				{
+					stShared.bFailed.store(true, std::memory_order_relaxed);
+					break;
+				}
+			}
+
+			if (stOptions.dProgress > 0)
+			{
+				auto tpNow = std::chrono::steady_clock::now();
+				if (tpNow - tpLastMerge >= msMergeInterval)
+				{
+					tpLastMerge = tpNow;
+					std::lock_guard<std::mutex> lock(stShared.mtxArchive);
+					stShared.stResult.stStats.Merge(stLocal.stStats);
+					stLocal.stStats.Reset();
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(stShared.mtxArchive);
+		stShared.stResult.stStats.Merge(stLocal.stStats);
+		stShared.stResult.u64States += stLocal.u64States;
+		stShared.stResult.u64BookLookups += stLocal.u64BookLookups;
+		stShared.stResult.u64BookHits += stLocal.u64BookHits;
+		stShared.setStates.merge(setStates);
+		Node_Result &stNode = stShared.stResult.vecNodes[stSlot.szNode];
+		++stNode.u32Workers;
+		stNode.u64Games += stNodeLocal.u64Games;
+		stNode.u64Moves += stNodeLocal.u64Moves;
+		++stShared.u32Done;
+		stShared.cvDone.notify_one();
+	}
+
+public:
+	static Result Run(const Options &stOptions)
+	{
+		uint32_t u32Threads = stOptions.u32Threads != 0 ? stOptions.u32Threads : std::thread::hardware_concurrency();
+		u32Threads = u32Threads != 0 ? u32Threads : 1;
+
+		Shared stShared(stOptions);
+		stShared.stResult.vecNodes.resize(stOptions.pTopology != nullptr ? stOptions.pTopology->NodeCount() : 1);
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		std::vector<std::thread> vecThreads;
+		for (uint32_t i = 0; i < u32Threads; ++i)
+		{
+			vecThreads.emplace_back(Worker, std::ref(stShared), i);
+		}
+		if (stOptions.dProgress > 0)
+		{
+			auto upSnapshot = std::make_unique<Game2048_Stats>();
+			std::unique_lock<std::mutex> lock(stShared.mtxArchive);
+			while (!stShared.cvDone.wait_for(lock, std::chrono::duration<double>(stOptions.dProgress), [&](void) -> bool { return stShared.u32Done == u32Threads; }))
+			{
+				*upSnapshot = stShared.stResult.stStats;//复制后解锁再输出，不阻塞工作线程
+				lock.unlock();
+				printf("Progress:[%.1f s]\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - tpBeg).count());
+				upSnapshot->Print(stdout);
+				fflush(stdout);
+				lock.lock();
+			}
+		}
+		for (auto &it : vecThreads)
+		{
+			it.join();
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		stShared.stResult.dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		stShared.stResult.u64DistinctStates = stShared.setStates.size();
+		return stShared.stResult;
+	}
+
+	static int Main(const Command_Line &cmd)
+	{
+		Options stOptions{};
+		stOptions.u64Games = cmd.GetU64("games", stOptions.u64Games);
+		stOptions.u32SeedBase = (uint32_t)cmd.GetU64("seed", stOptions.u32SeedBase);
+		stOptions.u32Threads = (uint32_t)cmd.GetU64("threads", stOptions.u32Threads);
+		stOptions.pPolicy = cmd.GetString("policy", stOptions.pPolicy);
+		stOptions.bDedup = cmd.HasFlag("dedup");
+		stOptions.dProgress = cmd.GetDouble("progress", stOptions.dProgress);
+
+		Cpu_Topology topology{};
+		if (cmd.HasFlag("pin"))
+		{
+			topology.Discover();
+			topology.Print(stdout);
+			stOptions.pTopology = &topology;
+		}
+
+		Game2048_Policy_Options policyOptions{};
+		if (!policyOptions.Load(cmd, true))
+		{
+			return 1;
+		}
+		stOptions.stContext = policyOptions.stContext;
+
+		const char *pWeightsPath = policyOptions.GetWeightsPath();
+		const char *pHeuristicPath = policyOptions.GetHeuristicPath();
+		const char *pBookPath = policyOptions.GetBookPath();
+
+		//多节点时在每个节点上各加载一份评估函数，远端节点的线程不再跨节点读权重
+		std::vector<std::unique_ptr<Game2048_NTuple>> vecNodeNTuples{};
+		std::vector<std::unique_ptr<Game2048_Heuristic>> vecNodeHeuristics{};
+		if (stOptions.pTopology != nullptr && topology.NodeCount() > 1 && stOptions.stContext.pEvaluator != nullptr)
+		{
+			for (size_t i = 0; i < topology.NodeCount(); ++i)
+			{
+				Game2048_Policy::Context stNodeContext = stOptions.stContext;
+				bool bLoaded = false;
+				topology.RunOnNode(i, [&](void) -> void
+					{
+						if (pWeightsPath != nullptr)
+						{
+							auto upNTuple = std::make_unique<Game2048_NTuple>();
+							bLoaded = upNTuple->Load(pWeightsPath, true);//读入可写内存（本节点），而不是共享页缓存的映射
+							stNodeContext.pEvaluator = upNTuple.get();
+							vecNodeNTuples.push_back(std::move(upNTuple));
+						}
+						else
+						{
+							auto upHeuristic = std::make_unique<Game2048_Heuristic>();
+							bLoaded = upHeuristic->LoadOption(pHeuristicPath);
+							stNodeContext.pEvaluator = upHeuristic.get();
+							vecNodeHeuristics.push_back(std::move(upHeuristic));
+						}
+					});
+				if (!bLoaded)
+				{
+					fprintf(stderr, "Error: cannot load evaluator on node [%" PRIu32 "]\n", topology.GetNode(i).u32Id);
+					return 1;
+				}
+				stOptions.vecNodeContexts.push_back(stNodeContext);
+			}
+		}
+
+		if (Game2048_Policy::Create(stOptions.pPolicy, 0, stOptions.stContext) == nullptr)
+		{
+			fprintf(stderr, "Error: unknown policy [%s]\n", stOptions.pPolicy);
+			return 1;
+		}
+
+		Game2048_Archive_Writer archiveWriter{};
+		const char *pArchivePath = cmd.GetString("archive");
+		if (pArchivePath != nullptr)
+		{
+			if (!archiveWriter.Open(pArchivePath, (uint32_t)cmd.GetU64("keyframe", Game2048_Archive::u32DefaultKeyframeInterval)))
+			{
+				fprintf(stderr, "Error: cannot open archive [%s]\n", pArchivePath);
+				return 1;
+			}
+			stOptions.pArchive = &archiveWriter;
+		}
+
+		Game2048_Export_Writer exportWriter{};
+		const char *pExportPath = cmd.GetString("export");
+		if (pExportPath != nullptr)
+		{
+			if (!exportWriter.Open(pExportPath, cmd.HasFlag("direct")))
+			{
+				fprintf(stderr, "Error: cannot open export [%s]\n", pExportPath);
+				return 1;
+			}
+			stOptions.pExport = &exportWriter;
+		}
+
+		Result stResult = Run(stOptions);
+
+		if (stResult.bArchiveFailed)
+		{
+			fprintf(stderr, "Error: cannot write archive [%s]\n", pArchivePath);
+			return 1;
+		}
+		if (stResult.bExportFailed)
+		{
+			fprintf(stderr, "Error: cannot write export [%s]\n", pExportPath);
+			return 1;
+		}
+		if (pArchivePath != nullptr && !archiveWriter.Close())
+		{
+			fprintf(stderr, "Error: cannot finish archive [%s]\n", pArchivePath);
+			return 1;
+		}
+		if (pExportPath != nullptr && !exportWriter.Close())
+		{
+			fprintf(stderr, "Error: cannot finish export [%s]\n", pExportPath);
+			return 1;
+		}
+
+		const Game2048_Stats &stStats = stResult.stStats;
+		printf("Policy:[%s] Games:[%" PRIu64 "] Moves:[%" PRIu64 "] Wins:[%" PRIu64 "] AvgScore:[%.1f]\n",
+			stOptions.pPolicy, stStats.Games(), stStats.Moves().u64Sum, stStats.StatusCount(Game2048_Core::WinGame), stStats.Score().Mean());
+		printf("Time:[%.3f s] %.0f games/s, %.0f moves/s\n",
+			stResult.dSeconds, stStats.Games() / stResult.dSeconds, stStats.Moves().u64Sum / stResult.dSeconds);
+		stStats.Print(stdout);
+		if (stOptions.bDedup)
+		{
+			printf("States:[%" PRIu64 "] Distinct:[%" PRIu64 "] Duplicate:[%.2f%%]\n",
+				stResult.u64States, stResult.u64DistinctStates,
+				stResult.u64States != 0 ? 100.0 * (stResult.u64States - stResult.u64DistinctStates) / stResult.u64States : 0.0);
+		}
+		if (pBookPath != nullptr)
+		{
+			printf("Book:[%" PRIu64 " entries] Hits:[%" PRIu64 "/%" PRIu64 " %.2f%%]\n",
+				policyOptions.GetBook().Count(), stResult.u64BookHits, stResult.u64BookLookups,
+				stResult.u64BookLookups != 0 ? 100.0 * stResult.u64BookHits / stResult.u64BookLookups : 0.0);
+		}
+		if (stOptions.pTopology != nullptr)
+		{
+			for (size_t i = 0; i < stResult.vecNodes.size(); ++i)
+			{
+				const Node_Result &stNode = stResult.vecNodes[i];
+				printf("Node:[%" PRIu32 "] Workers:[%" PRIu32 "] Games:[%" PRIu64 "] Moves:[%" PRIu64 "] %.0f moves/s, %.0f moves/s per worker\n",
+					topology.GetNode(i).u32Id, stNode.u32Workers, stNode.u64Games, stNode.u64Moves,
+					stNode.u64Moves / stResult.dSeconds, stNode.u32Workers != 0 ? stNode.u64Moves / stResult.dSeconds / stNode.u32Workers : 0.0);
+			}
+		}
+
+		return 0;
+	}
+};
@@ -0,0 +1,647 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Fast_Rand.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Render.hpp"
+#include "Game2048_Session.hpp"
+#include "Game2048_SessionArena.hpp"
+#include "Local_Socket.hpp"
+
+#if defined(__linux__)
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <signal.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/epoll.h>
+	#include <sys/resource.h>
+	#include <sys/socket.h>
+#endif
+
+/*
+本机多会话游戏服务器（仅Linux）：监听Unix域套接字或127.0.0.1上的TCP端口，每个连接对应对局池中的一个对局
+每个事件循环线程各自持有epoll、对局池与连接，监听套接字以EPOLLEXCLUSIVE加入所有循环，新连接只唤醒其中一个，循环之间不共享任何状态
+
+协议（单字节命令，不区分大小写，空白字符忽略，可以一次发送多个）：
+	w/s/a/d 上/下/左/右  n 新开一局  f 切换画面模式  q 断开
+服务器在连接建立时与每条命令后回复一次：
+	状态模式（默认）：一行"棋盘 分数 状态 是否移动\n"，棋盘为16位十六进制压缩棋盘（见Board_Packed.hpp），
+	                  状态0进行中 1胜利 2失败，整个棋盘只有8字节，直接发送完整状态比差量更短
+	画面模式：与控制台相同样式的棋盘画面（Game2048_Render::FormatBoard），以空行结尾
+	未知命令回复"E 字符\n"
+
+单个连接积压的待发送数据超过限制时暂停读取该连接（不再产生新的回复），写出后恢复，慢客户端的命令留在套接字缓冲中，内存占用有上限
+对端关闭时先处理接收缓冲中剩余的命令，尽量送出回复后再断开
+
+交互模式（--interactive）：每个连接运行一个与控制台相同流程的交互会话（Game2048_Session，开始界面、Y/N确认、重开与退出），
+收到的字节按控制台按键解释（w/s/a/d与方向键转义序列、r、q、y、n），回复ANSI画面，可以直接用终端连接游玩
+会话是协程，在事件循环线程中推进，不需要每个连接一个线程；积压的输出超过水位时会话挂起，写出后再继续，期间的输入排队
+
+用法：
+	Game2048 server [--unix 路径 | --port P] [--loops N] [--seed S] [--interactive]
+*/
+class Game2048_Server
+{
+public:
+	struct Options
+	{
+		const char *pUnixPath = nullptr;
+		uint16_t u16Port = 2048;
+		uint32_t u32Loops = 1;
+		uint64_t u64Seed = 0;
+		bool bInteractive = false;
+	};
+
+#if defined(__linux__)
+private:
+	constexpr const static inline size_t szMaxEvents = 256;
+	constexpr const static inline size_t szReadSize = 4096;
+	constexpr const static inline size_t szMaxPending = 64 * 1024;//积压的待发送数据超过该值时暂停读取
+	constexpr const static inline size_t szFlushWatermark = 16 * 1024;//交互会话积压输出超过该值时挂起
+
+	struct Connection
+	{
+		int iFd = -1;
+		Game2048_SessionArena::Handle hSession = Game2048_SessionArena::hInvalid;
+		bool bFrames = false;
+		bool bWantRead = true;//已注册EPOLLIN（积压过多时暂停读取）
+		bool bWantWrite = false;//已注册EPOLLOUT
+		std::string strOut{};
+		size_t szOutPos = 0;
+
+		//交互模式
+		uint8_t u8Escape = 0;//方向键转义序列的解析状态：0无 1收到ESC 2收到ESC [ 或 ESC O
+		std::unique_ptr<Game2048_View> upView{};
+		std::unique_ptr<Game2048_Session> upSession{};//必须先于视图析构（析构顺序与声明相反）
+	};
+
+	//交互会话的输出：追加到连接的发送缓冲，由事件循环写出
+	class Socket_View : public Game2048_View
+	{
+	private:
+		Connection &conn;
+
+	public:
+		Socket_View(Connection &_conn) :
+			conn(_conn)
+		{}
+		~Socket_View(void) = default;
+
+		Socket_View(const Socket_View &) = delete;
+		Socket_View &operator=(const Socket_View &) = delete;
+
+		void ShowKeyGuide(void) override
+		{
+			conn.strOut +=
+				"\033[2J\033[H"
+				"========2048 Game========\n"
+				"--------Key Guide--------\n"
+				" W / Up Arrow    -> Up\n"
+				" S / Down Arrow  -> Down\n"
+				" A / Left Arrow  -> Left\n"
+				" D / Right Arrow -> Right\n"
+				"-------------------------\n"
+				" R -> Restart\n"
+				" Q -> Quit\n"
+				"-------------------------\n"
+				"\n"
+				"Press Any key To Start...\n";
+		}
+
+		void ShowBoard(const Game2048_Core_Interactive &core, bool bNewGame) override
+		{
+			conn.strOut += bNewGame ? "\033[2J\033[H" : "\033[H";//画面大小不变，直接覆盖
+			Game2048_Render::FormatBoard(conn.strOut, core.GetWideBoard(), core.GetScore());
+		}
+
+		void ShowPrompt(const char *pMessage, const char *pPrompt) override
+		{
+			conn.strOut += pMessage;
+			conn.strOut += '\n';
+			conn.strOut += pPrompt;
+			conn.strOut += " (Y/N)\n";
+		}
+
+		void ClearPrompt(void) override
+		{
+			conn.strOut += "\033[2A\033[J";//回到提示的第一行并清除到屏幕末尾
+		}
+
+		bool Flush(void) override
+		{
+			return conn.strOut.size() - conn.szOutPos < szFlushWatermark;//实际写出由事件循环完成
+		}
+	};
+
+	class Event_Loop
+	{
+	private:
+		int iListenFd;
+		int iEpollFd;
+		Game2048_SessionArena arena;
+		Fast_Rand randSeed;
+		size_t szConnections;
+		bool bInteractive;
+
+	private:
+		static bool SetNonBlocking(int iFd)
+		{
+			int iFlags = fcntl(iFd, F_GETFL, 0);
+			return iFlags >= 0 && fcntl(iFd, F_SETFL, iFlags | O_NONBLOCK) == 0;
+		}
+
+		void AppendState(Connection &conn, bool bMoved)
+		{
+			Board_Packed::Board u64Board = arena.GetBoard(conn.hSession);
+			uint32_t u32Score = arena.GetScore(conn.hSession);
+			unsigned uStatus = (unsigned)arena.GetStatus(conn.hSession);
+
+			if (conn.bFrames)
+			{
+				Game2048_Render::FormatBoard(conn.strOut, u64Board, u32Score);
+				conn.strOut += uStatus == Game2048_Core::WinGame ? "You Win!\n\n" : uStatus == Game2048_Core::LostGame ? "Game Over!\n\n" : "\n";
+				return;
+			}
+
+			char cLine[64];
+			int iLen = snprintf(cLine, sizeof(cLine), "%016" PRIx64 " %" PRIu32 " %u %d\n", u64Board, u32Score, uStatus, bMoved ? 1 : 0);
+			conn.strOut.append(cLine, (size_t)iLen);
+		}
+
+		void Close(Connection *pConn)
+		{
+			epoll_ctl(iEpollFd, EPOLL_CTL_DEL, pConn->iFd, NULL);
+			close(pConn->iFd);
+			if (!bInteractive)
+			{
+				arena.Release(pConn->hSession);
+			}
+			delete pConn;
+			--szConnections;
+		}
+
+		//尽量写出积压数据，写不完则注册EPOLLOUT，积压过多则暂停读取，返回false代表连接已失效
+		bool Flush(Connection &conn)
+		{
+			while (conn.szOutPos < conn.strOut.size())
+			{
+				ssize_t sszSend = send(conn.iFd, conn.strOut.data() + conn.szOutPos, conn.strOut.size() - conn.szOutPos, MSG_NOSIGNAL);
+				if (sszSend < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+					{
+						break;
+					}
+					return false;
+				}
+				conn.szOutPos += (size_t)sszSend;
+			}
+
+			if (conn.szOutPos == conn.strOut.size())
+			{
+				conn.strOut.clear();
+				conn.szOutPos = 0;
+			}
+
+			//交互会话挂起时输入在会话中排队，排队过多同样暂停读取
+			size_t szPending = conn.strOut.size() - conn.szOutPos;
+			bool bWantRead = szPending <= szMaxPending && (!bInteractive || conn.upSession->GetPendingInputs() < szReadSize);
+			bool bWantWrite = szPending != 0;
+			if (bWantRead != conn.bWantRead || bWantWrite != conn.bWantWrite)
+			{
+				epoll_event stEvent{};
+				stEvent.events = (bWantRead ? (uint32_t)EPOLLIN : 0) | (bWantWrite ? (uint32_t)EPOLLOUT : 0);
+				stEvent.data.ptr = &conn;
+				if (epoll_ctl(iEpollFd, EPOLL_CTL_MOD, conn.iFd, &stEvent) != 0)
+				{
+					return false;
+				}
+				conn.bWantRead = bWantRead;
+				conn.bWantWrite = bWantWrite;
+			}
+
+			return true;
+		}
+
+		void Accept(void)
+		{
+			while (true)
+			{
+				int iFd = accept4(iListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (iFd < 0)
+				{
+					if (errno == EINTR || errno == ECONNABORTED)
+					{
+						continue;
+					}
+					if (errno != EAGAIN && errno != EWOULDBLOCK)
+					{
+						fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+					}
+					return;
+				}
+
+				int iOne = 1;
+				setsockopt(iFd, IPPROTO_TCP, TCP_NODELAY, &iOne, sizeof(iOne));//Unix域套接字上会失败，忽略
+
+				Connection *pConn = new Connection{};
+				pConn->iFd = iFd;
+				if (!bInteractive)
+				{
+					pConn->hSession = arena.Create(randSeed());
+				}
+
+				epoll_event stEvent{};
+				stEvent.events = EPOLLIN;
+				stEvent.data.ptr = pConn;
+				if (epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iFd, &stEvent) != 0)
+				{
+					close(iFd);
+					if (!bInteractive)
+					{
+						arena.Release(pConn->hSession);
+					}
+					delete pConn;
+					continue;
+				}
+				++szConnections;
+
+				if (bInteractive)
+				{
+					pConn->upView = std::make_unique<Socket_View>(*pConn);
+					pConn->upSession = std::make_unique<Game2048_Session>(*pConn->upView, (uint32_t)randSeed());
+					pConn->upSession->Start();
+				}
+				else
+				{
+					AppendState(*pConn, false);
+				}
+
+				if (!Flush(*pConn))
+				{
+					Close(pConn);
+				}
+			}
+		}
+
+		//处理收到的命令，返回false代表需要断开
+		bool Process(Connection &conn, const char *pData, size_t szSize)
+		{
+			for (size_t i = 0; i < szSize; ++i)
+			{
+				char c = pData[i];
+				c = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+
+				switch (c)
+				{
+				case 'w':
+				case 's':
+				case 'a':
+				case 'd':
+					{
+						Board_Packed::Direction dMove = c == 'w' ? Board_Packed::Up : c == 's' ? Board_Packed::Dn : c == 'a' ? Board_Packed::Lt : Board_Packed::Rt;
+						AppendState(conn, arena.Move(conn.hSession, dMove));
+					}
+					break;
+				case 'n':
+					arena.Release(conn.hSession);
+					conn.hSession = arena.Create(randSeed());
+					AppendState(conn, false);
+					break;
+				case 'f':
+					conn.bFrames = !conn.bFrames;
+					AppendState(conn, false);
+					break;
+				case 'q':
+					return false;
+				case ' ':
+				case '\t':
+				case '\r':
+				case '\n':
+					break;
+				default:
+					conn.strOut += "E ";
+					conn.strOut += c;
+					conn.strOut += '\n';
+					break;
+				}
+			}
+
+			return true;
+		}
+
+		//交互模式：把收到的字节转换为会话输入，返回false代表会话已结束需要断开
+		bool ProcessInteractive(Connection &conn, const char *pData, size_t szSize)
+		{
+			Game2048_Session &session = *conn.upSession;
+			for (size_t i = 0; i < szSize; ++i)
+			{
+				char c = pData[i];
+
+				//方向键：ESC [ A/B/C/D（或ESC O A/B/C/D），序列可能分在多次读取中
+				if (conn.u8Escape == 1)
+				{
+					if (c == '[' || c == 'O')
+					{
+						conn.u8Escape = 2;
+						continue;
+					}
+					conn.u8Escape = 0;
+					session.PushInput(Game2048_Session::Input_Other);//单独的ESC，当前字节照常处理
+				}
+				else if (conn.u8Escape == 2)
+				{
+					conn.u8Escape = 0;
+					session.PushInput(
+						c == 'A' ? Game2048_Session::Input_Up :
+						c == 'B' ? Game2048_Session::Input_Dn :
+						c == 'C' ? Game2048_Session::Input_Rt :
+						c == 'D' ? Game2048_Session::Input_Lt :
+						Game2048_Session::Input_Other);
+					continue;
+				}
+
+				c = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+				switch (c)
+				{
+				case '\033':
+					conn.u8Escape = 1;
+					break;
+				case 'w':
+					session.PushInput(Game2048_Session::Input_Up);
+					break;
+				case 's':
+					session.PushInput(Game2048_Session::Input_Dn);
+					break;
+				case 'a':
+					session.PushInput(Game2048_Session::Input_Lt);
+					break;
+				case 'd':
+					session.PushInput(Game2048_Session::Input_Rt);
+					break;
+				case 'r':
+					session.PushInput(Game2048_Session::Input_Restart);
+					break;
+				case 'q':
+					session.PushInput(Game2048_Session::Input_Quit);
+					break;
+				case 'y':
+					session.PushInput(Game2048_Session::Input_Yes);
+					break;
+				case 'n':
+					session.PushInput(Game2048_Session::Input_No);
+					break;
+				default:
+					session.PushInput(Game2048_Session::Input_Other);
+					break;
+				}
+			}
+
+			return !session.IsFinished();
+		}
+
+		void HandleEvent(Connection *pConn, uint32_t u32Events)
+		{
+			if (u32Events & EPOLLERR)
+			{
+				Close(pConn);
+				return;
+			}
+
+			if (u32Events & EPOLLHUP)
+			{
+				//对端已关闭：处理接收缓冲中剩余的命令（暂停读取时也处理），尽量送出回复后断开
+				char cBuffer[szReadSize];
+				while (true)
+				{
+					ssize_t sszRecv = recv(pConn->iFd, cBuffer, sizeof(cBuffer), 0);
+					if (sszRecv < 0 && errno == EINTR)
+					{
+						continue;
+					}
+					if (sszRecv <= 0 || !(bInteractive ? ProcessInteractive(*pConn, cBuffer, (size_t)sszRecv) : Process(*pConn, cBuffer, (size_t)sszRecv)))
+					{
+						break;
+					}
+				}
+
+				Flush(*pConn);
+				Close(pConn);
+				return;
+			}
+
+			if (u32Events & EPOLLIN)
+			{
+				//每个事件只读一次，水平触发下剩余数据留到下一轮，保证各连接之间公平
+				char cBuffer[szReadSize];
+				ssize_t sszRecv = recv(pConn->iFd, cBuffer, sizeof(cBuffer), 0);
+				if (sszRecv == 0 || (sszRecv < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				{
+					Close(pConn);
+					return;
+				}
+
+				if (sszRecv > 0 && !(bInteractive ? ProcessInteractive(*pConn, cBuffer, (size_t)sszRecv) : Process(*pConn, cBuffer, (size_t)sszRecv)))
+				{
+					Flush(*pConn);//尽量送出q之前的回复
+					Close(pConn);
+					return;
+				}
+			}
+
+			if (!Flush(*pConn))
+			{
+				Close(pConn);
+				return;
+			}
+
+			//积压的输出已写出，恢复等待输出的会话，会话继续运行产生的输出同样写出；
+			//暂停读取时不会再有输入事件唤醒会话，所以一直恢复到输出写不完或会话等待输入为止
+			while (bInteractive && pConn->upSession->IsWaitingFlush() && pConn->upView->Flush())
+			{
+				pConn->upSession->NotifyFlushed();
+				if (!Flush(*pConn) || pConn->upSession->IsFinished())
+				{
+					Close(pConn);
+					return;
+				}
+			}
+		}
+
+	public:
+		Event_Loop(int _iListenFd, uint64_t u64Seed, bool _bInteractive) :
+			iListenFd(_iListenFd),
+			iEpollFd(-1),
+			arena(),
+			randSeed(u64Seed),
+			szConnections(0),
+			bInteractive(_bInteractive)
+		{}
+		~Event_Loop(void)
+		{
+			if (iEpollFd >= 0)
+			{
+				close(iEpollFd);
+			}
+		}
+
+		Event_Loop(const Event_Loop &) = delete;
+		Event_Loop &operator=(const Event_Loop &) = delete;
+
+		bool Init(void)
+		{
+			iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+			if (iEpollFd < 0)
+			{
+				fprintf(stderr, "Error: epoll_create1 failed: %s\n", strerror(errno));
+				return false;
+			}
+
+			epoll_event stEvent{};
+			stEvent.events = EPOLLIN | EPOLLEXCLUSIVE;//多个循环共用监听套接字，新连接只唤醒一个
+			stEvent.data.ptr = nullptr;
+			if (epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iListenFd, &stEvent) != 0)
+			{
+				fprintf(stderr, "Error: epoll_ctl failed: %s\n", strerror(errno));
+				return false;
+			}
+
+			return true;
+		}
+
+		void Run(void)
+		{
+			epoll_event stEvents[szMaxEvents];
+			while (true)
+			{
+				int iCount = epoll_wait(iEpollFd, stEvents, (int)szMaxEvents, -1);
+				if (iCount < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					fprintf(stderr, "Error: epoll_wait failed: %s\n", strerror(errno));
+					return;
+				}
+
+				for (int i = 0; i < iCount; ++i)
+				{
+					if (stEvents[i].data.ptr == nullptr)
+					{
+						Accept();
+					}
+					else
+					{
+						HandleEvent((Connection *)stEvents[i].data.ptr, stEvents[i].events);
+					}
+				}
+			}
+		}
+	};
+
+private:
+	//把文件描述符软上限提到硬上限，否则默认的1024个连接远远不够
+	static void RaiseFileLimit(void)
+	{
+		rlimit stLimit{};
+		if (getrlimit(RLIMIT_NOFILE, &stLimit) == 0 && stLimit.rlim_cur < stLimit.rlim_max)
+		{
+			stLimit.rlim_cur = stLimit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &stLimit);
+		}
+	}
+
+public:
+	static int Run(const Options &stOptions)
+	{
+		signal(SIGPIPE, SIG_IGN);
+		RaiseFileLimit();
+
+		int iListenFd = Local_Socket::Listen(stOptions.pUnixPath, stOptions.u16Port);
+		if (iListenFd < 0)
+		{
+			return 1;
+		}
+
+		//每个循环的对局种子流互不重叠
+		Fast_Rand randSeed(stOptions.u64Seed);
+		std::vector<std::unique_ptr<Event_Loop>> vecLoops;
+		for (uint32_t i = 0; i < stOptions.u32Loops; ++i)
+		{
+			vecLoops.push_back(std::make_unique<Event_Loop>(iListenFd, randSeed(), stOptions.bInteractive));
+			if (!vecLoops.back()->Init())
+			{
+				close(iListenFd);
+				return 1;
+			}
+		}
+
+		if (stOptions.pUnixPath != nullptr)
+		{
+			printf("Listening on unix:%s with %" PRIu32 " loop(s)\n", stOptions.pUnixPath, stOptions.u32Loops);
+		}
+		else
+		{
+			printf("Listening on 127.0.0.1:%u with %" PRIu32 " loop(s)\n", (unsigned)stOptions.u16Port, stOptions.u32Loops);
+		}
+		fflush(stdout);
+
+		std::vector<std::thread> vecThreads;
+		for (uint32_t i = 1; i < stOptions.u32Loops; ++i)
+		{
+			vecThreads.emplace_back(&Event_Loop::Run, vecLoops[i].get());
+		}
+		vecLoops[0]->Run();
+
+		for (auto &it : vecThreads)
+		{
+			it.join();
+		}
+		close(iListenFd);
+		return 1;//只有出错时才会退出循环
+	}
+#else
+public:
+	static int Run(const Options &stOptions)
+	{
+		fprintf(stderr, "Error: server mode is only supported on Linux\n");
+		return 1;
+	}
+#endif
+
+	static int Main(const Command_Line &cmd)
+	{
+		Options stOptions{};
+		stOptions.pUnixPath = cmd.GetString("unix");
+		stOptions.u16Port = (uint16_t)cmd.GetU64("port", 2048);
+		stOptions.u32Loops = (uint32_t)cmd.GetU64("loops", 1);
+		stOptions.u64Seed = cmd.GetU64("seed", 0);
+		stOptions.bInteractive = cmd.HasFlag("interactive");
+
+		if (stOptions.u32Loops == 0)
+		{
+			fprintf(stderr, "Error: --loops must be positive\n");
+			return 1;
+		}
+
+		return Run(stOptions);
+	}
+};
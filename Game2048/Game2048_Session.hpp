@@ -0,0 +1,606 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+#include "Game2048_Core.hpp"
+#include "Game2048_Record.hpp"
+#include "Game2048_Snapshot.hpp"
+
+/*
+协程任务：创建后挂起，被co_await时才开始执行，结束时恢复等待它的协程（对称转移，嵌套任意层都不增加栈深度）
+最外层的任务由驱动方resume，异常保存在任务中，由co_await方或驱动方取出重新抛出
+*/
+template<typename T = void>
+class Game2048_Task
+{
+private:
+	struct Promise_Base
+	{
+		std::coroutine_handle<> hContinuation{};
+		std::exception_ptr pException{};
+
+		struct Final_Awaiter
+		{
+			bool await_ready(void) noexcept
+			{
+				return false;
+			}
+
+			template<typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> hSelf) noexcept
+			{
+				std::coroutine_handle<> hContinuation = hSelf.promise().hContinuation;
+				return hContinuation ? hContinuation : std::noop_coroutine();
+			}
+
+			void await_resume(void) noexcept
+			{}
+		};
+
+		std::suspend_always initial_suspend(void) noexcept
+		{
+			return {};
+		}
+
+		Final_Awaiter final_suspend(void) noexcept
+		{
+			return {};
+		}
+
+		void unhandled_exception(void) noexcept
+		{
+			pException = std::current_exception();
+		}
+
+		void Rethrow(void) const
+		{
+			if (pException)
+			{
+				std::rethrow_exception(pException);
+			}
+		}
+	};
+
+	template<typename U>
+	struct Promise_Value : Promise_Base
+	{
+		std::optional<U> opValue{};
+
+		void return_value(U value)
+		{
+			opValue = std::move(value);
+		}
+
+		U Take(void)
+		{
+			this->Rethrow();
+			return std::move(*opValue);
+		}
+	};
+
+	struct Promise_Void : Promise_Base
+	{
+		void return_void(void) noexcept
+		{}
+
+		void Take(void)
+		{
+			this->Rethrow();
+		}
+	};
+
+public:
+	struct promise_type : std::conditional_t<std::is_void_v<T>, Promise_Void, Promise_Value<T>>
+	{
+		Game2048_Task get_return_object(void)
+		{
+			return Game2048_Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+	};
+
+	using Handle = std::coroutine_handle<promise_type>;
+
+private:
+	Handle hTask;
+
+	explicit Game2048_Task(Handle _hTask) :
+		hTask(_hTask)
+	{}
+
+public:
+	Game2048_Task(void) :
+		hTask(nullptr)
+	{}
+	~Game2048_Task(void)
+	{
+		if (hTask)
+		{
+			hTask.destroy();
+		}
+	}
+
+	Game2048_Task(Game2048_Task &&_Other) noexcept :
+		hTask(std::exchange(_Other.hTask, nullptr))
+	{}
+	Game2048_Task &operator=(Game2048_Task &&_Other) noexcept
+	{
+		if (this != &_Other)
+		{
+			if (hTask)
+			{
+				hTask.destroy();
+			}
+			hTask = std::exchange(_Other.hTask, nullptr);
+		}
+		return *this;
+	}
+
+	Game2048_Task(const Game2048_Task &) = delete;
+	Game2048_Task &operator=(const Game2048_Task &) = delete;
+
+	Handle GetHandle(void) const
+	{
+		return hTask;
+	}
+
+	bool IsDone(void) const
+	{
+		return !hTask || hTask.done();
+	}
+
+	//结束后取出结果（有异常则重新抛出）
+	decltype(auto) Result(void)
+	{
+		return hTask.promise().Take();
+	}
+
+	auto operator co_await(void) noexcept
+	{
+		struct Awaiter
+		{
+			Handle hTask;
+
+			bool await_ready(void) noexcept
+			{
+				return !hTask || hTask.done();
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> hCaller) noexcept
+			{
+				hTask.promise().hContinuation = hCaller;
+				return hTask;
+			}
+
+			decltype(auto) await_resume(void)
+			{
+				return hTask.promise().Take();
+			}
+		};
+
+		return Awaiter{ hTask };
+	}
+};
+
+//会话的输出：终端、套接字等前端各自实现，会话只在协程所在线程调用
+class Game2048_View
+{
+public:
+	virtual ~Game2048_View(void) = default;
+
+	virtual void ShowKeyGuide(void) = 0;
+	virtual void ShowBoard(const Game2048_Core_Interactive &core, bool bNewGame) = 0;//bNewGame为true时先清屏
+	virtual void ShowPrompt(const char *pMessage, const char *pPrompt) = 0;
+	virtual void ClearPrompt(void) = 0;
+
+	//送出之前的输出，全部送出返回true；返回false时会话挂起，驱动方在输出送出后调用Game2048_Session::NotifyFlushed
+	virtual bool Flush(void) = 0;
+};
+
+/*
+交互对局会话：开始界面、移动、胜负提示、重开与退出的完整流程写成一个协程，
+协程co_await输入事件与输出完成，不直接读按键也不阻塞，所以同一套逻辑可以由终端、套接字、脚本或AI驱动，
+一个线程可以同时推进任意多个会话（每个会话只有协程帧与引擎的内存，不需要各自的线程）
+
+驱动方：
+	Start()开始，之后每收到一个输入调用PushInput，视图的Flush返回false时在输出送出后调用NotifyFlushed，
+	IsFinished()为true后会话结束（玩家退出或输入关闭），可以销毁
+	输入在会话忙（等待输出完成）时排队，不会丢失
+*/
+class Game2048_Session
+{
+public:
+	enum Input : uint8_t
+	{
+		Input_Up = 0,//与Game2048_Core::Direction一致
+		Input_Dn,
+		Input_Lt,
+		Input_Rt,
+		Input_Restart,
+		Input_Quit,
+		Input_Yes,
+		Input_No,
+		Input_Other,//其它按键，只用于"按任意键开始"
+		Input_Close,//输入已关闭（EOF、断开），之后会话结束
+	};
+
+	enum Phase : uint8_t
+	{
+		Phase_Guide = 0,//开始界面，等待任意键
+		Phase_Playing,
+		Phase_Prompt,//等待Y/N
+		Phase_Finished,
+	};
+
+private:
+	enum Wait : uint8_t
+	{
+		Wait_None = 0,
+		Wait_Input,
+		Wait_Flush,
+	};
+
+	Game2048_Core_Interactive core;//游戏状态核心
+	Game2048_View &view;
+
+	Game2048_Record record;//当前对局的录像（总是记录，快照中也会保存一份）
+	const char *pRecordPath;//录像保存路径，为空则不保存录像
+	const char *pSnapshotPath;//快照路径，为空则不保存也不恢复
+	bool bFirstGame;//第一局使用构造时的种子，之后的对局从随机数流中派生
+
+	std::deque<Input> dequeInput;//未处理的输入
+	Game2048_Task<> taskMain;
+	std::coroutine_handle<> hWaiting;//挂起等待的最内层协程
+	Wait enWait;
+	Phase enPhase;
+
+private:
+	//====================等待====================
+	struct Input_Awaiter
+	{
+		Game2048_Session &session;
+
+		bool await_ready(void) const noexcept
+		{
+			return !session.dequeInput.empty();
+		}
+
+		void await_suspend(std::coroutine_handle<> hCaller) noexcept
+		{
+			session.hWaiting = hCaller;
+			session.enWait = Wait_Input;
+		}
+
+		Input await_resume(void) noexcept
+		{
+			Input enInput = session.dequeInput.front();
+			if (enInput != Input_Close)//关闭之后一直返回关闭
+			{
+				session.dequeInput.pop_front();
+			}
+			return enInput;
+		}
+	};
+
+	struct Flush_Awaiter
+	{
+		Game2048_Session &session;
+
+		bool await_ready(void) const
+		{
+			return session.view.Flush();
+		}
+
+		void await_suspend(std::coroutine_handle<> hCaller) noexcept
+		{
+			session.hWaiting = hCaller;
+			session.enWait = Wait_Flush;
+		}
+
+		void await_resume(void) noexcept
+		{}
+	};
+
+	Input_Awaiter NextInput(void)
+	{
+		return Input_Awaiter{ *this };
+	}
+
+	Flush_Awaiter Flush(void)
+	{
+		return Flush_Awaiter{ *this };
+	}
+
+	void Resume(void)
+	{
+		std::coroutine_handle<> hResume = std::exchange(hWaiting, nullptr);
+		enWait = Wait_None;
+		hResume.resume();
+
+		if (taskMain.IsDone())
+		{
+			enPhase = Phase_Finished;
+			taskMain.Result();//重新抛出协程中的异常
+		}
+	}
+
+	//====================录像与快照====================
+	void SaveRecord(void) const
+	{
+		if (pRecordPath != nullptr && record.GetMoveCount() != 0)//没有任何移动的对局不覆盖之前的录像
+		{
+			record.Save(pRecordPath);
+		}
+	}
+
+	void SaveSnapshot(void) const
+	{
+		if (pSnapshotPath != nullptr)
+		{
+			Game2048_Snapshot::Save(pSnapshotPath, core, &record);
+		}
+	}
+
+	void RemoveSnapshot(void) const
+	{
+		if (pSnapshotPath != nullptr)
+		{
+			Game2048_Snapshot::Remove(pSnapshotPath);
+		}
+	}
+
+	//成功则恢复到快照中的对局，快照存在但损坏时给出警告并开始新的一局
+	bool LoadSnapshot(void)
+	{
+		std::error_code ec{};
+		if (pSnapshotPath == nullptr || !std::filesystem::exists(pSnapshotPath, ec))
+		{
+			return false;
+		}
+
+		if (!Game2048_Snapshot::Load(pSnapshotPath, core, &record))
+		{
+			fprintf(stderr, "Warning: snapshot [%s] is corrupted, starting a new game\n", pSnapshotPath);
+			return false;
+		}
+
+		return core.GetStatus() == Game2048_Core::InGame;//已经结束的对局没有恢复的必要
+	}
+
+	//====================流程====================
+	void ResetGame(void)
+	{
+		//保存上一局的录像
+		SaveRecord();
+
+		//开始新的一局
+		if (bFirstGame)
+		{
+			core.NewGame();
+			bFirstGame = false;
+		}
+		else
+		{
+			core.NewGame(core.DeriveNextSeed());
+		}
+
+		view.ShowBoard(core, true);
+	}
+
+	//显示信息并等待Y/N，输入关闭视为N
+	Game2048_Task<bool> Prompt(const char *pMessage, const char *pPrompt)
+	{
+		Phase enPrev = enPhase;
+		enPhase = Phase_Prompt;
+
+		view.ShowPrompt(pMessage, pPrompt);
+		co_await Flush();
+
+		Input enInput;
+		do
+		{
+			enInput = co_await NextInput();
+		} while (enInput != Input_Yes && enInput != Input_No && enInput != Input_Close);
+
+		view.ClearPrompt();
+		co_await Flush();
+
+		enPhase = enPrev;
+		co_return enInput == Input_Yes;
+	}
+
+	Game2048_Task<> Run(void)
+	{
+		//先尝试恢复快照，只是读一个很小的文件，不会拖慢启动
+		bool bResume = LoadSnapshot();
+		if (bResume)
+		{
+			bFirstGame = false;//恢复的对局之后重开则从随机数流中派生种子
+		}
+
+		//按键信息，等待任意键
+		view.ShowKeyGuide();
+		co_await Flush();
+		if (co_await NextInput() == Input_Close)
+		{
+			co_return;
+		}
+
+		if (bResume)
+		{
+			view.ShowBoard(core, true);//恢复的对局直接绘制
+		}
+		else
+		{
+			ResetGame();
+		}
+		co_await Flush();
+		enPhase = Phase_Playing;
+
+		while (true)
+		{
+			Input enInput = co_await NextInput();
+			switch (enInput)
+			{
+			case Input_Up:
+			case Input_Dn:
+			case Input_Lt:
+			case Input_Rt:
+				if (!core.ProcessMove((Game2048_Core::Direction)enInput))//没有移动
+				{
+					break;
+				}
+
+				view.ShowBoard(core, false);
+				co_await Flush();
+
+				if (core.GetStatus() != Game2048_Core::InGame)//判断一下输赢
+				{
+					if (!co_await Prompt(core.GetStatus() == Game2048_Core::WinGame ? "You Win!" : "You Lost...", "Restart?"))
+					{
+						RemoveSnapshot();//对局已经结束，不再恢复
+						co_return;
+					}
+					ResetGame();
+					co_await Flush();
+				}
+				break;
+			case Input_Restart:
+				if (co_await Prompt("You Press Restart Key!", "Restart?"))
+				{
+					ResetGame();
+					co_await Flush();
+				}
+				break;
+			case Input_Quit:
+				if (co_await Prompt("You Press Quit Key!", "Quit?"))
+				{
+					SaveSnapshot();//保存对局，下次启动时恢复
+					co_return;
+				}
+				break;
+			case Input_Close:
+				co_return;
+			default:
+				break;
+			}
+		}
+	}
+
+public:
+	Game2048_Session(Game2048_View &_view, uint32_t u32Seed = std::random_device{}(), double dSpawnWeights_2 = 0.9, double dSpawnWeights_4 = 0.1) :
+		core(u32Seed, dSpawnWeights_2, dSpawnWeights_4),
+		view(_view),
+
+		record(),
+		pRecordPath(nullptr),
+		pSnapshotPath(nullptr),
+		bFirstGame(true),
+
+		dequeInput(),
+		taskMain(),
+		hWaiting(nullptr),
+		enWait(Wait_None),
+		enPhase(Phase_Guide)
+	{
+		core.SetRecord(&record);
+	}
+	~Game2048_Session(void)
+	{
+		SaveRecord();//保存最后一局的录像
+	}
+
+	//协程持有this，不能移动或拷贝
+	Game2048_Session(const Game2048_Session &) = delete;
+	Game2048_Session(Game2048_Session &&) = delete;
+	Game2048_Session &operator=(const Game2048_Session &) = delete;
+	Game2048_Session &operator=(Game2048_Session &&) = delete;
+
+	//录像，每局结束（重开或退出）时将该局保存到pPath，必须在Start前调用
+	void EnableRecord(const char *pPath)
+	{
+		pRecordPath = pPath;
+	}
+
+	//快照，按退出键退出时保存到pPath，Start时从pPath恢复，必须在Start前调用
+	void EnableSnapshot(const char *pPath)
+	{
+		pSnapshotPath = pPath;
+	}
+
+	//运行到第一次需要等待为止
+	void Start(void)
+	{
+		taskMain = Run();
+		hWaiting = taskMain.GetHandle();
+		Resume();
+	}
+
+	void PushInput(Input enInput)
+	{
+		if (enPhase == Phase_Finished)
+		{
+			return;
+		}
+
+		dequeInput.push_back(enInput);
+		if (enWait == Wait_Input)
+		{
+			Resume();
+		}
+	}
+
+	void NotifyFlushed(void)
+	{
+		if (enWait == Wait_Flush)
+		{
+			Resume();
+		}
+	}
+
+	bool IsFinished(void) const
+	{
+		return enPhase == Phase_Finished;
+	}
+
+	//挂起等待输出完成（驱动方应在输出送出后调用NotifyFlushed）
+	bool IsWaitingFlush(void) const
+	{
+		return enWait == Wait_Flush;
+	}
+
+	//排队未处理的输入数
+	size_t GetPendingInputs(void) const
+	{
+		return dequeInput.size();
+	}
+
+	Phase GetPhase(void) const
+	{
+		return enPhase;
+	}
+
+	const Game2048_Core_Interactive &GetCore(void) const
+	{
+		return core;
+	}
+
+	//调试
+#ifdef _DEBUG
+	void Debug(void)
+	{
+		core.Debug();
+		view.ShowBoard(core, false);
+		view.Flush();
+	}
+#endif
+};
@@ -0,0 +1,329 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <chrono>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Fast_Rand.hpp"
+#include "Game2048_Core.hpp"
+
+/*
+对局池：大量并发对局的紧凑存储
+Game2048对象带有mt19937_64（约5KB）与会分配堆内存的分布对象，且不能复制移动，无法密集存放成千上万个对局，
+这里每个对局只保存压缩棋盘、8字节随机数状态、分数、步数、代号与状态，按结构数组排列，每个对局29字节
+
+规则与Game2048_Core相同：合并出2048即胜利且该步不再生成数字，生成后无法移动即失败
+随机数使用Fast_Rand，相同种子的对局与Game2048_Core不一致
+
+句柄为（代号<<32）|下标，槽位释放时代号递增，旧句柄随即失效，空闲槽位放入空闲链表优先复用
+代号从1开始，所以句柄0永远无效
+*/
+class Game2048_SessionArena
+{
+public:
+	using Handle = uint64_t;
+	using Direction = Board_Packed::Direction;
+	using GameStatus = Game2048_Core::GameStatus;
+
+	constexpr const static inline Handle hInvalid = 0;
+
+private:
+	constexpr const static inline uint8_t u8FreeSlot = 0xFF;
+
+	std::vector<Board_Packed::Board> vecBoards;
+	std::vector<uint64_t> vecRandStates;
+	std::vector<uint32_t> vecScores;
+	std::vector<uint32_t> vecMoves;
+	std::vector<uint32_t> vecGenerations;
+	std::vector<uint8_t> vecStatus;//GameStatus或u8FreeSlot
+
+	std::vector<uint32_t> vecFreeList;
+	size_t szLive;
+
+private:
+	static uint32_t IndexOf(Handle hSession)
+	{
+		return (uint32_t)hSession;
+	}
+
+	static uint32_t GenerationOf(Handle hSession)
+	{
+		return (uint32_t)(hSession >> 32);
+	}
+
+	static Handle MakeHandle(uint32_t u32Index, uint32_t u32Generation)
+	{
+		return ((Handle)u32Generation << 32) | u32Index;
+	}
+
+public:
+	Game2048_SessionArena(void) :
+		vecBoards(),
+		vecRandStates(),
+		vecScores(),
+		vecMoves(),
+		vecGenerations(),
+		vecStatus(),
+		vecFreeList(),
+		szLive(0)
+	{}
+	~Game2048_SessionArena(void) = default;
+
+	Game2048_SessionArena(const Game2048_SessionArena &) = delete;
+	Game2048_SessionArena(Game2048_SessionArena &&) = default;
+	Game2048_SessionArena &operator=(const Game2048_SessionArena &) = delete;
+	Game2048_SessionArena &operator=(Game2048_SessionArena &&) = default;
+
+	//预留槽位，避免增长时反复搬移
+	void Reserve(size_t szCapacity)
+	{
+		vecBoards.reserve(szCapacity);
+		vecRandStates.reserve(szCapacity);
+		vecScores.reserve(szCapacity);
+		vecMoves.reserve(szCapacity);
+		vecGenerations.reserve(szCapacity);
+		vecStatus.reserve(szCapacity);
+	}
+
+	//新开对局，优先复用空闲槽位
+	Handle Create(uint64_t u64Seed)
+	{
+		uint32_t u32Index;
+		if (!vecFreeList.empty())
+		{
+			u32Index = vecFreeList.back();
+			vecFreeList.pop_back();
+		}
+		else
+		{
+			u32Index = (uint32_t)vecBoards.size();
+			vecBoards.push_back(0);
+			vecRandStates.push_back(0);
+			vecScores.push_back(0);
+			vecMoves.push_back(0);
+			vecGenerations.push_back(1);
+			vecStatus.push_back(u8FreeSlot);
+		}
+
+		Fast_Rand rand(u64Seed);
+		vecBoards[u32Index] = Board_Packed::SpawnRandom(Board_Packed::SpawnRandom(0, rand), rand);
+		vecRandStates[u32Index] = rand.GetState();
+		vecScores[u32Index] = 0;
+		vecMoves[u32Index] = 0;
+		vecStatus[u32Index] = Game2048_Core::InGame;
+		++szLive;
+
+		return MakeHandle(u32Index, vecGenerations[u32Index]);
+	}
+
+	//释放对局，句柄无效返回false
+	bool Release(Handle hSession)
+	{
+		if (!IsValid(hSession))
+		{
+			return false;
+		}
+
+		uint32_t u32Index = IndexOf(hSession);
+		vecStatus[u32Index] = u8FreeSlot;
+		vecGenerations[u32Index] = vecGenerations[u32Index] + 1 != 0 ? vecGenerations[u32Index] + 1 : 1;//回绕时跳过0
+		vecFreeList.push_back(u32Index);
+		--szLive;
+
+		return true;
+	}
+
+	bool IsValid(Handle hSession) const
+	{
+		uint32_t u32Index = IndexOf(hSession);
+		return u32Index < vecBoards.size() &&
+			vecStatus[u32Index] != u8FreeSlot &&
+			vecGenerations[u32Index] == GenerationOf(hSession);
+	}
+
+	//移动，句柄无效、对局已结束或方向无效返回false
+	bool Move(Handle hSession, Direction dMove)
+	{
+		if (!IsValid(hSession) || dMove >= Board_Packed::Enum_End)
+		{
+			return false;
+		}
+
+		uint32_t u32Index = IndexOf(hSession);
+		if (vecStatus[u32Index] != Game2048_Core::InGame)
+		{
+			return false;
+		}
+
+		uint32_t u32Score = 0;
+		Board_Packed::Board u64Board = vecBoards[u32Index];
+		Board_Packed::Board u64After = Board_Packed::Move(u64Board, dMove, u32Score);
+		if (u64After == u64Board)
+		{
+			return false;
+		}
+
+		vecScores[u32Index] += u32Score;
+		++vecMoves[u32Index];
+
+		if (Board_Packed::MaxExponent(u64After) >= Board_Packed::ValueToExponent(2048) &&
+			Board_Packed::MaxExponent(u64Board) < Board_Packed::ValueToExponent(2048))
+		{
+			vecBoards[u32Index] = u64After;
+			vecStatus[u32Index] = Game2048_Core::WinGame;//与Game2048_Core一致，胜利的一步不生成数字
+			return true;
+		}
+
+		Fast_Rand rand(vecRandStates[u32Index]);
+		u64After = Board_Packed::SpawnRandom(u64After, rand);
+		vecRandStates[u32Index] = rand.GetState();
+		vecBoards[u32Index] = u64After;
+
+		if (Board_Packed::LegalMoves(u64After) == 0)
+		{
+			vecStatus[u32Index] = Game2048_Core::LostGame;
+		}
+
+		return true;
+	}
+
+	//====================查询====================
+	//以下函数要求句柄有效
+	Board_Packed::Board GetBoard(Handle hSession) const
+	{
+		return vecBoards[IndexOf(hSession)];
+	}
+
+	uint32_t GetScore(Handle hSession) const
+	{
+		return vecScores[IndexOf(hSession)];
+	}
+
+	uint32_t GetMoves(Handle hSession) const
+	{
+		return vecMoves[IndexOf(hSession)];
+	}
+
+	GameStatus GetStatus(Handle hSession) const
+	{
+		return (GameStatus)vecStatus[IndexOf(hSession)];
+	}
+
+	size_t Live(void) const
+	{
+		return szLive;
+	}
+
+	size_t Capacity(void) const
+	{
+		return vecBoards.size();
+	}
+
+	//所有已分配槽位占用的字节数（不含vector预留的多余部分）
+	size_t MemoryUsage(void) const
+	{
+		constexpr const size_t szSlotSize =
+			sizeof(Board_Packed::Board) + sizeof(uint64_t) + sizeof(uint32_t) * 3 + sizeof(uint8_t);
+		return vecBoards.size() * szSlotSize + vecFreeList.size() * sizeof(uint32_t);
+	}
+
+	//按槽位顺序遍历所有存活的对局，func(Handle)，顺序访问各数组以利用缓存
+	//遍历中可以Move与Release当前对局，但不能Create
+	template<typename Func>
+	void ForEach(Func &&func)
+	{
+		for (uint32_t i = 0; i < (uint32_t)vecStatus.size(); ++i)
+		{
+			if (vecStatus[i] != u8FreeSlot)
+			{
+				func(MakeHandle(i, vecGenerations[i]));
+			}
+		}
+	}
+};
+
+/*
+对局池的容量与吞吐量测试：创建N个对局，每轮给每个对局随机走一步，结束的对局释放后立即新开一个（复用空闲槽位）
+
+用法：
+	Game2048 arena [--sessions N] [--rounds R] [--seed S]
+*/
+class Game2048_SessionArena_Bench
+{
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		uint64_t u64Sessions = cmd.GetU64("sessions", 1000000);
+		uint64_t u64Rounds = cmd.GetU64("rounds", 100);
+		uint64_t u64Seed = cmd.GetU64("seed", 0);
+
+		if (u64Sessions == 0 || u64Sessions > UINT32_MAX)
+		{
+			fprintf(stderr, "Error: --sessions must be in [1, %" PRIu32 "]\n", UINT32_MAX);
+			return 1;
+		}
+
+		Game2048_SessionArena arena{};
+		Fast_Rand rand(u64Seed);
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		arena.Reserve((size_t)u64Sessions);
+		for (uint64_t i = 0; i < u64Sessions; ++i)
+		{
+			arena.Create(rand());
+		}
+		auto tpCreated = std::chrono::steady_clock::now();
+
+		uint64_t u64Moves = 0;
+		uint64_t u64Finished = 0;
+		uint64_t u64Wins = 0;
+		uint64_t u64ScoreSum = 0;
+		for (uint64_t r = 0; r < u64Rounds; ++r)
+		{
+			uint64_t u64Restart = 0;
+			arena.ForEach([&](Game2048_SessionArena::Handle hSession) -> void
+			{
+				uint8_t u8Legal = Board_Packed::LegalMoves(arena.GetBoard(hSession));
+				uint32_t u32Pick = rand.Below(4);
+				while ((u8Legal & (1 << u32Pick)) == 0)
+				{
+					u32Pick = (u32Pick + 1) % 4;
+				}
+
+				arena.Move(hSession, (Board_Packed::Direction)u32Pick);
+				++u64Moves;
+
+				if (arena.GetStatus(hSession) != Game2048_Core::InGame)
+				{
+					++u64Finished;
+					u64Wins += arena.GetStatus(hSession) == Game2048_Core::WinGame;
+					u64ScoreSum += arena.GetScore(hSession);
+					arena.Release(hSession);
+					++u64Restart;
+				}
+			});
+
+			for (uint64_t i = 0; i < u64Restart; ++i)
+			{
+				arena.Create(rand());
+			}
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		double dCreateSeconds = std::chrono::duration<double>(tpCreated - tpBeg).count();
+		double dPlaySeconds = std::chrono::duration<double>(tpEnd - tpCreated).count();
+		printf("Sessions:[%zu] Capacity:[%zu] Memory:[%.1f MB] (%.1f bytes/session)\n",
+			arena.Live(), arena.Capacity(), arena.MemoryUsage() / 1048576.0, (double)arena.MemoryUsage() / arena.Capacity());
+		printf("Create:[%.3f s] Play:[%.3f s] Moves:[%" PRIu64 "] %.2fM moves/s\n",
+			dCreateSeconds, dPlaySeconds, u64Moves, dPlaySeconds > 0 ? u64Moves / dPlaySeconds / 1e6 : 0.0);
+		printf("Finished:[%" PRIu64 "] Wins:[%" PRIu64 "] AvgScore:[%.1f]\n",
+			u64Finished, u64Wins, u64Finished != 0 ? (double)u64ScoreSum / u64Finished : 0.0);
+
+		return 0;
+	}
+};
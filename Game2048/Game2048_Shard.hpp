@@ -0,0 +1,614 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_Policy_Options.hpp"
+#include "Game2048_Stats.hpp"
+
+#if defined(__linux__)
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <signal.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/wait.h>
+#endif
+
+/*
+多进程分片自我对弈（仅Linux）：父进程fork出K个子进程，每个子进程负责一段不相交的局号（种子）区间，
+单个子进程崩溃不影响其他分片，父进程从该分片最后一次检查点的局号重新启动它
+
+对局只由局号决定：生成种子为起始种子+局号，策略每局新建、种子也由局号得出（与Game2048_Tournament相同），
+所以结果与分片数、重启次数无关，--shards 0在本进程内顺序运行，作为对照；
+统计（见Game2048_Stats.hpp）只有整数累加，摘要为每局结果哈希之和，与合并顺序无关，不同分片数的输出逐位相同
+
+共享内存（shm_open后立即shm_unlink，映射由fork继承，进程退出后不会残留）中每个分片一个槽：
+	子进程是槽的唯一写者，每隔一段时间用顺序锁（seqlock）发布一次本分片的进度与统计，不加锁、不等待父进程
+	父进程读到奇数序号或前后序号不同则重读，读到的总是某次完整发布的状态
+父进程每--interval秒读出所有槽作为检查点，给出--checkpoint时同时写入文件（临时文件再改名），
+父进程本身中断后用相同参数再次运行，会从文件中的检查点继续（评估函数与开局库文件须与之前相同）
+
+用法：
+	Game2048 shard [--games N] [--seed S] [--shards K] [--policy 名称] [--weights 文件 | --heuristic 文件] [--depth D] [--rollouts R] [--book 文件]
+		[--checkpoint 文件] [--interval 秒] [--max-restarts R]
+	--shards 默认为硬件线程数，0为不分进程
+	--max-restarts 单个分片最多重启的次数，超过后终止整个运行
+*/
+class Game2048_Shard
+{
+public:
+	struct Options
+	{
+		uint64_t u64Games = 1000;
+		uint32_t u32SeedBase = 0;
+		uint32_t u32Shards = 0;//0为不分进程（Main中未指定时取硬件线程数）
+		const char *pPolicy = "greedy";
+		Game2048_Policy::Context stContext{};
+		const char *pCheckpoint = nullptr;//可为空
+		double dInterval = 5.0;
+		uint32_t u32MaxRestarts = 3;
+	};
+
+	//分片的进度与结果：[u64Begin, u64Next)已完成，计入统计与摘要
+	struct Shard_State
+	{
+		uint64_t u64Begin;
+		uint64_t u64End;
+		uint64_t u64Next;
+		uint64_t u64Digest;
+		Game2048_Stats stStats;
+	};
+
+	static_assert(std::is_trivially_copyable_v<Shard_State>);
+
+	struct Result
+	{
+		Game2048_Stats stStats{};
+		uint64_t u64Digest = 0;
+		uint32_t u32Shards = 0;
+		uint32_t u32Restarts = 0;
+		uint64_t u64Resumed = 0;//从检查点文件继续时已完成的局数（不计入速度）
+		uint64_t u64ResumedMoves = 0;
+		double dSeconds = 0;
+	};
+
+private:
+	static uint64_t Mix(uint64_t u64Value)
+	{
+		u64Value += 0x9E3779B97F4A7C15ULL;
+		u64Value = (u64Value ^ (u64Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		u64Value = (u64Value ^ (u64Value >> 27)) * 0x94D049BB133111EBULL;
+		return u64Value ^ (u64Value >> 31);
+	}
+
+	//单局结果的哈希，各局相加得到摘要
+	static uint64_t GameDigest(uint64_t u64Game, uint64_t u64Score, uint64_t u64Moves, uint8_t u8MaxExp, Game2048_Core::GameStatus enStatus)
+	{
+		return Mix(Mix(u64Game) ^ u64Score ^ (u64Moves << 32) ^ ((uint64_t)u8MaxExp << 56) ^ ((uint64_t)enStatus << 62));
+	}
+
+	static void PlayGame(const Options &stOptions, Game2048_Core &core, Shard_State &stState)
+	{
+		uint64_t u64Game = stState.u64Next;
+		uint64_t u64Seed = (uint64_t)stOptions.u32SeedBase + u64Game;
+		auto upPolicy = Game2048_Policy::Create(stOptions.pPolicy, u64Seed * 0x9E3779B97F4A7C15ULL, stOptions.stContext);
+		core.NewGame((uint32_t)u64Seed);
+
+		uint64_t u64Moves = 0;
+		while (core.GetStatus() == Game2048_Core::InGame)
+		{
+			if (!core.ProcessMove((Game2048_Core::Direction)upPolicy->Choose(core.GetPackedBoard())))
+			{
+				break;//策略必须给出有效方向，这里仅作保护
+			}
+			++u64Moves;
+		}
+
+		uint8_t u8MaxExp = Board_Packed::MaxExponent(core.GetPackedBoard());
+		stState.stStats.Record(core.GetScore(), u64Moves, u8MaxExp, core.GetStatus());
+		stState.u64Digest += GameDigest(u64Game, core.GetScore(), u64Moves, u8MaxExp, core.GetStatus());
+		++stState.u64Next;
+	}
+
+	static void InitStates(const Options &stOptions, uint32_t u32Shards, std::vector<Shard_State> &vecStates)
+	{
+		vecStates.resize(u32Shards);
+		for (uint32_t i = 0; i < u32Shards; ++i)
+		{
+			Shard_State &stState = vecStates[i];
+			stState.u64Begin = stOptions.u64Games * i / u32Shards;
+			stState.u64End = stOptions.u64Games * (i + 1) / u32Shards;
+			stState.u64Next = stState.u64Begin;
+			stState.u64Digest = 0;
+			stState.stStats.Reset();
+		}
+	}
+
+	static Result Merge(const std::vector<Shard_State> &vecStates)
+	{
+		Result stResult{};
+		for (const Shard_State &stState : vecStates)
+		{
+			stResult.stStats.Merge(stState.stStats);
+			stResult.u64Digest += stState.u64Digest;
+		}
+		stResult.u32Shards = (uint32_t)vecStates.size();
+		return stResult;
+	}
+
+	//检查点文件：[u32 魔数 'G2SH'][u16 版本][u16 保留][u32 分片数][u32 起始种子][u64 局数][u32 状态大小][u32 保留][策略名 32字节][Shard_State * 分片数]
+	constexpr const static inline uint32_t u32Magic = 0x48533247;//'G2SH'
+	constexpr const static inline uint16_t u16Version = 1;
+
+	struct File_Header
+	{
+		uint32_t u32Magic;
+		uint16_t u16Version;
+		uint16_t u16Reserved;
+		uint32_t u32Shards;
+		uint32_t u32SeedBase;
+		uint64_t u64Games;
+		uint32_t u32StateSize;
+		uint32_t u32Reserved;
+		char szPolicy[32];
+	};
+
+	static File_Header MakeHeader(const Options &stOptions, uint32_t u32Shards)
+	{
+		File_Header stHeader{};
+		stHeader.u32Magic = u32Magic;
+		stHeader.u16Version = u16Version;
+		stHeader.u32Shards = u32Shards;
+		stHeader.u32SeedBase = stOptions.u32SeedBase;
+		stHeader.u64Games = stOptions.u64Games;
+		stHeader.u32StateSize = sizeof(Shard_State);
+		strncpy(stHeader.szPolicy, stOptions.pPolicy, sizeof(stHeader.szPolicy) - 1);
+		return stHeader;
+	}
+
+	static bool SaveCheckpoint(const char *pPath, const Options &stOptions, const std::vector<Shard_State> &vecStates)
+	{
+		std::string strTemp = std::string(pPath) + ".tmp";
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		File_Header stHeader = MakeHeader(stOptions, (uint32_t)vecStates.size());
+		bool bRet = fwrite(&stHeader, sizeof(stHeader), 1, pFile) == 1 &&
+			fwrite(vecStates.data(), sizeof(Shard_State), vecStates.size(), pFile) == vecStates.size();
+		bRet = fclose(pFile) == 0 && bRet;
+
+		std::error_code ec{};
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, pPath, ec);
+		}
+		if (!bRet || ec)
+		{
+			std::filesystem::remove(strTemp, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+	//文件不存在返回true且不修改vecStates，存在但与参数不符或损坏返回false
+	static bool LoadCheckpoint(const char *pPath, const Options &stOptions, uint32_t u32Shards, std::vector<Shard_State> &vecStates, bool &bLoaded)
+	{
+		bLoaded = false;
+		FILE *pFile = fopen(pPath, "rb");
+		if (pFile == NULL)
+		{
+			return true;
+		}
+
+		File_Header stHeader{};
+		File_Header stExpect = MakeHeader(stOptions, u32Shards);
+		std::vector<Shard_State> vecRead(u32Shards);
+		bool bRet = fread(&stHeader, sizeof(stHeader), 1, pFile) == 1 &&
+			memcmp(&stHeader, &stExpect, sizeof(stHeader)) == 0 &&
+			fread(vecRead.data(), sizeof(Shard_State), u32Shards, pFile) == u32Shards;
+		fclose(pFile);
+		if (!bRet)
+		{
+			return false;
+		}
+
+		//区间必须与本次的划分一致
+		std::vector<Shard_State> vecInit{};
+		InitStates(stOptions, u32Shards, vecInit);
+		for (uint32_t i = 0; i < u32Shards; ++i)
+		{
+			if (vecRead[i].u64Begin != vecInit[i].u64Begin || vecRead[i].u64End != vecInit[i].u64End ||
+				vecRead[i].u64Next < vecRead[i].u64Begin || vecRead[i].u64Next > vecRead[i].u64End)
+			{
+				return false;
+			}
+		}
+
+		vecStates = std::move(vecRead);
+		bLoaded = true;
+		return true;
+	}
+
+	static uint64_t CountDone(const std::vector<Shard_State> &vecStates)
+	{
+		uint64_t u64Done = 0;
+		for (const Shard_State &stState : vecStates)
+		{
+			u64Done += stState.u64Next - stState.u64Begin;
+		}
+		return u64Done;
+	}
+
+#if defined(__linux__)
+	//子进程发布状态的最短间隔
+	constexpr const static inline std::chrono::milliseconds msPublishInterval{ 100 };
+
+	struct alignas(64) Shard_Slot
+	{
+		std::atomic<uint64_t> u64Seq;//奇数表示正在写
+		Shard_State stState;
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free);//跨进程使用的原子量必须无锁
+
+	//只有一个写者（该分片的子进程）
+	static void Publish(Shard_Slot &stSlot, const Shard_State &stState)
+	{
+		uint64_t u64Seq = stSlot.u64Seq.load(std::memory_order_relaxed);
+		stSlot.u64Seq.store(u64Seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy((void *)&stSlot.stState, &stState, sizeof(Shard_State));
+		stSlot.u64Seq.store(u64Seq + 2, std::memory_order_release);
+	}
+
+	//写者在写到一半时崩溃会使序号一直是奇数，所以只重试有限次数，失败时保留之前的状态
+	static bool TryRead(const Shard_Slot &stSlot, Shard_State &stState)
+	{
+		for (uint32_t i = 0; i < 1000; ++i)
+		{
+			uint64_t u64Before = stSlot.u64Seq.load(std::memory_order_acquire);
+			if (u64Before % 2 != 0)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			memcpy(&stState, (const void *)&stSlot.stState, sizeof(Shard_State));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (stSlot.u64Seq.load(std::memory_order_relaxed) == u64Before)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	[[noreturn]] static void ChildMain(const Options &stOptions, Shard_Slot &stSlot)
+	{
+		Shard_State stState{};
+		memcpy(&stState, (const void *)&stSlot.stState, sizeof(Shard_State));//父进程在fork前写好了起点
+
+		Game2048_Core core(0);
+		auto tpLast = std::chrono::steady_clock::now();
+		while (stState.u64Next < stState.u64End)
+		{
+			PlayGame(stOptions, core, stState);
+
+			auto tpNow = std::chrono::steady_clock::now();
+			if (tpNow - tpLast >= msPublishInterval)
+			{
+				tpLast = tpNow;
+				Publish(stSlot, stState);
+			}
+		}
+
+		Publish(stSlot, stState);
+		_exit(0);//不执行父进程注册的退出处理，也不重复刷新继承来的输出缓冲
+	}
+
+	static pid_t Spawn(const Options &stOptions, Shard_Slot &stSlot, const Shard_State &stFrom)
+	{
+		memcpy((void *)&stSlot.stState, &stFrom, sizeof(Shard_State));
+		stSlot.u64Seq.store(0, std::memory_order_relaxed);//子进程已退出，没有并发的写者
+
+		fflush(stdout);
+		fflush(stderr);
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			ChildMain(stOptions, stSlot);
+		}
+		return pid;
+	}
+
+	static void KillAll(const std::vector<pid_t> &vecPids)
+	{
+		for (pid_t pid : vecPids)
+		{
+			if (pid > 0)
+			{
+				kill(pid, SIGKILL);
+				waitpid(pid, nullptr, 0);
+			}
+		}
+	}
+
+public:
+	static bool RunShards(const Options &stOptions, Result &stResult)
+	{
+		uint32_t u32Shards = (uint64_t)stOptions.u32Shards < stOptions.u64Games ? stOptions.u32Shards : (uint32_t)stOptions.u64Games;
+		u32Shards = u32Shards != 0 ? u32Shards : 1;
+
+		std::vector<Shard_State> vecCheckpoint{};
+		InitStates(stOptions, u32Shards, vecCheckpoint);
+		Result stResumed{};
+		if (stOptions.pCheckpoint != nullptr)
+		{
+			bool bLoaded = false;
+			if (!LoadCheckpoint(stOptions.pCheckpoint, stOptions, u32Shards, vecCheckpoint, bLoaded))
+			{
+				fprintf(stderr, "Error: checkpoint [%s] is corrupted or does not match the options\n", stOptions.pCheckpoint);
+				return false;
+			}
+			if (bLoaded)
+			{
+				stResumed = Merge(vecCheckpoint);
+				printf("Resume from checkpoint [%s]: %" PRIu64 "/%" PRIu64 " games done\n", stOptions.pCheckpoint, CountDone(vecCheckpoint), stOptions.u64Games);
+			}
+		}
+
+		//命名只用于shm_open，映射之后立即删除名字
+		std::string strName = "/Game2048_shard_" + std::to_string(getpid());
+		int iFd = shm_open(strName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (iFd < 0)
+		{
+			fprintf(stderr, "Error: shm_open [%s] failed: %s\n", strName.c_str(), strerror(errno));
+			return false;
+		}
+		size_t szMapSize = sizeof(Shard_Slot) * u32Shards;
+		void *pMap = ftruncate(iFd, (off_t)szMapSize) == 0 ? mmap(nullptr, szMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0) : MAP_FAILED;
+		int iErrno = errno;
+		shm_unlink(strName.c_str());
+		close(iFd);
+		if (pMap == MAP_FAILED)
+		{
+			fprintf(stderr, "Error: cannot map shared memory: %s\n", strerror(iErrno));
+			return false;
+		}
+
+		Shard_Slot *pSlots = (Shard_Slot *)pMap;
+		for (uint32_t i = 0; i < u32Shards; ++i)
+		{
+			new (&pSlots[i]) Shard_Slot{};
+			memcpy((void *)&pSlots[i].stState, &vecCheckpoint[i], sizeof(Shard_State));
+		}
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		std::vector<pid_t> vecPids(u32Shards, 0);
+		std::vector<uint32_t> vecRestarts(u32Shards, 0);
+		uint32_t u32Running = 0;
+		bool bOk = true;
+		for (uint32_t i = 0; i < u32Shards && bOk; ++i)
+		{
+			if (vecCheckpoint[i].u64Next >= vecCheckpoint[i].u64End)
+			{
+				continue;//检查点中已完成
+			}
+
+			vecPids[i] = Spawn(stOptions, pSlots[i], vecCheckpoint[i]);
+			if (vecPids[i] < 0)
+			{
+				fprintf(stderr, "Error: fork failed: %s\n", strerror(errno));
+				vecPids[i] = 0;
+				bOk = false;
+				break;
+			}
+			printf("Shard:[%" PRIu32 "] Pid:[%d] Games:[%" PRIu64 ", %" PRIu64 ")\n", i, (int)vecPids[i], vecCheckpoint[i].u64Next, vecCheckpoint[i].u64End);
+			++u32Running;
+		}
+
+		auto tpCheckpoint = std::chrono::steady_clock::now();
+		while (bOk && u32Running != 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			//回收退出的子进程，异常退出的从检查点重启
+			int iStatus = 0;
+			pid_t pid;
+			while (bOk && (pid = waitpid(-1, &iStatus, WNOHANG)) > 0)
+			{
+				uint32_t i = 0;
+				while (i < u32Shards && vecPids[i] != pid)
+				{
+					++i;
+				}
+				if (i == u32Shards)
+				{
+					continue;
+				}
+				vecPids[i] = 0;
+
+				Shard_State stFinal{};
+				if (WIFEXITED(iStatus) && WEXITSTATUS(iStatus) == 0 && TryRead(pSlots[i], stFinal) && stFinal.u64Next == stFinal.u64End)
+				{
+					vecCheckpoint[i] = stFinal;
+					--u32Running;
+					continue;
+				}
+
+				if (WIFSIGNALED(iStatus))
+				{
+					printf("Shard:[%" PRIu32 "] killed by signal %d", i, WTERMSIG(iStatus));
+				}
+				else
+				{
+					printf("Shard:[%" PRIu32 "] exited with status %d", i, WIFEXITED(iStatus) ? WEXITSTATUS(iStatus) : -1);
+				}
+				if (vecRestarts[i] >= stOptions.u32MaxRestarts)
+				{
+					printf("\n");
+					fprintf(stderr, "Error: shard [%" PRIu32 "] failed %" PRIu32 " time(s), giving up\n", i, vecRestarts[i] + 1);
+					bOk = false;
+					break;
+				}
+
+				++vecRestarts[i];
+				vecPids[i] = Spawn(stOptions, pSlots[i], vecCheckpoint[i]);
+				if (vecPids[i] < 0)
+				{
+					printf("\n");
+					fprintf(stderr, "Error: fork failed: %s\n", strerror(errno));
+					vecPids[i] = 0;
+					bOk = false;
+					break;
+				}
+				printf(", restarted from game %" PRIu64 " as Pid:[%d]\n", vecCheckpoint[i].u64Next, (int)vecPids[i]);
+			}
+
+			//定时读出所有运行中分片的最新发布作为检查点
+			auto tpNow = std::chrono::steady_clock::now();
+			if (bOk && u32Running != 0 && std::chrono::duration<double>(tpNow - tpCheckpoint).count() >= stOptions.dInterval)
+			{
+				tpCheckpoint = tpNow;
+				for (uint32_t i = 0; i < u32Shards; ++i)
+				{
+					Shard_State stState{};
+					if (vecPids[i] > 0 && TryRead(pSlots[i], stState))
+					{
+						vecCheckpoint[i] = stState;
+					}
+				}
+
+				if (stOptions.pCheckpoint != nullptr && !SaveCheckpoint(stOptions.pCheckpoint, stOptions, vecCheckpoint))
+				{
+					fprintf(stderr, "Error: cannot save checkpoint [%s]\n", stOptions.pCheckpoint);
+				}
+				printf("Progress:[%.1f s] Games:[%" PRIu64 "/%" PRIu64 "] Running:[%" PRIu32 "]\n",
+					std::chrono::duration<double>(tpNow - tpBeg).count(), CountDone(vecCheckpoint), stOptions.u64Games, u32Running);
+				fflush(stdout);
+			}
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		KillAll(vecPids);
+		munmap(pMap, szMapSize);
+
+		if (stOptions.pCheckpoint != nullptr && !SaveCheckpoint(stOptions.pCheckpoint, stOptions, vecCheckpoint))
+		{
+			fprintf(stderr, "Error: cannot save checkpoint [%s]\n", stOptions.pCheckpoint);
+			bOk = false;
+		}
+		if (!bOk)
+		{
+			return false;
+		}
+
+		stResult = Merge(vecCheckpoint);
+		stResult.u64Resumed = stResumed.stStats.Games();
+		stResult.u64ResumedMoves = stResumed.stStats.Moves().u64Sum;
+		for (uint32_t u32Restarts : vecRestarts)
+		{
+			stResult.u32Restarts += u32Restarts;
+		}
+		stResult.dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		return true;
+	}
+#else
+public:
+	static bool RunShards(const Options &stOptions, Result &stResult)
+	{
+		fprintf(stderr, "Error: shard mode is only supported on Linux, use --shards 0\n");
+		return false;
+	}
+#endif
+
+	//不分进程，在本进程内顺序运行全部对局
+	static Result RunLocal(const Options &stOptions)
+	{
+		std::vector<Shard_State> vecStates{};
+		InitStates(stOptions, 1, vecStates);
+
+		Game2048_Core core(0);
+		auto tpBeg = std::chrono::steady_clock::now();
+		while (vecStates[0].u64Next < vecStates[0].u64End)
+		{
+			PlayGame(stOptions, core, vecStates[0]);
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		Result stResult = Merge(vecStates);
+		stResult.u32Shards = 0;
+		stResult.dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		return stResult;
+	}
+
+	static int Main(const Command_Line &cmd)
+	{
+		Options stOptions{};
+		stOptions.u64Games = cmd.GetU64("games", stOptions.u64Games);
+		stOptions.u32SeedBase = (uint32_t)cmd.GetU64("seed", stOptions.u32SeedBase);
+		stOptions.u32Shards = (uint32_t)cmd.GetU64("shards", std::thread::hardware_concurrency());
+		stOptions.pPolicy = cmd.GetString("policy", stOptions.pPolicy);
+		stOptions.pCheckpoint = cmd.GetString("checkpoint");
+		stOptions.dInterval = cmd.GetDouble("interval", stOptions.dInterval);
+		stOptions.u32MaxRestarts = (uint32_t)cmd.GetU64("max-restarts", stOptions.u32MaxRestarts);
+
+		Game2048_Policy_Options policyOptions{};
+		if (!policyOptions.Load(cmd, true))
+		{
+			return 1;
+		}
+		stOptions.stContext = policyOptions.stContext;
+
+		if (Game2048_Policy::Create(stOptions.pPolicy, 0, stOptions.stContext) == nullptr)
+		{
+			fprintf(stderr, "Error: unknown policy [%s]\n", stOptions.pPolicy);
+			return 1;
+		}
+
+		Result stResult{};
+		if (stOptions.u32Shards == 0)
+		{
+			stResult = RunLocal(stOptions);
+		}
+		else if (!RunShards(stOptions, stResult))
+		{
+			return 1;
+		}
+
+		const Game2048_Stats &stStats = stResult.stStats;
+		printf("Policy:[%s] Games:[%" PRIu64 "] Shards:[%" PRIu32 "] Restarts:[%" PRIu32 "]\n",
+			stOptions.pPolicy, stStats.Games(), stResult.u32Shards, stResult.u32Restarts);
+		if (stStats.Games() != stResult.u64Resumed)
+		{
+			printf("Time:[%.3f s] %.0f games/s, %.0f moves/s\n", stResult.dSeconds,
+				(stStats.Games() - stResult.u64Resumed) / stResult.dSeconds, (stStats.Moves().u64Sum - stResult.u64ResumedMoves) / stResult.dSeconds);
+		}
+		stStats.Print(stdout);
+		printf("Digest:[%016" PRIx64 "]\n", stResult.u64Digest);
+
+		return 0;
+	}
+};
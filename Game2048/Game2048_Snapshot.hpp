@@ -0,0 +1,235 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <filesystem>
+#include <system_error>
+
+#if defined(_WIN32)
+	#include <io.h>//_commit
+#elif defined(__linux__)
+	#include <unistd.h>//fsync
+#endif
+
+#include "Game2048_Core.hpp"
+#include "Game2048_Record.hpp"
+
+/*
+对局快照：退出时保存，启动时恢复
+
+文件格式（小端序）：
+	[u32 魔数 'G2SV'][u16 版本][u16 棋盘格式][u32 负载大小][u32 保留]
+	[负载]
+
+版本1的负载：
+	[棋盘：由棋盘格式决定]
+	[u64 分数][u32 状态][u32 种子][f64 数字2权重][f64 数字4权重][u64 已取随机数个数]
+	[u8 是否有录像][录像（格式见Game2048_Record.hpp）]
+
+棋盘格式：
+	1：16个u64数值，行优先
+
+读取时按版本与棋盘格式分别解析，以后更换棋盘表示只需要新增格式，旧快照依然可读，
+负载大小用于跳过新版本追加在末尾的字段
+
+写入时先写临时文件并刷到磁盘，然后原子重命名覆盖，中途崩溃也不会留下损坏的快照
+*/
+class Game2048_Snapshot
+{
+public:
+	constexpr const static inline uint32_t u32Magic = 0x56533247;//'G2SV'
+	constexpr const static inline uint16_t u16Version = 1;
+
+	enum BoardFormat : uint16_t
+	{
+		Board_U64Values = 1,
+	};
+
+private:
+	template<typename T>
+	static bool WriteValue(FILE *pFile, const T &tValue)
+	{
+		return fwrite(&tValue, sizeof(tValue), 1, pFile) == 1;
+	}
+
+	template<typename T>
+	static bool ReadValue(FILE *pFile, T &tValue)
+	{
+		return fread(&tValue, sizeof(tValue), 1, pFile) == 1;
+	}
+
+	template<typename State>
+	static bool WritePayload(FILE *pFile, const State &stState, const Game2048_Record *pRecord)
+	{
+		bool bRet = true;
+		for (auto u64Val : stState.u64Tile)
+		{
+			bRet = bRet && WriteValue(pFile, u64Val);
+		}
+
+		const uint8_t u8HasRecord = pRecord != nullptr;
+		return bRet &&
+			WriteValue(pFile, stState.u64GameScore) &&
+			WriteValue(pFile, stState.u32GameStatus) &&
+			WriteValue(pFile, stState.u32GameSeed) &&
+			WriteValue(pFile, stState.dSpawnWeights_2) &&
+			WriteValue(pFile, stState.dSpawnWeights_4) &&
+			WriteValue(pFile, stState.u64RandDraws) &&
+			WriteValue(pFile, u8HasRecord) &&
+			(pRecord == nullptr || pRecord->Write(pFile));
+	}
+
+	//lPayloadEnd为负载结束的文件位置，录像不能超出负载
+	template<typename State>
+	static bool ReadPayload(FILE *pFile, uint16_t u16BoardFormat, long lPayloadEnd, State &stState, Game2048_Record &record, bool &bHasRecord)
+	{
+		bool bRet = false;
+		switch (u16BoardFormat)
+		{
+		case Board_U64Values:
+			bRet = true;
+			for (auto &u64Val : stState.u64Tile)
+			{
+				bRet = bRet && ReadValue(pFile, u64Val);
+			}
+			break;
+		default://未知的棋盘格式
+			return false;
+		}
+
+		uint8_t u8HasRecord = 0;
+		bRet = bRet &&
+			ReadValue(pFile, stState.u64GameScore) &&
+			ReadValue(pFile, stState.u32GameStatus) &&
+			ReadValue(pFile, stState.u32GameSeed) &&
+			ReadValue(pFile, stState.dSpawnWeights_2) &&
+			ReadValue(pFile, stState.dSpawnWeights_4) &&
+			ReadValue(pFile, stState.u64RandDraws) &&
+			ReadValue(pFile, u8HasRecord);
+
+		bHasRecord = u8HasRecord != 0;
+		long lPos = bRet ? ftell(pFile) : -1;
+		return lPos >= 0 && lPos <= lPayloadEnd &&
+			(!bHasRecord || (record.Read(pFile, (uint64_t)(lPayloadEnd - lPos)) && ftell(pFile) <= lPayloadEnd));
+	}
+
+public:
+	//pRecord可为空，Core为经典规则的引擎（Game2048_Core或Game2048_Core_Interactive）
+	template<typename Core>
+	static bool Save(const char *pPath, const Core &core, const Game2048_Record *pRecord)
+	{
+		std::string strTemp = std::string(pPath) + ".tmp";
+
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		const uint16_t u16BoardFormat = Board_U64Values;
+		const uint32_t u32Reserved = 0;
+		uint32_t u32PayloadSize = 0;
+
+		//先写头部占位，写完负载后再回填大小
+		bool bRet =
+			WriteValue(pFile, u32Magic) &&
+			WriteValue(pFile, u16Version) &&
+			WriteValue(pFile, u16BoardFormat) &&
+			WriteValue(pFile, u32PayloadSize) &&
+			WriteValue(pFile, u32Reserved);
+
+		long lPayloadBeg = ftell(pFile);
+		bRet = bRet && WritePayload(pFile, core.GetState(), pRecord);
+		u32PayloadSize = (uint32_t)(ftell(pFile) - lPayloadBeg);
+
+		bRet = bRet &&
+			fseek(pFile, sizeof(u32Magic) + sizeof(u16Version) + sizeof(u16BoardFormat), SEEK_SET) == 0 &&
+			WriteValue(pFile, u32PayloadSize) &&
+			fflush(pFile) == 0;
+
+#if defined(_WIN32)
+		bRet = bRet && _commit(_fileno(pFile)) == 0;
+#elif defined(__linux__)
+		bRet = bRet && fsync(fileno(pFile)) == 0;
+#endif
+
+		bRet = fclose(pFile) == 0 && bRet;
+
+		std::error_code ec{};
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, pPath, ec);//原子替换
+		}
+		if (!bRet || ec)
+		{
+			std::filesystem::remove(strTemp, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+	//成功返回true，pRecord不为空且快照中有录像时一并恢复
+	template<typename Core>
+	static bool Load(const char *pPath, Core &core, Game2048_Record *pRecord)
+	{
+		FILE *pFile = fopen(pPath, "rb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		uint32_t u32FileMagic = 0;
+		uint16_t u16FileVersion = 0;
+		uint16_t u16BoardFormat = 0;
+		uint32_t u32PayloadSize = 0;
+		uint32_t u32Reserved = 0;
+
+		typename Core::State stState{};
+		Game2048_Record record{};
+		bool bHasRecord = false;
+
+		bool bRet =
+			ReadValue(pFile, u32FileMagic) && u32FileMagic == u32Magic &&
+			ReadValue(pFile, u16FileVersion) && u16FileVersion >= 1 && u16FileVersion <= u16Version &&
+			ReadValue(pFile, u16BoardFormat) &&
+			ReadValue(pFile, u32PayloadSize) &&
+			ReadValue(pFile, u32Reserved);
+
+		//负载必须完整地在文件中
+		long lPayloadBeg = bRet ? ftell(pFile) : -1;
+		long lFileSize = lPayloadBeg >= 0 && fseek(pFile, 0, SEEK_END) == 0 ? ftell(pFile) : -1;
+		long lPayloadEnd = lPayloadBeg + (long)u32PayloadSize;
+		bRet = bRet && lFileSize >= lPayloadEnd &&
+			fseek(pFile, lPayloadBeg, SEEK_SET) == 0 &&
+			ReadPayload(pFile, u16BoardFormat, lPayloadEnd, stState, record, bHasRecord);
+
+		fclose(pFile);
+
+		if (!bRet || !core.SetState(stState))
+		{
+			return false;
+		}
+
+		if (pRecord != nullptr)
+		{
+			if (bHasRecord)
+			{
+				*pRecord = std::move(record);
+			}
+			else//没有录像则无法从头回放，从当前种子重新开始也不对，只能清空
+			{
+				pRecord->Reset(stState.u32GameSeed, stState.dSpawnWeights_2, stState.dSpawnWeights_4);
+			}
+		}
+
+		return true;
+	}
+
+	static void Remove(const char *pPath)
+	{
+		std::error_code ec{};
+		std::filesystem::remove(pPath, ec);
+	}
+};
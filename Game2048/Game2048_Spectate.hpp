@@ -0,0 +1,589 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Wide.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_Policy_Options.hpp"
+#include "Game2048_Render.hpp"
+#include "Local_Socket.hpp"
+
+#if defined(__linux__)
+	#include <errno.h>
+	#include <signal.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <sys/epoll.h>
+	#include <sys/resource.h>
+	#include <sys/socket.h>
+	#include <sys/uio.h>
+#endif
+
+/*
+观战直播（仅Linux）：一个线程用策略进行对局，同时把棋盘推送给任意多个观众（Unix域套接字或127.0.0.1上的TCP连接，直接用终端连接即可观看）
+
+每次棋盘变化只编码一次：帧是引用计数的只读缓冲（shared_ptr），内容为相对上一帧的ANSI差量（只重写分数与变化的格子，见Game2048_Render::FormatBoardDiff），
+所有观众的发送队列共享同一个帧对象，发送时用writev直接引用帧的缓冲，每个观众只多一个指针与一次系统调用，不复制数据
+完整画面（关键帧）在新对局、格子宽度变化、新观众加入或有观众跳帧时才生成，同一棋盘最多生成一次，由所有需要的观众共享
+
+观众积压的数据超过限制时不产生背压：丢弃其队列中未开始发送的帧，改为发送最新的关键帧（正在发送的帧会先发完，不会截断转义序列），
+对局速度与其它观众都不受影响；没有观众时不编码任何帧
+
+用法：
+	Game2048 spectate [--unix 路径 | --port P] [--policy 名称] [--weights 文件 | --heuristic 文件] [--book 文件] [--depth D] [--rollouts R] [--seed S] [--games N] [--speed 每秒步数] [--viewers N]
+	--port    默认2049
+	--speed   默认20，0为不限速
+	--viewers 等到有N个观众后才开始对局，默认0
+	结束时输出帧数、编码与发送的字节数、跳帧次数与CPU占用
+*/
+class Game2048_Spectate
+{
+public:
+	struct Options
+	{
+		const char *pUnixPath = nullptr;
+		uint16_t u16Port = 2049;
+		uint64_t u64Games = 1;
+		double dMovesPerSecond = 20.0;
+		uint64_t u64WaitViewers = 0;
+	};
+
+#if defined(__linux__)
+private:
+	constexpr const static inline size_t szMaxEvents = 256;
+	constexpr const static inline size_t szMaxPending = 64 * 1024;//观众积压超过该值则跳到最新关键帧
+	constexpr const static inline size_t szMaxIov = 64;//每次writev最多引用的帧数
+
+	struct Frame
+	{
+		std::string strData;
+		uint64_t u64Seq;//对应的棋盘序号
+	};
+
+	using Frame_Ptr = std::shared_ptr<const Frame>;
+
+	struct Viewer
+	{
+		int iFd = -1;
+		size_t szIndex = 0;//在vecViewers中的位置
+		std::deque<Frame_Ptr> dequeFrames{};
+		size_t szFrontPos = 0;//队首帧已发送的字节数
+		size_t szPending = 0;//队列中未发送的字节数
+		bool bWantWrite = false;//已注册EPOLLOUT
+	};
+
+	struct Stats
+	{
+		uint64_t u64Frames = 0;//编码的差量帧数
+		uint64_t u64Keyframes = 0;//生成的关键帧数
+		uint64_t u64BytesEncoded = 0;
+		uint64_t u64BytesSent = 0;
+		uint64_t u64Skips = 0;
+		uint64_t u64Viewers = 0;//累计加入的观众数
+		size_t szPeakViewers = 0;
+	};
+
+	class Broadcaster
+	{
+	private:
+		int iListenFd;
+		int iEpollFd;
+		std::vector<Viewer *> vecViewers;
+
+		Board_Wide::Board stBoard;
+		uint64_t u64Score;
+		uint64_t u64Seq;//每次棋盘变化加一
+		Frame_Ptr spKeyframe;//最近生成的关键帧，序号与u64Seq相同时可以直接复用
+
+		Stats stStats;
+
+	private:
+		Frame_Ptr GetKeyframe(void)
+		{
+			if (spKeyframe == nullptr || spKeyframe->u64Seq != u64Seq)
+			{
+				auto spFrame = std::make_shared<Frame>();
+				spFrame->strData = "\033[2J\033[H";
+				Game2048_Render::FormatBoard(spFrame->strData, stBoard, u64Score);
+				spFrame->u64Seq = u64Seq;
+
+				++stStats.u64Keyframes;
+				stStats.u64BytesEncoded += spFrame->strData.size();
+				spKeyframe = std::move(spFrame);
+			}
+
+			return spKeyframe;
+		}
+
+		void Enqueue(Viewer &viewer, Frame_Ptr spFrame)
+		{
+			viewer.szPending += spFrame->strData.size();
+			viewer.dequeFrames.push_back(std::move(spFrame));
+		}
+
+		//丢弃未开始发送的帧，改为最新的关键帧
+		void SkipToKeyframe(Viewer &viewer)
+		{
+			size_t szKeep = viewer.szFrontPos != 0 ? 1 : 0;//正在发送的帧必须发完
+			while (viewer.dequeFrames.size() > szKeep)
+			{
+				viewer.szPending -= viewer.dequeFrames.back()->strData.size();
+				viewer.dequeFrames.pop_back();
+			}
+
+			Enqueue(viewer, GetKeyframe());
+			++stStats.u64Skips;
+		}
+
+		bool SetWantWrite(Viewer &viewer, bool bWantWrite)
+		{
+			if (bWantWrite == viewer.bWantWrite)
+			{
+				return true;
+			}
+
+			epoll_event stEvent{};
+			stEvent.events = EPOLLIN | (bWantWrite ? (uint32_t)EPOLLOUT : 0);
+			stEvent.data.ptr = &viewer;
+			if (epoll_ctl(iEpollFd, EPOLL_CTL_MOD, viewer.iFd, &stEvent) != 0)
+			{
+				return false;
+			}
+			viewer.bWantWrite = bWantWrite;
+			return true;
+		}
+
+		//尽量写出队列，写不完则注册EPOLLOUT，返回false代表连接已失效
+		bool Send(Viewer &viewer)
+		{
+			while (!viewer.dequeFrames.empty())
+			{
+				iovec stIov[szMaxIov];
+				size_t szIov = 0;
+				for (const Frame_Ptr &spFrame : viewer.dequeFrames)
+				{
+					size_t szOffset = szIov == 0 ? viewer.szFrontPos : 0;
+					stIov[szIov].iov_base = (void *)(spFrame->strData.data() + szOffset);
+					stIov[szIov].iov_len = spFrame->strData.size() - szOffset;
+					if (++szIov == szMaxIov)
+					{
+						break;
+					}
+				}
+
+				msghdr stMsg{};
+				stMsg.msg_iov = stIov;
+				stMsg.msg_iovlen = szIov;
+				ssize_t sszSend = sendmsg(viewer.iFd, &stMsg, MSG_NOSIGNAL);
+				if (sszSend < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+					{
+						break;
+					}
+					return false;
+				}
+
+				stStats.u64BytesSent += (uint64_t)sszSend;
+				viewer.szPending -= (size_t)sszSend;
+				size_t szSent = (size_t)sszSend + viewer.szFrontPos;
+				while (!viewer.dequeFrames.empty() && szSent >= viewer.dequeFrames.front()->strData.size())
+				{
+					szSent -= viewer.dequeFrames.front()->strData.size();
+					viewer.dequeFrames.pop_front();
+				}
+				viewer.szFrontPos = szSent;
+			}
+
+			return SetWantWrite(viewer, !viewer.dequeFrames.empty());
+		}
+
+		void Close(Viewer *pViewer)
+		{
+			epoll_ctl(iEpollFd, EPOLL_CTL_DEL, pViewer->iFd, NULL);
+			close(pViewer->iFd);
+
+			//与最后一个交换后删除
+			Viewer *pLast = vecViewers.back();
+			pLast->szIndex = pViewer->szIndex;
+			vecViewers[pViewer->szIndex] = pLast;
+			vecViewers.pop_back();
+
+			delete pViewer;
+		}
+
+		void Accept(void)
+		{
+			while (true)
+			{
+				int iFd = accept4(iListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (iFd < 0)
+				{
+					if (errno == EINTR || errno == ECONNABORTED)
+					{
+						continue;
+					}
+					if (errno != EAGAIN && errno != EWOULDBLOCK)
+					{
+						fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+					}
+					return;
+				}
+
+				Viewer *pViewer = new Viewer{};
+				pViewer->iFd = iFd;
+
+				epoll_event stEvent{};
+				stEvent.events = EPOLLIN;
+				stEvent.data.ptr = pViewer;
+				if (epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iFd, &stEvent) != 0)
+				{
+					close(iFd);
+					delete pViewer;
+					continue;
+				}
+
+				pViewer->szIndex = vecViewers.size();
+				vecViewers.push_back(pViewer);
+				++stStats.u64Viewers;
+				stStats.szPeakViewers = vecViewers.size() > stStats.szPeakViewers ? vecViewers.size() : stStats.szPeakViewers;
+
+				//新观众从当前棋盘的关键帧开始
+				Enqueue(*pViewer, GetKeyframe());
+				if (!Send(*pViewer))
+				{
+					Close(pViewer);
+				}
+			}
+		}
+
+		void HandleEvent(Viewer *pViewer, uint32_t u32Events)
+		{
+			if (u32Events & (EPOLLERR | EPOLLHUP))
+			{
+				Close(pViewer);
+				return;
+			}
+
+			if (u32Events & EPOLLIN)
+			{
+				//观众的输入没有意义，读出丢弃，读到结尾说明观众已离开
+				char cBuffer[256];
+				ssize_t sszRecv = recv(pViewer->iFd, cBuffer, sizeof(cBuffer), 0);
+				if (sszRecv == 0 || (sszRecv < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				{
+					Close(pViewer);
+					return;
+				}
+			}
+
+			if ((u32Events & EPOLLOUT) && !Send(*pViewer))
+			{
+				Close(pViewer);
+			}
+		}
+
+	public:
+		Broadcaster(int _iListenFd) :
+			iListenFd(_iListenFd),
+			iEpollFd(-1),
+			vecViewers(),
+
+			stBoard{},
+			u64Score(0),
+			u64Seq(0),
+			spKeyframe(nullptr),
+
+			stStats()
+		{}
+		~Broadcaster(void)
+		{
+			while (!vecViewers.empty())
+			{
+				Close(vecViewers.back());
+			}
+			if (iEpollFd >= 0)
+			{
+				close(iEpollFd);
+			}
+		}
+
+		Broadcaster(const Broadcaster &) = delete;
+		Broadcaster &operator=(const Broadcaster &) = delete;
+
+		bool Init(void)
+		{
+			iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+			if (iEpollFd < 0)
+			{
+				fprintf(stderr, "Error: epoll_create1 failed: %s\n", strerror(errno));
+				return false;
+			}
+
+			epoll_event stEvent{};
+			stEvent.events = EPOLLIN;
+			stEvent.data.ptr = nullptr;
+			if (epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iListenFd, &stEvent) != 0)
+			{
+				fprintf(stderr, "Error: epoll_ctl failed: %s\n", strerror(errno));
+				return false;
+			}
+
+			return true;
+		}
+
+		//发布新的棋盘，bNewGame为true时所有观众收到关键帧
+		void Publish(const Board_Wide::Board &stNewBoard, uint64_t u64NewScore, bool bNewGame)
+		{
+			Board_Wide::Board stPrev = stBoard;
+			uint64_t u64PrevScore = u64Score;
+			stBoard = stNewBoard;
+			u64Score = u64NewScore;
+			++u64Seq;
+
+			if (vecViewers.empty())
+			{
+				return;//没有观众不编码
+			}
+
+			//编码一次，所有观众共享
+			Frame_Ptr spFrame{};
+			auto spDelta = std::make_shared<Frame>();
+			if (!bNewGame && Game2048_Render::FormatBoardDiff(spDelta->strData, stPrev, u64PrevScore, stBoard, u64Score))
+			{
+				spDelta->u64Seq = u64Seq;
+				++stStats.u64Frames;
+				stStats.u64BytesEncoded += spDelta->strData.size();
+				spFrame = std::move(spDelta);
+			}
+			else
+			{
+				spFrame = GetKeyframe();
+			}
+
+			//Close会调整数组，倒序遍历
+			for (size_t i = vecViewers.size(); i-- > 0;)
+			{
+				Viewer &viewer = *vecViewers[i];
+				if (viewer.szPending + spFrame->strData.size() > szMaxPending)
+				{
+					SkipToKeyframe(viewer);
+				}
+				else
+				{
+					Enqueue(viewer, spFrame);
+				}
+
+				if (!viewer.bWantWrite && !Send(viewer))//已在等待可写的观众由事件循环发送
+				{
+					Close(&viewer);
+				}
+			}
+		}
+
+		//处理连接与可写事件，最多等待iTimeoutMs毫秒（0为不等待）
+		void Poll(int iTimeoutMs)
+		{
+			epoll_event stEvents[szMaxEvents];
+			int iCount = epoll_wait(iEpollFd, stEvents, (int)szMaxEvents, iTimeoutMs);
+			for (int i = 0; i < iCount; ++i)
+			{
+				if (stEvents[i].data.ptr == nullptr)
+				{
+					Accept();
+				}
+				else
+				{
+					HandleEvent((Viewer *)stEvents[i].data.ptr, stEvents[i].events);
+				}
+			}
+		}
+
+		size_t ViewerCount(void) const
+		{
+			return vecViewers.size();
+		}
+
+		//所有观众的队列都已发送
+		bool IsDrained(void) const
+		{
+			for (const Viewer *pViewer : vecViewers)
+			{
+				if (!pViewer->dequeFrames.empty())
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		const Stats &GetStats(void) const
+		{
+			return stStats;
+		}
+	};
+
+	static double CpuSeconds(void)
+	{
+		rusage stUsage{};
+		getrusage(RUSAGE_SELF, &stUsage);
+		return (double)(stUsage.ru_utime.tv_sec + stUsage.ru_stime.tv_sec) + (double)(stUsage.ru_utime.tv_usec + stUsage.ru_stime.tv_usec) / 1e6;
+	}
+
+	//在tpUntil之前处理网络事件
+	static void PollUntil(Broadcaster &broadcaster, std::chrono::steady_clock::time_point tpUntil)
+	{
+		while (true)
+		{
+			auto durLeft = tpUntil - std::chrono::steady_clock::now();
+			if (durLeft <= std::chrono::steady_clock::duration::zero())
+			{
+				broadcaster.Poll(0);
+				return;
+			}
+			broadcaster.Poll((int)std::chrono::ceil<std::chrono::milliseconds>(durLeft).count());
+		}
+	}
+
+public:
+	static int Run(const Options &stOptions, Game2048_Policy &policy, uint32_t u32SeedBase)
+	{
+		signal(SIGPIPE, SIG_IGN);
+
+		int iListenFd = Local_Socket::Listen(stOptions.pUnixPath, stOptions.u16Port);
+		if (iListenFd < 0)
+		{
+			return 1;
+		}
+
+		Broadcaster broadcaster(iListenFd);
+		if (!broadcaster.Init())
+		{
+			close(iListenFd);
+			return 1;
+		}
+
+		if (stOptions.pUnixPath != nullptr)
+		{
+			printf("Broadcasting on unix:%s\n", stOptions.pUnixPath);
+		}
+		else
+		{
+			printf("Broadcasting on 127.0.0.1:%u\n", (unsigned)stOptions.u16Port);
+		}
+		fflush(stdout);
+
+		while (broadcaster.ViewerCount() < stOptions.u64WaitViewers)
+		{
+			broadcaster.Poll(-1);
+		}
+
+		auto durStep = stOptions.dMovesPerSecond > 0
+			? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / stOptions.dMovesPerSecond))
+			: std::chrono::steady_clock::duration::zero();
+
+		Game2048_Core core(u32SeedBase);
+		uint64_t u64Moves = 0;
+		double dCpuBeg = CpuSeconds();
+		auto tpBeg = std::chrono::steady_clock::now();
+		auto tpNext = tpBeg;
+		for (uint64_t g = 0; g < stOptions.u64Games; ++g)
+		{
+			core.NewGame((uint32_t)(u32SeedBase + g));
+			broadcaster.Publish(core.GetWideBoard(), core.GetScore(), true);
+
+			while (core.GetStatus() == Game2048_Core::InGame)
+			{
+				if (!core.ProcessMove((Game2048_Core::Direction)policy.Choose(core.GetPackedBoard())))
+				{
+					break;//策略必须给出有效方向，这里仅作保护
+				}
+				++u64Moves;
+				broadcaster.Publish(core.GetWideBoard(), core.GetScore(), false);
+
+				tpNext += durStep;
+				PollUntil(broadcaster, tpNext);
+			}
+		}
+
+		//等待观众收完最后的画面，最多1秒
+		auto tpDrain = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+		while (!broadcaster.IsDrained() && std::chrono::steady_clock::now() < tpDrain)
+		{
+			broadcaster.Poll(10);
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+		double dCpu = CpuSeconds() - dCpuBeg;
+
+		const Stats &stStats = broadcaster.GetStats();
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		printf("Games:[%" PRIu64 "] Moves:[%" PRIu64 "] Time:[%.3f s] CPU:[%.3f s %.1f%%]\n",
+			stOptions.u64Games, u64Moves, dSeconds, dCpu, dSeconds > 0 ? 100.0 * dCpu / dSeconds : 0.0);
+		printf("Viewers:[%" PRIu64 " joined, %zu peak] Frames:[%" PRIu64 "] Keyframes:[%" PRIu64 "] Encoded:[%" PRIu64 " B] Sent:[%" PRIu64 " B] Skips:[%" PRIu64 "]\n",
+			stStats.u64Viewers, stStats.szPeakViewers, stStats.u64Frames, stStats.u64Keyframes, stStats.u64BytesEncoded, stStats.u64BytesSent, stStats.u64Skips);
+
+		close(iListenFd);
+		if (stOptions.pUnixPath != nullptr)
+		{
+			unlink(stOptions.pUnixPath);
+		}
+		return 0;
+	}
+#else
+public:
+	static int Run(const Options &stOptions, Game2048_Policy &policy, uint32_t u32SeedBase)
+	{
+		fprintf(stderr, "Error: spectate mode is only supported on Linux\n");
+		return 1;
+	}
+#endif
+
+	static int Main(const Command_Line &cmd)
+	{
+		Options stOptions{};
+		stOptions.pUnixPath = cmd.GetString("unix");
+		stOptions.u16Port = (uint16_t)cmd.GetU64("port", stOptions.u16Port);
+		stOptions.u64Games = cmd.GetU64("games", stOptions.u64Games);
+		stOptions.dMovesPerSecond = cmd.GetDouble("speed", stOptions.dMovesPerSecond);
+		stOptions.u64WaitViewers = cmd.GetU64("viewers", stOptions.u64WaitViewers);
+		uint32_t u32SeedBase = cmd.HasFlag("seed") ? (uint32_t)cmd.GetU64("seed", 0) : std::random_device{}();
+		const char *pPolicy = cmd.GetString("policy", "expectimax");
+
+		Game2048_Policy_Options policyOptions{};
+		if (!policyOptions.Load(cmd, true))
+		{
+			return 1;
+		}
+		const Game2048_Policy::Context &stContext = policyOptions.stContext;
+
+		auto upPolicy = Game2048_Policy::Create(pPolicy, u32SeedBase, stContext);
+		if (upPolicy == nullptr)
+		{
+			fprintf(stderr, "Error: unknown policy [%s]\n", pPolicy);
+			return 1;
+		}
+		if (stOptions.u64Games == 0)
+		{
+			fprintf(stderr, "Error: nothing to play\n");
+			return 1;
+		}
+
+		return Run(stOptions, *upPolicy, u32SeedBase);
+	}
+};
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "Log_Histogram.hpp"
+#include "Game2048_Core.hpp"
+
+/*
+流式对局统计：不保存逐局结果，内存大小固定（两个直方图约30KB），与局数无关
+	结局（GameStatus）与最大数字（按指数）为精确计数
+	分数与步数为可合并的分位数估计（Log_Histogram，相对误差约3%），均值与最大值精确
+每个工作线程持有自己的统计，定期或结束时Merge到共享的统计（加锁），任何时候都可以对共享统计的副本调用Print输出快照
+*/
+class Game2048_Stats
+{
+public:
+	constexpr const static inline size_t szStatusCount = 3;//InGame WinGame LostGame
+	constexpr const static inline size_t szExpCount = 64;//指数最大为63
+
+private:
+	Log_Histogram histScore;
+	Log_Histogram histMoves;
+	uint64_t u64Status[szStatusCount];
+	uint64_t u64MaxTile[szExpCount];
+
+	static void PrintHistogram(FILE *pFile, const char *pName, const Log_Histogram &hist)
+	{
+		fprintf(pFile, "%-6s Mean:[%.1f] P10:[%" PRIu64 "] P50:[%" PRIu64 "] P90:[%" PRIu64 "] P99:[%" PRIu64 "] Max:[%" PRIu64 "]\n",
+			pName, hist.Mean(), hist.Quantile(0.1), hist.Quantile(0.5), hist.Quantile(0.9), hist.Quantile(0.99), hist.u64Max);
+	}
+
+public:
+	Game2048_Stats(void) :
+		histScore(),
+		histMoves(),
+		u64Status{},
+		u64MaxTile{}
+	{}
+	~Game2048_Stats(void) = default;
+
+	Game2048_Stats(const Game2048_Stats &) = default;
+	Game2048_Stats &operator=(const Game2048_Stats &) = default;
+
+	void Record(uint64_t u64Score, uint64_t u64Moves, uint8_t u8MaxExp, Game2048_Core_Base::GameStatus enStatus)
+	{
+		histScore.Record(u64Score);
+		histMoves.Record(u64Moves);
+		++u64Status[(size_t)enStatus < szStatusCount ? (size_t)enStatus : 0];
+		++u64MaxTile[u8MaxExp < szExpCount ? u8MaxExp : szExpCount - 1];
+	}
+
+	void Merge(const Game2048_Stats &stOther)
+	{
+		histScore.Merge(stOther.histScore);
+		histMoves.Merge(stOther.histMoves);
+		for (size_t i = 0; i < szStatusCount; ++i)
+		{
+			u64Status[i] += stOther.u64Status[i];
+		}
+		for (size_t i = 0; i < szExpCount; ++i)
+		{
+			u64MaxTile[i] += stOther.u64MaxTile[i];
+		}
+	}
+
+	void Reset(void)
+	{
+		*this = Game2048_Stats{};
+	}
+
+	uint64_t Games(void) const
+	{
+		return histScore.u64Count;
+	}
+
+	const Log_Histogram &Score(void) const
+	{
+		return histScore;
+	}
+
+	const Log_Histogram &Moves(void) const
+	{
+		return histMoves;
+	}
+
+	uint64_t StatusCount(Game2048_Core_Base::GameStatus enStatus) const
+	{
+		return u64Status[enStatus];
+	}
+
+	uint64_t MaxTileCount(uint8_t u8Exp) const
+	{
+		return u64MaxTile[u8Exp];
+	}
+
+	void Print(FILE *pFile) const
+	{
+		uint64_t u64Games = Games();
+		double dGames = u64Games != 0 ? (double)u64Games : 1.0;
+
+		fprintf(pFile, "Games:[%" PRIu64 "] Win:[%" PRIu64 " %.2f%%] Lost:[%" PRIu64 " %.2f%%] Unfinished:[%" PRIu64 "]\n",
+			u64Games,
+			u64Status[Game2048_Core_Base::WinGame], 100.0 * u64Status[Game2048_Core_Base::WinGame] / dGames,
+			u64Status[Game2048_Core_Base::LostGame], 100.0 * u64Status[Game2048_Core_Base::LostGame] / dGames,
+			u64Status[Game2048_Core_Base::InGame]);
+		PrintHistogram(pFile, "Score", histScore);
+		PrintHistogram(pFile, "Moves", histMoves);
+
+		//最大数字的分布，以及到达该数字（最大数字不小于它）的比例
+		fprintf(pFile, "MaxTile");
+		uint64_t u64Reached = u64Games;
+		for (size_t i = 0; i < szExpCount; ++i)
+		{
+			if (u64MaxTile[i] != 0)
+			{
+				fprintf(pFile, " %" PRIu64 ":[%" PRIu64 " >=%.2f%%]", i != 0 ? (uint64_t)1 << i : 0, u64MaxTile[i], 100.0 * u64Reached / dGames);
+			}
+			u64Reached -= u64MaxTile[i];
+		}
+		fprintf(pFile, "\n");
+	}
+};
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <chrono>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_NTuple.hpp"
+
+/*
+对称规范化的基准测试：
+	1.用真实对局中的棋盘测量Canonical单次耗时
+	2.相同种子下分别用原始棋盘与规范形式作为expectimax缓存键，比较命中率、缓存大小与总耗时
+
+用法：
+	Game2048 symmetry [--games N] [--seed S] [--depth D] [--weights 文件]
+*/
+class Game2048_Symmetry_Bench
+{
+private:
+	struct Run_Result
+	{
+		uint64_t u64Moves = 0;
+		uint64_t u64ScoreSum = 0;
+		double dSeconds = 0;
+		Policy_Expectimax::Cache_Stats stStats{};
+	};
+
+	static Run_Result RunExpectimax(const Game2048_Policy::Context &stContext, uint64_t u64Games, uint32_t u32SeedBase)
+	{
+		Policy_Expectimax policy(stContext.pEvaluator != nullptr ? *stContext.pEvaluator : Evaluator_Empty::Instance(), stContext.u32Depth, stContext.bCanonical);
+		Game2048_Core core(0);
+		Run_Result stResult{};
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		for (uint64_t g = 0; g < u64Games; ++g)
+		{
+			core.NewGame((uint32_t)(u32SeedBase + g));
+			while (core.GetStatus() == Game2048_Core::InGame &&
+				core.ProcessMove((Game2048_Core::Direction)policy.Choose(core.GetPackedBoard())))
+			{
+				++stResult.u64Moves;
+			}
+			stResult.u64ScoreSum += core.GetScore();
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		stResult.dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		stResult.stStats = policy.GetCacheStats();
+		return stResult;
+	}
+
+	static void PrintRun(const char *pName, const Run_Result &stResult, uint64_t u64Games)
+	{
+		const Policy_Expectimax::Cache_Stats &stStats = stResult.stStats;
+		printf("%-9s AvgScore:[%.1f] Moves:[%" PRIu64 "] Time:[%.3f s] %.0f moves/s Lookups:[%" PRIu64 "] HitRate:[%.2f%%] AvgEntries:[%.1f]\n",
+			pName,
+			(double)stResult.u64ScoreSum / u64Games,
+			stResult.u64Moves, stResult.dSeconds, stResult.u64Moves / stResult.dSeconds,
+			stStats.u64Lookups,
+			stStats.u64Lookups != 0 ? 100.0 * stStats.u64Hits / stStats.u64Lookups : 0.0,
+			stResult.u64Moves != 0 ? (double)stStats.u64Entries / stResult.u64Moves : 0.0);
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		uint64_t u64Games = cmd.GetU64("games", 10);
+		uint32_t u32SeedBase = (uint32_t)cmd.GetU64("seed", 0);
+
+		Game2048_Policy::Context stContext{};
+		stContext.u32Depth = (uint32_t)cmd.GetU64("depth", 3);
+
+		Game2048_NTuple ntuple{};
+		const char *pWeightsPath = cmd.GetString("weights");
+		if (pWeightsPath != nullptr)
+		{
+			if (!ntuple.Load(pWeightsPath, false))
+			{
+				fprintf(stderr, "Error: cannot load weights [%s]\n", pWeightsPath);
+				return 1;
+			}
+			stContext.pEvaluator = &ntuple;
+		}
+
+		//收集真实对局中的棋盘
+		std::vector<Board_Packed::Board> vecBoards{};
+		{
+			auto upPolicy = Game2048_Policy::Create("greedy", 0);
+			Game2048_Core core(0);
+			for (uint32_t g = 0; g < 100; ++g)
+			{
+				core.NewGame(u32SeedBase + g);
+				while (core.GetStatus() == Game2048_Core::InGame)
+				{
+					vecBoards.push_back(core.GetPackedBoard());
+					core.ProcessMove((Game2048_Core::Direction)upPolicy->Choose(vecBoards.back()));
+				}
+			}
+		}
+
+		constexpr const static size_t szRepeat = 100;
+		uint64_t u64Sink = 0;//防止被优化掉
+		auto tpBeg = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < szRepeat; ++r)
+		{
+			for (auto u64Board : vecBoards)
+			{
+				u64Sink ^= Board_Packed::Canonical(u64Board ^ r);
+			}
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+		double dNanoseconds = std::chrono::duration<double, std::nano>(tpEnd - tpBeg).count() / (szRepeat * vecBoards.size());
+
+		printf("Canonical: %.2f ns/board (%zu boards, checksum %016" PRIX64 ")\n", dNanoseconds, vecBoards.size(), u64Sink);
+
+		//同样的种子分别运行两种缓存键
+		stContext.bCanonical = false;
+		Run_Result stRaw = RunExpectimax(stContext, u64Games, u32SeedBase);
+		stContext.bCanonical = true;
+		Run_Result stCanonical = RunExpectimax(stContext, u64Games, u32SeedBase);
+
+		printf("Expectimax depth %" PRIu32 ", %" PRIu64 " games:\n", stContext.u32Depth, u64Games);
+		PrintRun("Raw", stRaw, u64Games);
+		PrintRun("Canonical", stCanonical, u64Games);
+		printf("Time per move: raw %.2f us, canonical %.2f us\n",
+			1e6 * stRaw.dSeconds / stRaw.u64Moves, 1e6 * stCanonical.dSeconds / stCanonical.u64Moves);
+
+		return 0;
+	}
+};
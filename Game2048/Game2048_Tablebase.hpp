@@ -0,0 +1,1091 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+//根据平台切换输入
+#if defined(_WIN32)
+	#include "Console_Input_Windows.hpp"
+	#include "Windows_Keys.hpp"
+#elif defined(__linux__)
+	#include "Console_Input_Linux.hpp"
+	#include "Linux_Keys.hpp"
+#endif
+
+#include "Console_Output.hpp"
+#include "Command_Line.hpp"
+#include "Board_Small.hpp"
+#include "Mapped_File.hpp"
+#include "Fast_Rand.hpp"
+
+/*
+小棋盘残局库：对指定宽高与目标数字，穷举所有可达局面并求出最优策略下达到目标的概率（精确值）
+
+求解：
+	移动不改变数字之和，每次生成使和增加2或4，所以局面按数字之和分层，
+	正向：从开局的两个数字开始逐层展开，得到每一层的全部可达局面（规范形式）
+	反向：从和最大的层开始逐层向前，局面的值 = 所有有效移动中 移动后棋盘期望值 的最大值，
+		移动后出现目标数字则为1，没有有效移动则为0，否则对所有空格与2(90%)/4(10%)取期望
+	每层都以有序文件的形式保存在磁盘上，展开时的后继先在内存中排序去重，超过内存上限就写成有序段，
+	最后多路归并，所以内存只受--memory限制；展开与求值都按块分给多个线程
+
+文件格式（小端序）：
+	[u32 魔数 'G2TB'][u16 版本][u8 宽][u8 高][u8 目标指数][u8 保留 * 3][u32 层数][u64 局面总数]
+	[层索引 * 层数：u64 数字之和][u64 局面数][u64 键偏移][u64 值偏移]
+	[每层：u64 有序的规范棋盘 * 局面数][f64 胜率 * 局面数]
+查找时先按数字之和二分到层，再在层内二分，局面在有序键中的位置就是它的完美哈希，整个文件直接mmap使用
+
+用法：
+	Game2048 tablebase build 文件 [--width W] [--height H] [--target 数字] [--threads T] [--memory MB]
+	Game2048 tablebase info 文件 [--board 十六进制棋盘]
+	Game2048 tablebase play 文件 [--seed S]
+*/
+class Game2048_Tablebase
+{
+public:
+	using Board = Board_Small::Board;
+	using Direction = Board_Small::Direction;
+
+	constexpr const static inline uint32_t u32Magic = 0x42543247;//'G2TB'
+	constexpr const static inline uint16_t u16Version = 1;
+
+	struct File_Header
+	{
+		uint32_t u32Magic;
+		uint16_t u16Version;
+		uint8_t u8Width;
+		uint8_t u8Height;
+		uint8_t u8TargetExponent;
+		uint8_t u8Reserved[3];
+		uint32_t u32LayerCount;
+		uint64_t u64StateCount;
+	};
+
+	struct Layer_Entry
+	{
+		uint64_t u64TileSum;
+		uint64_t u64Count;
+		uint64_t u64KeysOffset;
+		uint64_t u64ValuesOffset;
+	};
+
+	static_assert(sizeof(File_Header) == 24 && sizeof(Layer_Entry) == 32);
+
+private:
+	Mapped_File mapFile;
+	const File_Header *pHeader;
+	const Layer_Entry *pLayers;
+	std::unique_ptr<Board_Small> upBoard;
+
+public:
+	//移动后棋盘的值：出现目标数字为1，否则对所有空格与2/4取期望，
+	//fnLookup(生成后的棋盘, 生成的指数)返回生成后局面的值，求解与查询共用
+	template<typename Lookup_Func>
+	static double ChanceValue(const Board_Small &board, Board u64After, uint8_t u8TargetExponent, Lookup_Func &&fnLookup)
+	{
+		if (board.MaxExponent(u64After) >= u8TargetExponent)
+		{
+			return 1.0;
+		}
+
+		double dSum = 0.0;
+		size_t szEmpty = 0;
+		for (size_t i = 0; i < board.Cells(); ++i)
+		{
+			if (Board_Small::GetCell(u64After, i) != 0)
+			{
+				continue;
+			}
+
+			++szEmpty;
+			dSum += 0.9 * fnLookup(Board_Small::SetCell(u64After, i, 1), (uint8_t)1);
+			dSum += 0.1 * fnLookup(Board_Small::SetCell(u64After, i, 2), (uint8_t)2);
+		}
+
+		return szEmpty != 0 ? dSum / szEmpty : 0.0;
+	}
+
+	//在有序键中二分查找，不存在返回UINT64_MAX
+	static uint64_t FindKey(const Board *pKeys, uint64_t u64Count, Board u64Key)
+	{
+		const Board *pEnd = pKeys + u64Count;
+		const Board *pFind = std::lower_bound(pKeys, pEnd, u64Key);
+		return pFind != pEnd && *pFind == u64Key ? (uint64_t)(pFind - pKeys) : UINT64_MAX;
+	}
+
+public:
+	Game2048_Tablebase(void) :
+		mapFile(),
+		pHeader(nullptr),
+		pLayers(nullptr),
+		upBoard()
+	{}
+	~Game2048_Tablebase(void) = default;
+
+	Game2048_Tablebase(const Game2048_Tablebase &) = delete;
+	Game2048_Tablebase &operator=(const Game2048_Tablebase &) = delete;
+
+	bool Open(const char *pPath)
+	{
+		Close();
+		if (!mapFile.Open(pPath))
+		{
+			return false;
+		}
+
+		pHeader = mapFile.At<File_Header>(0);
+		if (pHeader == nullptr ||
+			pHeader->u32Magic != u32Magic ||
+			pHeader->u16Version != u16Version ||
+			!Board_Small::IsValidSize(pHeader->u8Width, pHeader->u8Height))
+		{
+			Close();
+			return false;
+		}
+
+		pLayers = mapFile.At<Layer_Entry>(sizeof(File_Header), pHeader->u32LayerCount);
+		if (pLayers == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		for (uint32_t i = 0; i < pHeader->u32LayerCount; ++i)
+		{
+			if (mapFile.At<Board>(pLayers[i].u64KeysOffset, pLayers[i].u64Count) == nullptr ||
+				mapFile.At<double>(pLayers[i].u64ValuesOffset, pLayers[i].u64Count) == nullptr)
+			{
+				Close();
+				return false;
+			}
+		}
+
+		upBoard = std::make_unique<Board_Small>(pHeader->u8Width, pHeader->u8Height);
+		return true;
+	}
+
+	void Close(void)
+	{
+		mapFile.Close();
+		pHeader = nullptr;
+		pLayers = nullptr;
+		upBoard.reset();
+	}
+
+	const Board_Small &GetBoard(void) const
+	{
+		return *upBoard;
+	}
+
+	uint8_t TargetExponent(void) const
+	{
+		return pHeader->u8TargetExponent;
+	}
+
+	uint32_t LayerCount(void) const
+	{
+		return pHeader->u32LayerCount;
+	}
+
+	uint64_t StateCount(void) const
+	{
+		return pHeader->u64StateCount;
+	}
+
+	const Layer_Entry &GetLayer(uint32_t u32Index) const
+	{
+		return pLayers[u32Index];
+	}
+
+	//局面（生成数字后、移动前）在最优策略下达到目标的概率，不在表中返回-1
+	double Lookup(Board u64Board) const
+	{
+		uint64_t u64Sum = upBoard->TileSum(u64Board);
+		const Layer_Entry *pEnd = pLayers + pHeader->u32LayerCount;
+		const Layer_Entry *pLayer = std::lower_bound(pLayers, pEnd, u64Sum,
+			[](const Layer_Entry &stEntry, uint64_t u64Value) -> bool
+			{
+				return stEntry.u64TileSum < u64Value;
+			});
+		if (pLayer == pEnd || pLayer->u64TileSum != u64Sum)
+		{
+			return -1.0;
+		}
+
+		const Board *pKeys = mapFile.At<Board>(pLayer->u64KeysOffset, pLayer->u64Count);
+		uint64_t u64Index = FindKey(pKeys, pLayer->u64Count, upBoard->Canonical(u64Board));
+		if (u64Index == UINT64_MAX)
+		{
+			return -1.0;
+		}
+
+		return mapFile.At<double>(pLayer->u64ValuesOffset, pLayer->u64Count)[u64Index];
+	}
+
+	//某个方向的值，无效方向返回-1
+	double MoveValue(Board u64Board, Direction dMove) const
+	{
+		Board u64After = upBoard->Move(u64Board, dMove);
+		if (u64After == u64Board)
+		{
+			return -1.0;
+		}
+
+		return ChanceValue(*upBoard, u64After, pHeader->u8TargetExponent,
+			[this](Board u64Next, uint8_t) -> double
+			{
+				double dValue = Lookup(u64Next);
+				return dValue > 0.0 ? dValue : 0.0;
+			});
+	}
+
+	//最优方向，没有有效方向返回Enum_End
+	Direction BestMove(Board u64Board, double &dBestValue) const
+	{
+		Direction dBest = Board_Packed::Enum_End;
+		dBestValue = 0.0;
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			double dValue = MoveValue(u64Board, (Direction)d);
+			if (dValue >= 0.0 && (dBest == Board_Packed::Enum_End || dValue > dBestValue))
+			{
+				dBest = (Direction)d;
+				dBestValue = dValue;
+			}
+		}
+
+		return dBest;
+	}
+};
+
+class Game2048_Tablebase_Solver
+{
+public:
+	using Board = Board_Small::Board;
+	using Direction = Board_Small::Direction;
+
+	struct Options
+	{
+		size_t szWidth = 3;
+		size_t szHeight = 3;
+		uint8_t u8TargetExponent = 8;
+		uint32_t u32Threads = 0;//0为硬件线程数
+		size_t szMemoryMB = 256;//排序缓冲区总大小
+		const char *pOutput = nullptr;
+	};
+
+private:
+	struct Layer
+	{
+		uint64_t u64TileSum;
+		uint64_t u64Count;
+		std::string strKeys;
+		std::string strValues;
+	};
+
+	//带缓冲的有序段读取
+	class Run_Reader
+	{
+	private:
+		FILE *pFile;
+		std::vector<Board> vecBuffer;
+		size_t szPos;
+		size_t szLength;
+
+	public:
+		Run_Reader(const std::string &strPath) :
+			pFile(fopen(strPath.c_str(), "rb")),
+			vecBuffer(16384),
+			szPos(0),
+			szLength(0)
+		{}
+		~Run_Reader(void)
+		{
+			if (pFile != NULL)
+			{
+				fclose(pFile);
+			}
+		}
+
+		Run_Reader(const Run_Reader &) = delete;
+		Run_Reader &operator=(const Run_Reader &) = delete;
+
+		bool IsOpen(void) const
+		{
+			return pFile != NULL;
+		}
+
+		bool Next(Board &u64Value)
+		{
+			if (szPos == szLength)
+			{
+				szLength = fread(vecBuffer.data(), sizeof(Board), vecBuffer.size(), pFile);
+				szPos = 0;
+				if (szLength == 0)
+				{
+					return false;
+				}
+			}
+
+			u64Value = vecBuffer[szPos++];
+			return true;
+		}
+	};
+
+	constexpr const static inline size_t szChunk = 4096;//线程每次领取的局面数
+	constexpr const static inline size_t szBlock = (size_t)1 << 20;//反向求值每块的局面数
+
+	const Options &stOptions;
+	Board_Small board;
+	std::filesystem::path pathWork;
+	uint32_t u32Threads;
+	size_t szBufferLimit;//每个线程每个缓冲区的最大元素数
+
+	std::mutex mtxRuns;
+	std::map<uint64_t, std::vector<std::string>> mapRuns;//各层尚未归并的有序段
+	uint64_t u64RunCounter;
+	std::atomic<bool> bFailed;
+
+	std::vector<Layer> vecLayers;
+
+private:
+	//排序去重后写成一个有序段
+	void SpillRun(uint64_t u64TileSum, std::vector<Board> &vecBuffer)
+	{
+		if (vecBuffer.empty())
+		{
+			return;
+		}
+
+		std::sort(vecBuffer.begin(), vecBuffer.end());
+		vecBuffer.erase(std::unique(vecBuffer.begin(), vecBuffer.end()), vecBuffer.end());
+
+		std::string strPath{};
+		{
+			std::lock_guard<std::mutex> lock(mtxRuns);
+			strPath = (pathWork / ("run_" + std::to_string(u64RunCounter++) + ".bin")).string();
+		}
+
+		FILE *pFile = fopen(strPath.c_str(), "wb");
+		bool bRet = pFile != NULL && fwrite(vecBuffer.data(), sizeof(Board), vecBuffer.size(), pFile) == vecBuffer.size();
+		bRet = pFile != NULL && fclose(pFile) == 0 && bRet;
+		if (!bRet)
+		{
+			bFailed.store(true, std::memory_order_relaxed);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mtxRuns);
+			mapRuns[u64TileSum].push_back(std::move(strPath));
+		}
+		vecBuffer.clear();
+	}
+
+	//多路归并去重为一层
+	bool MergeRuns(const std::vector<std::string> &vecRuns, const std::string &strOut, uint64_t &u64Count)
+	{
+		std::vector<std::unique_ptr<Run_Reader>> vecReaders{};
+		using Heap_Item = std::pair<Board, size_t>;
+		std::priority_queue<Heap_Item, std::vector<Heap_Item>, std::greater<Heap_Item>> queHeap{};
+
+		for (const auto &it : vecRuns)
+		{
+			vecReaders.push_back(std::make_unique<Run_Reader>(it));
+			Board u64Value = 0;
+			if (!vecReaders.back()->IsOpen())
+			{
+				return false;
+			}
+			if (vecReaders.back()->Next(u64Value))
+			{
+				queHeap.push({ u64Value, vecReaders.size() - 1 });
+			}
+		}
+
+		FILE *pFile = fopen(strOut.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		std::vector<Board> vecOut{};
+		vecOut.reserve(16384);
+		bool bRet = true;
+		bool bHasLast = false;
+		Board u64Last = 0;
+		u64Count = 0;
+
+		while (!queHeap.empty())
+		{
+			auto [u64Value, szRun] = queHeap.top();
+			queHeap.pop();
+
+			Board u64Next = 0;
+			if (vecReaders[szRun]->Next(u64Next))
+			{
+				queHeap.push({ u64Next, szRun });
+			}
+
+			if (bHasLast && u64Value == u64Last)
+			{
+				continue;
+			}
+			bHasLast = true;
+			u64Last = u64Value;
+			++u64Count;
+
+			vecOut.push_back(u64Value);
+			if (vecOut.size() == vecOut.capacity())
+			{
+				bRet = bRet && fwrite(vecOut.data(), sizeof(Board), vecOut.size(), pFile) == vecOut.size();
+				vecOut.clear();
+			}
+		}
+
+		bRet = bRet && fwrite(vecOut.data(), sizeof(Board), vecOut.size(), pFile) == vecOut.size();
+		bRet = fclose(pFile) == 0 && bRet;
+
+		vecReaders.clear();
+		std::error_code ec{};
+		for (const auto &it : vecRuns)
+		{
+			std::filesystem::remove(it, ec);
+		}
+
+		return bRet;
+	}
+
+	//展开一层的所有局面，后继按数字之和写入有序段
+	void ExpandWorker(const Board *pKeys, uint64_t u64Count, uint64_t u64TileSum, std::atomic<uint64_t> &u64Next)
+	{
+		std::vector<Board> vecNext[2]{};//生成2与生成4的后继
+		vecNext[0].reserve(szBufferLimit);
+		vecNext[1].reserve(szBufferLimit);
+
+		while (true)
+		{
+			uint64_t u64Beg = u64Next.fetch_add(szChunk, std::memory_order_relaxed);
+			if (u64Beg >= u64Count)
+			{
+				break;
+			}
+			uint64_t u64End = u64Count - u64Beg < szChunk ? u64Count : u64Beg + szChunk;
+
+			for (uint64_t i = u64Beg; i < u64End; ++i)
+			{
+				Board u64Board = pKeys[i];
+				for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+				{
+					Board u64After = board.Move(u64Board, (Direction)d);
+					if (u64After == u64Board || board.MaxExponent(u64After) >= stOptions.u8TargetExponent)
+					{
+						continue;//无效移动或已达到目标（终局）
+					}
+
+					for (size_t c = 0; c < board.Cells(); ++c)
+					{
+						if (Board_Small::GetCell(u64After, c) != 0)
+						{
+							continue;
+						}
+
+						for (uint8_t k = 0; k < 2; ++k)
+						{
+							vecNext[k].push_back(board.Canonical(Board_Small::SetCell(u64After, c, k + 1)));
+							if (vecNext[k].size() >= szBufferLimit)
+							{
+								SpillRun(u64TileSum + ((uint64_t)2 << k), vecNext[k]);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		SpillRun(u64TileSum + 2, vecNext[0]);
+		SpillRun(u64TileSum + 4, vecNext[1]);
+	}
+
+	bool Forward(void)
+	{
+		//开局：任意两个格子各放一个2或4
+		{
+			std::vector<Board> vecInit[3]{};//和为4、6、8
+			for (size_t i = 0; i < board.Cells(); ++i)
+			{
+				for (size_t j = i + 1; j < board.Cells(); ++j)
+				{
+					for (uint8_t a = 1; a <= 2; ++a)
+					{
+						for (uint8_t b = 1; b <= 2; ++b)
+						{
+							vecInit[a + b - 2].push_back(board.Canonical(Board_Small::SetCell(Board_Small::SetCell(0, i, a), j, b)));
+						}
+					}
+				}
+			}
+			for (size_t k = 0; k < 3; ++k)
+			{
+				SpillRun(4 + 2 * k, vecInit[k]);
+			}
+		}
+
+		while (!mapRuns.empty() && !bFailed.load(std::memory_order_relaxed))
+		{
+			auto itRuns = mapRuns.begin();
+			Layer stLayer{ itRuns->first, 0, (pathWork / ("layer_" + std::to_string(itRuns->first) + ".keys")).string(), {} };
+			std::vector<std::string> vecRuns = std::move(itRuns->second);
+			mapRuns.erase(itRuns);
+
+			if (!MergeRuns(vecRuns, stLayer.strKeys, stLayer.u64Count))
+			{
+				return false;
+			}
+
+			Mapped_File mapKeys{};
+			if (!mapKeys.Open(stLayer.strKeys.c_str()))
+			{
+				return false;
+			}
+
+			auto tpBeg = std::chrono::steady_clock::now();
+			std::atomic<uint64_t> u64Next{ 0 };
+			std::vector<std::thread> vecThreads{};
+			for (uint32_t i = 0; i < u32Threads; ++i)
+			{
+				vecThreads.emplace_back(&Game2048_Tablebase_Solver::ExpandWorker, this, mapKeys.At<Board>(0, stLayer.u64Count), stLayer.u64Count, stLayer.u64TileSum, std::ref(u64Next));
+			}
+			for (auto &it : vecThreads)
+			{
+				it.join();
+			}
+			auto tpEnd = std::chrono::steady_clock::now();
+
+			printf("Forward: Sum:[%" PRIu64 "] States:[%" PRIu64 "] %.3f s\n", stLayer.u64TileSum, stLayer.u64Count, std::chrono::duration<double>(tpEnd - tpBeg).count());
+			fflush(stdout);
+			vecLayers.push_back(std::move(stLayer));
+		}
+
+		return !bFailed.load(std::memory_order_relaxed);
+	}
+
+	//一层的后继层（数字之和+2或+4），可能不存在
+	struct Successor_Layer
+	{
+		Mapped_File mapKeys;
+		Mapped_File mapValues;
+		const Board *pKeys = nullptr;
+		const double *pValues = nullptr;
+		uint64_t u64Count = 0;
+
+		bool Open(const Layer &stLayer)
+		{
+			if (!mapKeys.Open(stLayer.strKeys.c_str()) || !mapValues.Open(stLayer.strValues.c_str()))
+			{
+				return false;
+			}
+
+			u64Count = stLayer.u64Count;
+			pKeys = mapKeys.At<Board>(0, u64Count);
+			pValues = mapValues.At<double>(0, u64Count);
+			return pKeys != nullptr && pValues != nullptr;
+		}
+	};
+
+	void EvaluateWorker(const Board *pKeys, double *pValues, uint64_t u64Count, const Successor_Layer (&arrNext)[2], std::atomic<uint64_t> &u64Next)
+	{
+		auto fnLookup = [&](Board u64Board, uint8_t u8Exp) -> double
+		{
+			const Successor_Layer &stNext = arrNext[u8Exp - 1];
+			uint64_t u64Index = Game2048_Tablebase::FindKey(stNext.pKeys, stNext.u64Count, board.Canonical(u64Board));
+			if (u64Index == UINT64_MAX)
+			{
+				bFailed.store(true, std::memory_order_relaxed);//正向展开过的后继必然存在
+				return 0.0;
+			}
+			return stNext.pValues[u64Index];
+		};
+
+		while (true)
+		{
+			uint64_t u64Beg = u64Next.fetch_add(szChunk, std::memory_order_relaxed);
+			if (u64Beg >= u64Count)
+			{
+				break;
+			}
+			uint64_t u64End = u64Count - u64Beg < szChunk ? u64Count : u64Beg + szChunk;
+
+			for (uint64_t i = u64Beg; i < u64End; ++i)
+			{
+				double dBest = 0.0;//没有有效移动则为0
+				for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+				{
+					Board u64After = board.Move(pKeys[i], (Direction)d);
+					if (u64After == pKeys[i])
+					{
+						continue;
+					}
+
+					double dValue = Game2048_Tablebase::ChanceValue(board, u64After, stOptions.u8TargetExponent, fnLookup);
+					dBest = dValue > dBest ? dValue : dBest;
+				}
+				pValues[i] = dBest;
+			}
+		}
+	}
+
+	bool Backward(void)
+	{
+		std::vector<double> vecValues(szBlock);
+
+		for (size_t l = vecLayers.size(); l-- > 0;)
+		{
+			Layer &stLayer = vecLayers[l];
+			stLayer.strValues = (pathWork / ("layer_" + std::to_string(stLayer.u64TileSum) + ".values")).string();
+
+			//后继层在vecLayers中位于后面，数字之和分别为+2与+4
+			Successor_Layer arrNext[2]{};
+			for (size_t k = l + 1; k < vecLayers.size() && k <= l + 2; ++k)
+			{
+				uint64_t u64Delta = vecLayers[k].u64TileSum - stLayer.u64TileSum;
+				if ((u64Delta == 2 || u64Delta == 4) && !arrNext[u64Delta / 2 - 1].Open(vecLayers[k]))
+				{
+					return false;
+				}
+			}
+
+			Mapped_File mapKeys{};
+			FILE *pFile = fopen(stLayer.strValues.c_str(), "wb");
+			if (!mapKeys.Open(stLayer.strKeys.c_str()) || pFile == NULL)
+			{
+				if (pFile != NULL)
+				{
+					fclose(pFile);
+				}
+				return false;
+			}
+			const Board *pKeys = mapKeys.At<Board>(0, stLayer.u64Count);
+
+			auto tpBeg = std::chrono::steady_clock::now();
+			bool bRet = true;
+			for (uint64_t u64Beg = 0; bRet && u64Beg < stLayer.u64Count; u64Beg += szBlock)
+			{
+				uint64_t u64Length = stLayer.u64Count - u64Beg < szBlock ? stLayer.u64Count - u64Beg : szBlock;
+
+				std::atomic<uint64_t> u64Next{ 0 };
+				std::vector<std::thread> vecThreads{};
+				for (uint32_t i = 0; i < u32Threads; ++i)
+				{
+					vecThreads.emplace_back(&Game2048_Tablebase_Solver::EvaluateWorker, this, pKeys + u64Beg, vecValues.data(), u64Length, std::cref(arrNext), std::ref(u64Next));
+				}
+				for (auto &it : vecThreads)
+				{
+					it.join();
+				}
+
+				bRet = fwrite(vecValues.data(), sizeof(double), u64Length, pFile) == u64Length;
+			}
+			bRet = fclose(pFile) == 0 && bRet && !bFailed.load(std::memory_order_relaxed);
+			auto tpEnd = std::chrono::steady_clock::now();
+
+			if (!bRet)
+			{
+				return false;
+			}
+
+			printf("Backward: Sum:[%" PRIu64 "] States:[%" PRIu64 "] %.3f s\n", stLayer.u64TileSum, stLayer.u64Count, std::chrono::duration<double>(tpEnd - tpBeg).count());
+			fflush(stdout);
+		}
+
+		return true;
+	}
+
+	static bool AppendFile(FILE *pOut, const std::string &strPath)
+	{
+		FILE *pIn = fopen(strPath.c_str(), "rb");
+		if (pIn == NULL)
+		{
+			return false;
+		}
+
+		static char cBuffer[1 << 16];
+		bool bRet = true;
+		size_t szRead = 0;
+		while (bRet && (szRead = fread(cBuffer, 1, sizeof(cBuffer), pIn)) != 0)
+		{
+			bRet = fwrite(cBuffer, 1, szRead, pOut) == szRead;
+		}
+
+		fclose(pIn);
+		return bRet;
+	}
+
+	//把各层的键与值拼接成最终文件
+	bool Assemble(void)
+	{
+		Game2048_Tablebase::File_Header stHeader{};
+		stHeader.u32Magic = Game2048_Tablebase::u32Magic;
+		stHeader.u16Version = Game2048_Tablebase::u16Version;
+		stHeader.u8Width = (uint8_t)stOptions.szWidth;
+		stHeader.u8Height = (uint8_t)stOptions.szHeight;
+		stHeader.u8TargetExponent = stOptions.u8TargetExponent;
+		stHeader.u32LayerCount = (uint32_t)vecLayers.size();
+
+		std::vector<Game2048_Tablebase::Layer_Entry> vecEntries{};
+		uint64_t u64Offset = sizeof(stHeader) + vecLayers.size() * sizeof(Game2048_Tablebase::Layer_Entry);
+		for (const auto &it : vecLayers)
+		{
+			vecEntries.push_back({ it.u64TileSum, it.u64Count, u64Offset, u64Offset + it.u64Count * sizeof(Board) });
+			u64Offset += it.u64Count * (sizeof(Board) + sizeof(double));
+			stHeader.u64StateCount += it.u64Count;
+		}
+
+		std::string strTemp = std::string(stOptions.pOutput) + ".tmp";
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		bool bRet =
+			fwrite(&stHeader, sizeof(stHeader), 1, pFile) == 1 &&
+			fwrite(vecEntries.data(), sizeof(vecEntries[0]), vecEntries.size(), pFile) == vecEntries.size();
+		for (const auto &it : vecLayers)
+		{
+			bRet = bRet && AppendFile(pFile, it.strKeys) && AppendFile(pFile, it.strValues);
+		}
+		bRet = fclose(pFile) == 0 && bRet;
+
+		std::error_code ec{};
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, stOptions.pOutput, ec);
+		}
+		if (!bRet || ec)
+		{
+			std::filesystem::remove(strTemp, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+public:
+	Game2048_Tablebase_Solver(const Options &_stOptions) :
+		stOptions(_stOptions),
+		board(_stOptions.szWidth, _stOptions.szHeight),
+		pathWork(std::string(_stOptions.pOutput) + ".work"),
+		u32Threads(_stOptions.u32Threads != 0 ? _stOptions.u32Threads : std::thread::hardware_concurrency()),
+		szBufferLimit(0),
+		mtxRuns(),
+		mapRuns(),
+		u64RunCounter(0),
+		bFailed(false),
+		vecLayers()
+	{
+		u32Threads = u32Threads != 0 ? u32Threads : 1;
+		szBufferLimit = stOptions.szMemoryMB * 1024 * 1024 / sizeof(Board) / (2 * u32Threads);
+		szBufferLimit = szBufferLimit > szChunk ? szBufferLimit : szChunk;
+	}
+	~Game2048_Tablebase_Solver(void) = default;
+
+	Game2048_Tablebase_Solver(const Game2048_Tablebase_Solver &) = delete;
+	Game2048_Tablebase_Solver &operator=(const Game2048_Tablebase_Solver &) = delete;
+
+	bool Solve(void)
+	{
+		std::error_code ec{};
+		std::filesystem::create_directories(pathWork, ec);
+		if (ec)
+		{
+			return false;
+		}
+
+		bool bRet = Forward() && Backward() && Assemble();
+
+		std::filesystem::remove_all(pathWork, ec);
+		return bRet;
+	}
+};
+
+class Game2048_Tablebase_Tool
+{
+private:
+	using Board = Board_Small::Board;
+	using Direction = Board_Small::Direction;
+
+	constexpr const static inline char *const pDirectionName[Board_Packed::Enum_End] = { "Up", "Down", "Left", "Right" };
+
+	static int Build(const Command_Line &cmd, const char *pPath)
+	{
+		Game2048_Tablebase_Solver::Options stOptions{};
+		stOptions.szWidth = (size_t)cmd.GetU64("width", stOptions.szWidth);
+		stOptions.szHeight = (size_t)cmd.GetU64("height", stOptions.szHeight);
+		uint64_t u64Target = cmd.GetU64("target", Board_Packed::ExponentToValue(stOptions.u8TargetExponent));
+		stOptions.u32Threads = (uint32_t)cmd.GetU64("threads", stOptions.u32Threads);
+		stOptions.szMemoryMB = (size_t)cmd.GetU64("memory", stOptions.szMemoryMB);
+		stOptions.pOutput = pPath;
+
+		if (!Board_Small::IsValidSize(stOptions.szWidth, stOptions.szHeight))
+		{
+			fprintf(stderr, "Error: board size must be between %zu and %zu\n", Board_Small::szMinSide, Board_Small::szMaxSide);
+			return 1;
+		}
+		if (u64Target < 8 || (u64Target & (u64Target - 1)) != 0 || Board_Packed::ValueToExponent(u64Target) > Board_Packed::u8MaxExponent)
+		{
+			fprintf(stderr, "Error: target must be a power of two between 8 and %" PRIu64 "\n", Board_Packed::ExponentToValue(Board_Packed::u8MaxExponent));
+			return 1;
+		}
+		stOptions.u8TargetExponent = Board_Packed::ValueToExponent(u64Target);
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		Game2048_Tablebase_Solver solver(stOptions);
+		if (!solver.Solve())
+		{
+			fprintf(stderr, "Error: cannot build tablebase [%s]\n", pPath);
+			return 1;
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		printf("Time:[%.3f s]\n", std::chrono::duration<double>(tpEnd - tpBeg).count());
+		return Info(cmd, pPath);
+	}
+
+	static int Info(const Command_Line &cmd, const char *pPath)
+	{
+		Game2048_Tablebase tablebase{};
+		if (!tablebase.Open(pPath))
+		{
+			fprintf(stderr, "Error: cannot open tablebase [%s]\n", pPath);
+			return 1;
+		}
+
+		const Board_Small &board = tablebase.GetBoard();
+		printf("Board:[%zux%zu] Target:[%" PRIu64 "] Layers:[%" PRIu32 "] States:[%" PRIu64 "]\n",
+			board.Width(), board.Height(), Board_Packed::ExponentToValue(tablebase.TargetExponent()), tablebase.LayerCount(), tablebase.StateCount());
+
+		//所有开局的平均胜率（位置均匀，2与4按90%/10%）
+		double dSum = 0.0, dWeight = 0.0;
+		for (size_t i = 0; i < board.Cells(); ++i)
+		{
+			for (size_t j = i + 1; j < board.Cells(); ++j)
+			{
+				for (uint8_t a = 1; a <= 2; ++a)
+				{
+					for (uint8_t b = 1; b <= 2; ++b)
+					{
+						double dProb = (a == 1 ? 0.9 : 0.1) * (b == 1 ? 0.9 : 0.1);
+						dSum += dProb * tablebase.Lookup(Board_Small::SetCell(Board_Small::SetCell(0, i, a), j, b));
+						dWeight += dProb;
+					}
+				}
+			}
+		}
+		printf("Optimal win probability from a random start: %.9f\n", dSum / dWeight);
+
+		const char *pBoard = cmd.GetString("board");
+		if (pBoard != nullptr)
+		{
+			Board u64Board = strtoull(pBoard, NULL, 16);
+			printf("Board:[%" PRIX64 "] Value:[%.9f]\n", u64Board, tablebase.Lookup(u64Board));
+			for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+			{
+				printf("  %-5s %.9f\n", pDirectionName[d], tablebase.MoveValue(u64Board, (Direction)d));
+			}
+		}
+
+		return 0;
+	}
+
+	static Board Spawn(const Board_Small &board, Board u64Board, Fast_Rand &rand)
+	{
+		size_t szEmpty = board.CountEmpty(u64Board);
+		if (szEmpty == 0)
+		{
+			return u64Board;
+		}
+
+		size_t szNth = rand.Below((uint32_t)szEmpty);
+		uint8_t u8Exp = rand.Below(10) == 0 ? 2 : 1;
+		for (size_t i = 0; i < board.Cells(); ++i)
+		{
+			if (Board_Small::GetCell(u64Board, i) == 0 && szNth-- == 0)
+			{
+				return Board_Small::SetCell(u64Board, i, u8Exp);
+			}
+		}
+
+		return u64Board;
+	}
+
+	static void Draw(Console_Output &co, const Game2048_Tablebase &tablebase, Board u64Board, const char *pStatus)
+	{
+		const Board_Small &board = tablebase.GetBoard();
+
+		co.ClearScreen();
+		co.SetCursorBase();
+		printf("%zux%zu Tablebase, Target %" PRIu64, board.Width(), board.Height(), Board_Packed::ExponentToValue(tablebase.TargetExponent()));
+		co.NextLine(2);
+
+		for (size_t y = 0; y < board.Height(); ++y)
+		{
+			for (size_t x = 0; x < board.Width(); ++x)
+			{
+				uint64_t u64Value = Board_Packed::ExponentToValue(Board_Small::GetCell(u64Board, y * board.Width() + x));
+				if (u64Value == 0)
+				{
+					printf("[    ]");
+				}
+				else
+				{
+					printf("[%4" PRIu64 "]", u64Value);
+				}
+			}
+			co.NextLine();
+		}
+		co.NextLine();
+
+		//每个方向在最优策略下的胜率，最优方向用*标出
+		double dBestValue = 0.0;
+		Direction dBest = tablebase.BestMove(u64Board, dBestValue);
+		for (uint8_t d = 0; d < Board_Packed::Enum_End; ++d)
+		{
+			double dValue = tablebase.MoveValue(u64Board, (Direction)d);
+			if (dValue < 0.0)
+			{
+				printf("  %-5s   -", pDirectionName[d]);
+			}
+			else
+			{
+				printf("%c %-5s %8.4f%%", d == dBest ? '*' : ' ', pDirectionName[d], 100.0 * dValue);
+			}
+			co.NextLine();
+		}
+		co.NextLine();
+
+		printf("%s", pStatus);
+		co.NextLine();
+		printf("WASD/Arrows: Move  R: Restart  Q: Quit");
+		co.NextLine();
+		fflush(stdout);
+	}
+
+	static int Play(const Command_Line &cmd, const char *pPath)
+	{
+		Game2048_Tablebase tablebase{};
+		if (!tablebase.Open(pPath))
+		{
+			fprintf(stderr, "Error: cannot open tablebase [%s]\n", pPath);
+			return 1;
+		}
+
+		const Board_Small &board = tablebase.GetBoard();
+		Fast_Rand rand(cmd.HasFlag("seed") ? cmd.GetU64("seed", 0) : std::random_device{}());
+
+		Console_Input ci{};
+		Console_Output co{};
+		co.HideCursor();
+
+		Board u64Board = Spawn(board, Spawn(board, 0, rand), rand);
+		const char *pStatus = "";
+		while (true)
+		{
+			Draw(co, tablebase, u64Board, pStatus);
+
+			auto key = ci.WaitForKeys({
+				Keys::W, Keys::SHIFT_W, Keys::UP_ARROW,
+				Keys::S, Keys::SHIFT_S, Keys::DOWN_ARROW,
+				Keys::A, Keys::SHIFT_A, Keys::LEFT_ARROW,
+				Keys::D, Keys::SHIFT_D, Keys::RIGHT_ARROW,
+				Keys::R, Keys::SHIFT_R, Keys::Q, Keys::SHIFT_Q });
+
+			if (key == Keys::Q || key == Keys::SHIFT_Q)
+			{
+				break;
+			}
+			if (key == Keys::R || key == Keys::SHIFT_R)
+			{
+				u64Board = Spawn(board, Spawn(board, 0, rand), rand);
+				pStatus = "";
+				continue;
+			}
+
+			Direction dMove =
+				(key == Keys::W || key == Keys::SHIFT_W || key == Keys::UP_ARROW) ? Board_Packed::Up :
+				(key == Keys::S || key == Keys::SHIFT_S || key == Keys::DOWN_ARROW) ? Board_Packed::Dn :
+				(key == Keys::A || key == Keys::SHIFT_A || key == Keys::LEFT_ARROW) ? Board_Packed::Lt : Board_Packed::Rt;
+
+			if (*pStatus != '\0')//已经结束，只能重开或退出
+			{
+				continue;
+			}
+
+			Board u64After = board.Move(u64Board, dMove);
+			if (u64After == u64Board)
+			{
+				continue;
+			}
+
+			if (board.MaxExponent(u64After) >= tablebase.TargetExponent())
+			{
+				u64Board = u64After;
+				pStatus = "You Win!";
+				continue;
+			}
+
+			u64Board = Spawn(board, u64After, rand);
+			double dUnused = 0.0;
+			if (tablebase.BestMove(u64Board, dUnused) == Board_Packed::Enum_End)
+			{
+				pStatus = "You Lose!";
+			}
+		}
+
+		co.ShowCursor();
+		return 0;
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		std::string_view svCommand = cmd.Positional(1);
+		std::string_view svPath = cmd.Positional(2);
+		if (svPath.empty())
+		{
+			fprintf(stderr, "Usage: Game2048 tablebase build|info|play <file> [options]\n");
+			return 1;
+		}
+
+		if (svCommand == "build")
+		{
+			return Build(cmd, svPath.data());
+		}
+		else if (svCommand == "info")
+		{
+			return Info(cmd, svPath.data());
+		}
+		else if (svCommand == "play")
+		{
+			return Play(cmd, svPath.data());
+		}
+
+		fprintf(stderr, "Error: unknown tablebase command [%.*s]\n", (int)svCommand.size(), svCommand.data());
+		return 1;
+	}
+};
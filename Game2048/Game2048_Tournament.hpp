@@ -0,0 +1,391 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Fast_Rand.hpp"
+#include "Game2048_Policy.hpp"
+#include "Game2048_Policy_Options.hpp"
+
+/*
+策略评测：每个策略在同一组种子上对局，多线程分配对局，输出分数分布、到达各数字的比例与速度，
+并把报告写成JSON文件，修改引擎或启发函数后可以据此比较强度与速度
+
+对局不在2048处停止（与Game2048_Core不同），一直下到无法移动，所以可以统计4096、8192等更大数字的到达率
+第i局的生成随机数种子为起始种子+i，策略的随机数种子也只由局号决定，结果与线程数无关
+
+统计：
+	分数均值与95%置信区间（正态近似），中位数与若干百分位（最近秩）
+	到达率的95%置信区间使用Wilson区间，比例接近0或1、局数较少时也不会越界
+
+用法：
+	Game2048 tournament [--policies 名称,名称,...] [--games N] [--seed S] [--threads T]
+		[--weights 文件 | --heuristic 文件] [--depth D] [--rollouts R] [--report 文件]
+	默认评测random、greedy、montecarlo、expectimax，给出--weights时加上ntuple，报告默认写入Game2048_tournament.json
+	--heuristic 让expectimax使用行表启发评估（权重文件或default），调整权重后分别评测即可比较
+*/
+class Game2048_Tournament
+{
+public:
+	struct Options
+	{
+		std::vector<std::string> vecPolicies{};
+		uint64_t u64Games = 100;
+		uint32_t u32SeedBase = 0;
+		uint32_t u32Threads = 0;//0为硬件线程数
+		Game2048_Policy::Context stContext{};
+		const char *pWeightsPath = nullptr;//仅用于写入报告
+		const char *pHeuristicPath = nullptr;//仅用于写入报告
+	};
+
+	struct Game_Result
+	{
+		uint64_t u64Score = 0;
+		uint32_t u32Moves = 0;
+		uint8_t u8MaxExp = 0;
+	};
+
+	constexpr const static inline uint8_t u8ReachExp[] = { 11, 12, 13, 14 };//2048 4096 8192 16384
+	constexpr const static inline double dPercentiles[] = { 10, 25, 75, 90, 99 };
+
+	struct Interval
+	{
+		double dLow = 0;
+		double dHigh = 0;
+	};
+
+	struct Summary
+	{
+		std::string strPolicy{};
+		uint64_t u64Games = 0;
+		uint64_t u64Moves = 0;
+		double dSeconds = 0;
+
+		double dMean = 0;
+		double dStdDev = 0;
+		Interval stMeanCI{};
+		double dMedian = 0;
+		uint64_t u64Min = 0;
+		uint64_t u64Max = 0;
+		uint64_t u64Percentile[std::size(dPercentiles)] = {};
+
+		double dReachRate[std::size(u8ReachExp)] = {};
+		Interval stReachCI[std::size(u8ReachExp)] = {};
+	};
+
+private:
+	constexpr const static inline double dZ95 = 1.959963984540054;
+
+	static Game_Result PlayGame(Game2048_Policy &policy, uint64_t u64Seed)
+	{
+		Fast_Rand rand(u64Seed);
+		Board_Packed::Board u64Board = Board_Packed::SpawnRandom(Board_Packed::SpawnRandom(0, rand), rand);
+
+		Game_Result stResult{};
+		while (Board_Packed::LegalMoves(u64Board) != 0)
+		{
+			uint32_t u32Score = 0;
+			Board_Packed::Board u64After = Board_Packed::Move(u64Board, policy.Choose(u64Board), u32Score);
+			if (u64After == u64Board)
+			{
+				break;//策略必须给出有效方向，这里仅作保护
+			}
+
+			stResult.u64Score += u32Score;
+			++stResult.u32Moves;
+			u64Board = Board_Packed::SpawnRandom(u64After, rand);
+		}
+
+		stResult.u8MaxExp = Board_Packed::MaxExponent(u64Board);
+		return stResult;
+	}
+
+	static Interval Wilson(uint64_t u64Hits, uint64_t u64Total)
+	{
+		if (u64Total == 0)
+		{
+			return {};
+		}
+
+		double n = (double)u64Total;
+		double p = u64Hits / n;
+		double z2 = dZ95 * dZ95;
+		double dCenter = (p + z2 / (2 * n)) / (1 + z2 / n);
+		double dHalf = dZ95 * sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+		return { dCenter - dHalf, dCenter + dHalf };
+	}
+
+	static Summary Summarize(std::string_view svPolicy, const std::vector<Game_Result> &vecResults, double dSeconds)
+	{
+		Summary stSummary{};
+		stSummary.strPolicy = svPolicy;
+		stSummary.u64Games = vecResults.size();
+		stSummary.dSeconds = dSeconds;
+		if (vecResults.empty())
+		{
+			return stSummary;
+		}
+
+		std::vector<uint64_t> vecScores;
+		vecScores.reserve(vecResults.size());
+		uint64_t u64Reach[std::size(u8ReachExp)] = {};
+		double dSum = 0;
+		for (const auto &it : vecResults)
+		{
+			vecScores.push_back(it.u64Score);
+			stSummary.u64Moves += it.u32Moves;
+			dSum += (double)it.u64Score;
+			for (size_t k = 0; k < std::size(u8ReachExp); ++k)
+			{
+				u64Reach[k] += it.u8MaxExp >= u8ReachExp[k];
+			}
+		}
+		std::sort(vecScores.begin(), vecScores.end());
+
+		size_t n = vecScores.size();
+		stSummary.dMean = dSum / n;
+
+		double dSquares = 0;
+		for (uint64_t u64Score : vecScores)
+		{
+			double d = (double)u64Score - stSummary.dMean;
+			dSquares += d * d;
+		}
+		stSummary.dStdDev = n > 1 ? sqrt(dSquares / (n - 1)) : 0;
+		double dHalf = dZ95 * stSummary.dStdDev / sqrt((double)n);
+		stSummary.stMeanCI = { stSummary.dMean - dHalf, stSummary.dMean + dHalf };
+
+		stSummary.dMedian = n % 2 != 0 ? (double)vecScores[n / 2] : ((double)vecScores[n / 2 - 1] + (double)vecScores[n / 2]) / 2;
+		stSummary.u64Min = vecScores.front();
+		stSummary.u64Max = vecScores.back();
+		for (size_t k = 0; k < std::size(dPercentiles); ++k)
+		{
+			size_t szRank = (size_t)ceil(dPercentiles[k] / 100 * n);
+			stSummary.u64Percentile[k] = vecScores[szRank != 0 ? szRank - 1 : 0];
+		}
+
+		for (size_t k = 0; k < std::size(u8ReachExp); ++k)
+		{
+			stSummary.dReachRate[k] = (double)u64Reach[k] / n;
+			stSummary.stReachCI[k] = Wilson(u64Reach[k], n);
+		}
+
+		return stSummary;
+	}
+
+	static void Worker(const Options &stOptions, std::string_view svPolicy, std::atomic<uint64_t> &u64NextGame, std::vector<Game_Result> &vecResults)
+	{
+		while (true)
+		{
+			uint64_t u64Game = u64NextGame.fetch_add(1, std::memory_order_relaxed);
+			if (u64Game >= stOptions.u64Games)
+			{
+				break;
+			}
+
+			uint64_t u64Seed = (uint64_t)stOptions.u32SeedBase + u64Game;
+			auto upPolicy = Game2048_Policy::Create(svPolicy, u64Seed * 0x9E3779B97F4A7C15ULL, stOptions.stContext);
+			vecResults[u64Game] = PlayGame(*upPolicy, u64Seed);
+		}
+	}
+
+	static void PrintSummary(const Summary &stSummary)
+	{
+		printf("%-10s Mean:[%.1f ±%.1f] Median:[%.1f] P10:[%" PRIu64 "] P90:[%" PRIu64 "] Max:[%" PRIu64 "]",
+			stSummary.strPolicy.c_str(), stSummary.dMean, stSummary.stMeanCI.dHigh - stSummary.dMean, stSummary.dMedian,
+			stSummary.u64Percentile[0], stSummary.u64Percentile[3], stSummary.u64Max);
+		for (size_t k = 0; k < std::size(u8ReachExp); ++k)
+		{
+			printf(" %" PRIu64 ":[%.1f%%]", Board_Packed::ExponentToValue(u8ReachExp[k]), 100 * stSummary.dReachRate[k]);
+		}
+		printf(" %.0f moves/s\n", stSummary.dSeconds > 0 ? stSummary.u64Moves / stSummary.dSeconds : 0.0);
+	}
+
+	//写出"名称": "路径"或null，路径只转义引号与反斜杠，足够覆盖常见文件名
+	static void WritePath(FILE *pFile, const char *pName, const char *pPath)
+	{
+		if (pPath == nullptr)
+		{
+			fprintf(pFile, "  \"%s\": null,\n", pName);
+			return;
+		}
+
+		fprintf(pFile, "  \"%s\": \"", pName);
+		for (const char *p = pPath; *p != '\0'; ++p)
+		{
+			if (*p == '"' || *p == '\\')
+			{
+				fputc('\\', pFile);
+			}
+			fputc(*p, pFile);
+		}
+		fprintf(pFile, "\",\n");
+	}
+
+	static bool WriteReport(const char *pPath, const Options &stOptions, uint32_t u32Threads, const std::vector<Summary> &vecSummaries)
+	{
+		std::string strTemp = std::string(pPath) + ".tmp";
+		FILE *pFile = fopen(strTemp.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			return false;
+		}
+
+		fprintf(pFile, "{\n");
+		fprintf(pFile, "  \"games\": %" PRIu64 ",\n", stOptions.u64Games);
+		fprintf(pFile, "  \"seed\": %" PRIu32 ",\n", stOptions.u32SeedBase);
+		fprintf(pFile, "  \"threads\": %" PRIu32 ",\n", u32Threads);
+		fprintf(pFile, "  \"depth\": %" PRIu32 ",\n", stOptions.stContext.u32Depth);
+		fprintf(pFile, "  \"rollouts\": %" PRIu32 ",\n", stOptions.stContext.u32Rollouts);
+		WritePath(pFile, "weights", stOptions.pWeightsPath);
+		WritePath(pFile, "heuristic", stOptions.pHeuristicPath);
+
+		fprintf(pFile, "  \"policies\": [\n");
+		for (size_t i = 0; i < vecSummaries.size(); ++i)
+		{
+			const Summary &st = vecSummaries[i];
+			fprintf(pFile, "    {\n");
+			fprintf(pFile, "      \"name\": \"%s\",\n", st.strPolicy.c_str());
+			fprintf(pFile, "      \"games\": %" PRIu64 ",\n", st.u64Games);
+			fprintf(pFile, "      \"moves\": %" PRIu64 ",\n", st.u64Moves);
+			fprintf(pFile, "      \"seconds\": %.6f,\n", st.dSeconds);
+			fprintf(pFile, "      \"moves_per_second\": %.1f,\n", st.dSeconds > 0 ? st.u64Moves / st.dSeconds : 0.0);
+			fprintf(pFile, "      \"score\": {\n");
+			fprintf(pFile, "        \"mean\": %.3f,\n", st.dMean);
+			fprintf(pFile, "        \"stddev\": %.3f,\n", st.dStdDev);
+			fprintf(pFile, "        \"mean_ci95\": [%.3f, %.3f],\n", st.stMeanCI.dLow, st.stMeanCI.dHigh);
+			fprintf(pFile, "        \"median\": %.1f,\n", st.dMedian);
+			fprintf(pFile, "        \"min\": %" PRIu64 ",\n", st.u64Min);
+			fprintf(pFile, "        \"max\": %" PRIu64 ",\n", st.u64Max);
+			fprintf(pFile, "        \"percentiles\": {");
+			for (size_t k = 0; k < std::size(dPercentiles); ++k)
+			{
+				fprintf(pFile, "%s\"p%.0f\": %" PRIu64, k != 0 ? ", " : "", dPercentiles[k], st.u64Percentile[k]);
+			}
+			fprintf(pFile, "}\n");
+			fprintf(pFile, "      },\n");
+			fprintf(pFile, "      \"reach\": {\n");
+			for (size_t k = 0; k < std::size(u8ReachExp); ++k)
+			{
+				fprintf(pFile, "        \"%" PRIu64 "\": {\"rate\": %.6f, \"ci95\": [%.6f, %.6f]}%s\n",
+					Board_Packed::ExponentToValue(u8ReachExp[k]), st.dReachRate[k], st.stReachCI[k].dLow, st.stReachCI[k].dHigh,
+					k + 1 != std::size(u8ReachExp) ? "," : "");
+			}
+			fprintf(pFile, "      }\n");
+			fprintf(pFile, "    }%s\n", i + 1 != vecSummaries.size() ? "," : "");
+		}
+		fprintf(pFile, "  ]\n");
+		fprintf(pFile, "}\n");
+
+		bool bRet = !ferror(pFile);
+		bRet = fclose(pFile) == 0 && bRet;
+
+		std::error_code ec{};
+		if (bRet)
+		{
+			std::filesystem::rename(strTemp, pPath, ec);
+		}
+		if (!bRet || ec)
+		{
+			std::filesystem::remove(strTemp, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+public:
+	//评测单个策略，策略名必须有效
+	static Summary RunPolicy(const Options &stOptions, std::string_view svPolicy, uint32_t u32Threads)
+	{
+		std::vector<Game_Result> vecResults((size_t)stOptions.u64Games);
+		std::atomic<uint64_t> u64NextGame{ 0 };
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		std::vector<std::thread> vecThreads;
+		for (uint32_t i = 0; i < u32Threads; ++i)
+		{
+			vecThreads.emplace_back(Worker, std::cref(stOptions), svPolicy, std::ref(u64NextGame), std::ref(vecResults));
+		}
+		for (auto &it : vecThreads)
+		{
+			it.join();
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		return Summarize(svPolicy, vecResults, std::chrono::duration<double>(tpEnd - tpBeg).count());
+	}
+
+	static int Main(const Command_Line &cmd)
+	{
+		Options stOptions{};
+		stOptions.u64Games = cmd.GetU64("games", stOptions.u64Games);
+		stOptions.u32SeedBase = (uint32_t)cmd.GetU64("seed", stOptions.u32SeedBase);
+		stOptions.u32Threads = (uint32_t)cmd.GetU64("threads", stOptions.u32Threads);
+		const char *pReportPath = cmd.GetString("report", "Game2048_tournament.json");
+
+		Game2048_Policy_Options policyOptions{};
+		if (!policyOptions.Load(cmd, false))
+		{
+			return 1;
+		}
+		stOptions.stContext = policyOptions.stContext;
+
+		stOptions.pWeightsPath = policyOptions.GetWeightsPath();
+		stOptions.pHeuristicPath = policyOptions.GetHeuristicPath();
+
+		std::string_view svPolicies = cmd.GetString("policies", stOptions.pWeightsPath != nullptr ? "random,greedy,montecarlo,ntuple,expectimax" : "random,greedy,montecarlo,expectimax");
+		while (!svPolicies.empty())
+		{
+			size_t szComma = svPolicies.find(',');
+			std::string_view svName = svPolicies.substr(0, szComma);
+			svPolicies = szComma != std::string_view::npos ? svPolicies.substr(szComma + 1) : std::string_view{};
+
+			if (Game2048_Policy::Create(svName, 0, stOptions.stContext) == nullptr)
+			{
+				fprintf(stderr, "Error: unknown policy [%.*s]\n", (int)svName.size(), svName.data());
+				return 1;
+			}
+			stOptions.vecPolicies.emplace_back(svName);
+		}
+
+		if (stOptions.u64Games == 0 || stOptions.vecPolicies.empty())
+		{
+			fprintf(stderr, "Error: nothing to evaluate\n");
+			return 1;
+		}
+
+		uint32_t u32Threads = stOptions.u32Threads != 0 ? stOptions.u32Threads : std::thread::hardware_concurrency();
+		u32Threads = u32Threads != 0 ? u32Threads : 1;
+
+		printf("Games:[%" PRIu64 "] Seed:[%" PRIu32 "] Threads:[%" PRIu32 "]\n", stOptions.u64Games, stOptions.u32SeedBase, u32Threads);
+		std::vector<Summary> vecSummaries;
+		for (const auto &it : stOptions.vecPolicies)
+		{
+			vecSummaries.push_back(RunPolicy(stOptions, it, u32Threads));
+			PrintSummary(vecSummaries.back());
+			fflush(stdout);
+		}
+
+		if (!WriteReport(pReportPath, stOptions, u32Threads, vecSummaries))
+		{
+			fprintf(stderr, "Error: cannot write report [%s]\n", pReportPath);
+			return 1;
+		}
+		printf("Report:[%s]\n", pReportPath);
+
+		return 0;
+	}
+};
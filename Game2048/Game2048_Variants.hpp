@@ -0,0 +1,175 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <chrono>
+#include <string_view>
+#include <vector>
+
+#include "Command_Line.hpp"
+#include "Board_Packed.hpp"
+#include "Board_Wide.hpp"
+#include "Game2048_Core.hpp"
+#include "Game2048_Policy.hpp"
+
+/*
+规则变体实验：每种规则都是单独实例化的Game2048_Core_Basic，用同一策略在同一组种子上对局，
+比较到达目标的比例、分数、步数与速度（classic与Game2048_Core是同一个类型，速度即经典规则的速度）
+
+内置规则：
+	名称       目标   生成   每步生成  到达目标后
+	classic    2048   2/4    1         结束
+	endless    2048   2/4    1         继续
+	goal1024   1024   2/4    1         结束
+	goal4096   4096   2/4    1         结束
+	double     2048   2/4    2         结束
+	big        2048   4/8    1         结束
+新增规则只需在arrVariants中加一项
+
+用法：
+	Game2048 variants [--rules 名称,名称,...] [--games N] [--seed S] [--policy P] [--depth D]
+	默认评测所有内置规则，策略默认greedy（策略只看压缩棋盘，不知道规则）
+*/
+class Game2048_Variants
+{
+private:
+	struct Options
+	{
+		uint64_t u64Games = 1000;
+		uint32_t u32SeedBase = 0;
+		const char *pPolicy = "greedy";
+		Game2048_Policy::Context stContext{};
+	};
+
+	using Run_Func = void (*)(const char *pName, const Options &stOptions);
+
+	struct Variant
+	{
+		const char *pName;
+		Run_Func pRun;
+	};
+
+	template<typename Rules>
+	static void Run(const char *pName, const Options &stOptions)
+	{
+		auto upPolicy = Game2048_Policy::Create(stOptions.pPolicy, stOptions.u32SeedBase, stOptions.stContext);
+		Game2048_Core_Basic<Rules> core(0);
+
+		uint64_t u64Moves = 0;
+		uint64_t u64Reached = 0;
+		uint64_t u64ScoreSum = 0;
+		uint8_t u8MaxExp = 0;
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		for (uint64_t g = 0; g < stOptions.u64Games; ++g)
+		{
+			core.NewGame((uint32_t)(stOptions.u32SeedBase + g));
+			while (core.GetStatus() == Game2048_Core_Base::InGame)
+			{
+				Board_Packed::Board u64Board = core.GetPackedBoard();
+				if (Board_Packed::LegalMoves(u64Board) == 0)
+				{
+					break;//超过32768的格子在压缩棋盘中被截断，可能与引擎的判断不同，这里仅作保护
+				}
+
+				if (!core.ProcessMove((Game2048_Core_Base::Direction)upPolicy->Choose(u64Board)))
+				{
+					break;
+				}
+				++u64Moves;
+			}
+
+			u64Reached += core.HasReachedWin();
+			u64ScoreSum += core.GetScore();
+			uint8_t u8Exp = Board_Wide::MaxExponent(core.GetWideBoard());//不截断
+			u8MaxExp = u8Exp > u8MaxExp ? u8Exp : u8MaxExp;
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+		printf("%-9s Goal:[%" PRIu64 "] Spawn:[%" PRIu64 "/%" PRIu64 "x%zu] Reached:[%.2f%%] AvgScore:[%.1f] AvgMoves:[%.1f] MaxTile:[%" PRIu64 "] %.0f moves/s\n",
+			pName, Rules::u64WinTile, Rules::u64SpawnLow, Rules::u64SpawnHigh, Rules::szSpawnPerMove,
+			100.0 * u64Reached / stOptions.u64Games,
+			(double)u64ScoreSum / stOptions.u64Games,
+			(double)u64Moves / stOptions.u64Games,
+			Board_Wide::ExponentToValue(u8MaxExp),
+			dSeconds > 0 ? u64Moves / dSeconds : 0.0);
+	}
+
+	constexpr const static inline Variant arrVariants[] =
+	{
+		{ "classic", Run<Game2048_Rules_Classic> },
+		{ "endless", Run<Game2048_Rules_Endless> },
+		{ "goal1024", Run<Game2048_Rules<1024, 2, 4, 1, false>> },
+		{ "goal4096", Run<Game2048_Rules<4096, 2, 4, 1, false>> },
+		{ "double", Run<Game2048_Rules<2048, 2, 4, 2, false>> },
+		{ "big", Run<Game2048_Rules<2048, 4, 8, 1, false>> },
+	};
+
+	static const Variant *Find(std::string_view svName)
+	{
+		for (const auto &it : arrVariants)
+		{
+			if (svName == it.pName)
+			{
+				return &it;
+			}
+		}
+
+		return nullptr;
+	}
+
+public:
+	static int Main(const Command_Line &cmd)
+	{
+		Options stOptions{};
+		stOptions.u64Games = cmd.GetU64("games", stOptions.u64Games);
+		stOptions.u32SeedBase = (uint32_t)cmd.GetU64("seed", stOptions.u32SeedBase);
+		stOptions.pPolicy = cmd.GetString("policy", stOptions.pPolicy);
+		stOptions.stContext.u32Depth = (uint32_t)cmd.GetU64("depth", stOptions.stContext.u32Depth);
+
+		if (stOptions.u64Games == 0)
+		{
+			fprintf(stderr, "Error: nothing to evaluate\n");
+			return 1;
+		}
+		if (Game2048_Policy::Create(stOptions.pPolicy, 0, stOptions.stContext) == nullptr)
+		{
+			fprintf(stderr, "Error: unknown policy [%s]\n", stOptions.pPolicy);
+			return 1;
+		}
+
+		//先检查所有名称再开始运行
+		std::vector<const Variant *> vecRun{};
+		std::string_view svRules = cmd.GetString("rules", "");
+		while (!svRules.empty())
+		{
+			size_t szComma = svRules.find(',');
+			std::string_view svName = svRules.substr(0, szComma);
+			svRules = szComma != std::string_view::npos ? svRules.substr(szComma + 1) : std::string_view{};
+
+			const Variant *pVariant = Find(svName);
+			if (pVariant == nullptr)
+			{
+				fprintf(stderr, "Error: unknown rules [%.*s]\n", (int)svName.size(), svName.data());
+				return 1;
+			}
+			vecRun.push_back(pVariant);
+		}
+		if (vecRun.empty())
+		{
+			for (const auto &it : arrVariants)
+			{
+				vecRun.push_back(&it);
+			}
+		}
+
+		for (const Variant *pVariant : vecRun)
+		{
+			pVariant->pRun(pVariant->pName, stOptions);
+		}
+
+		return 0;
+	}
+};
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+	#include <errno.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <arpa/inet.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+#endif
+
+//本机监听套接字（仅Linux）：Unix域套接字或127.0.0.1上的TCP端口，只接受本机连接，server与spectate共用
+class Local_Socket
+{
+public:
+#if defined(__linux__)
+	//pUnixPath非空时监听Unix域套接字，否则监听127.0.0.1:u16Port，返回非阻塞的监听套接字，失败输出错误并返回-1
+	static int Listen(const char *pUnixPath, uint16_t u16Port)
+	{
+		int iFd;
+		if (pUnixPath != nullptr)
+		{
+			sockaddr_un stAddr{};
+			if (strlen(pUnixPath) >= sizeof(stAddr.sun_path))
+			{
+				fprintf(stderr, "Error: unix socket path too long\n");
+				return -1;
+			}
+			stAddr.sun_family = AF_UNIX;
+			strcpy(stAddr.sun_path, pUnixPath);
+
+			iFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (iFd < 0)
+			{
+				fprintf(stderr, "Error: socket failed: %s\n", strerror(errno));
+				return -1;
+			}
+
+			unlink(pUnixPath);//上次异常退出遗留的套接字文件
+			if (bind(iFd, (const sockaddr *)&stAddr, sizeof(stAddr)) != 0)
+			{
+				fprintf(stderr, "Error: bind [%s] failed: %s\n", pUnixPath, strerror(errno));
+				close(iFd);
+				return -1;
+			}
+		}
+		else
+		{
+			sockaddr_in stAddr{};
+			stAddr.sin_family = AF_INET;
+			stAddr.sin_port = htons(u16Port);
+			stAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);//只接受本机连接
+
+			iFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (iFd < 0)
+			{
+				fprintf(stderr, "Error: socket failed: %s\n", strerror(errno));
+				return -1;
+			}
+
+			int iOne = 1;
+			setsockopt(iFd, SOL_SOCKET, SO_REUSEADDR, &iOne, sizeof(iOne));
+			if (bind(iFd, (const sockaddr *)&stAddr, sizeof(stAddr)) != 0)
+			{
+				fprintf(stderr, "Error: bind 127.0.0.1:%u failed: %s\n", (unsigned)u16Port, strerror(errno));
+				close(iFd);
+				return -1;
+			}
+		}
+
+		if (listen(iFd, SOMAXCONN) != 0)
+		{
+			fprintf(stderr, "Error: listen failed: %s\n", strerror(errno));
+			close(iFd);
+			return -1;
+		}
+
+		return iFd;
+	}
+#endif
+};
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bit>
+
+/*
+对数线性直方图（HDR风格）：按2的幂分段，每段32个线性子桶，64以下每个值一个桶，相对误差约3%
+大小固定（约15KB），与记录次数无关；两个直方图逐桶相加即可合并，可以作为多线程可合并的分位数估计
+*/
+struct Log_Histogram
+{
+	constexpr const static inline size_t szSubBits = 5;
+	constexpr const static inline size_t szSubCount = (size_t)1 << szSubBits;
+	constexpr const static inline size_t szBucketCount = (64 - szSubBits + 1) * szSubCount;
+
+	uint64_t u64Buckets[szBucketCount] = {};
+	uint64_t u64Count = 0;
+	uint64_t u64Sum = 0;
+	uint64_t u64Max = 0;
+
+	static size_t BucketOf(uint64_t u64Value)
+	{
+		if (u64Value < szSubCount * 2)
+		{
+			return (size_t)u64Value;
+		}
+
+		size_t szShift = (size_t)std::bit_width(u64Value) - (szSubBits + 1);
+		return (szShift + 1) * szSubCount + (size_t)((u64Value >> szShift) - szSubCount);
+	}
+
+	//桶的下界
+	static uint64_t LowerOf(size_t szBucket)
+	{
+		if (szBucket < szSubCount * 2)
+		{
+			return szBucket;
+		}
+
+		size_t szShift = szBucket / szSubCount - 1;
+		return (uint64_t)(szSubCount + szBucket % szSubCount) << szShift;
+	}
+
+	void Record(uint64_t u64Value)
+	{
+		++u64Buckets[BucketOf(u64Value)];
+		++u64Count;
+		u64Sum += u64Value;
+		u64Max = u64Value > u64Max ? u64Value : u64Max;
+	}
+
+	void Merge(const Log_Histogram &stOther)
+	{
+		for (size_t i = 0; i < szBucketCount; ++i)
+		{
+			u64Buckets[i] += stOther.u64Buckets[i];
+		}
+		u64Count += stOther.u64Count;
+		u64Sum += stOther.u64Sum;
+		u64Max = stOther.u64Max > u64Max ? stOther.u64Max : u64Max;
+	}
+
+	double Mean(void) const
+	{
+		return u64Count != 0 ? (double)u64Sum / u64Count : 0.0;
+	}
+
+	//第dQuantile分位所在桶的下界
+	uint64_t Quantile(double dQuantile) const
+	{
+		uint64_t u64Rank = (uint64_t)(dQuantile * (double)u64Count);
+		uint64_t u64Seen = 0;
+		for (size_t i = 0; i < szBucketCount; ++i)
+		{
+			u64Seen += u64Buckets[i];
+			if (u64Seen > u64Rank)
+			{
+				return LowerOf(i);
+			}
+		}
+
+		return u64Max;
+	}
+};
@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+//只读内存映射文件，映射后直接按文件内的结构访问，无须解析与拷贝
+class Mapped_File
+{
+private:
+	const uint8_t *pData;
+	size_t szSize;
+
+#if defined(_WIN32)
+	HANDLE hFile;
+	HANDLE hMapping;
+#elif defined(__linux__)
+	int iFd;
+#endif
+
+public:
+	Mapped_File(void) :
+		pData(nullptr),
+		szSize(0),
+#if defined(_WIN32)
+		hFile(INVALID_HANDLE_VALUE),
+		hMapping(NULL)
+#elif defined(__linux__)
+		iFd(-1)
+#endif
+	{}
+	~Mapped_File(void)
+	{
+		Close();
+	}
+
+	Mapped_File(const Mapped_File &) = delete;
+	Mapped_File &operator=(const Mapped_File &) = delete;
+
+	bool Open(const char *pPath)
+	{
+		Close();
+
+#if defined(_WIN32)
+		hFile = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER liSize{};
+		if (!GetFileSizeEx(hFile, &liSize) || liSize.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+
+		hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (hMapping == NULL)
+		{
+			Close();
+			return false;
+		}
+
+		pData = (const uint8_t *)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		szSize = (size_t)liSize.QuadPart;
+#elif defined(__linux__)
+		iFd = open(pPath, O_RDONLY);
+		if (iFd < 0)
+		{
+			return false;
+		}
+
+		struct stat stStat{};
+		if (fstat(iFd, &stStat) != 0 || stStat.st_size == 0)
+		{
+			Close();
+			return false;
+		}
+
+		void *pMap = mmap(NULL, (size_t)stStat.st_size, PROT_READ, MAP_SHARED, iFd, 0);
+		pData = pMap != MAP_FAILED ? (const uint8_t *)pMap : nullptr;
+		szSize = (size_t)stStat.st_size;
+#endif
+
+		if (pData == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Close(void)
+	{
+#if defined(_WIN32)
+		if (pData != nullptr)
+		{
+			UnmapViewOfFile(pData);
+		}
+		if (hMapping != NULL)
+		{
+			CloseHandle(hMapping);
+			hMapping = NULL;
+		}
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(hFile);
+			hFile = INVALID_HANDLE_VALUE;
+		}
+#elif defined(__linux__)
+		if (pData != nullptr)
+		{
+			munmap((void *)pData, szSize);
+		}
+		if (iFd >= 0)
+		{
+			close(iFd);
+			iFd = -1;
+		}
+#endif
+
+		pData = nullptr;
+		szSize = 0;
+	}
+
+	bool IsOpen(void) const
+	{
+		return pData != nullptr;
+	}
+
+	const uint8_t *Data(void) const
+	{
+		return pData;
+	}
+
+	size_t Size(void) const
+	{
+		return szSize;
+	}
+
+	//按偏移获取指定类型的指针，越界返回nullptr
+	template<typename T>
+	const T *At(uint64_t u64Offset, size_t szCount = 1) const
+	{
+		if (u64Offset > szSize || (szSize - u64Offset) / sizeof(T) < szCount)
+		{
+			return nullptr;
+		}
+
+		return (const T *)(pData + u64Offset);
+	}
+};
@@ -1,12 +1,126 @@
 ﻿#include "Game2048.hpp"
+#include "Game2048_Replay.hpp"
+#include "Game2048_SelfPlay.hpp"
+#include "Game2048_Archive.hpp"
+#include "Game2048_Export.hpp"
+#include "Game2048_NTuple.hpp"
+#include "Game2048_Symmetry.hpp"
+#include "Game2048_Tablebase.hpp"
+#include "Game2048_EnvBench.hpp"
+#include "Game2048_SessionArena.hpp"
+#include "Game2048_Server.hpp"
+#include "Game2048_Bot.hpp"
+#include "Game2048_Tournament.hpp"
+#include "Game2048_Heuristic.hpp"
+#include "Game2048_Variants.hpp"
+#include "Board_Wide_Bench.hpp"
+#include "Game2048_AutoPlay.hpp"
+#include "Game2048_Spectate.hpp"
+#include "Game2048_BookBuilder.hpp"
+#include "Game2048_Shard.hpp"
+#include "Game2048_Profile.hpp"
+#include "Command_Line.hpp"
 
-int main(void)
+int main(int argc, char *argv[])
 {
+	Command_Line cmd(argc, argv);
+
+	//热路径耗时统计，退出时输出到stderr
+	const char *pProfileEnv = getenv("GAME2048_PROFILE");
+	if (cmd.HasFlag("profile") || (pProfileEnv != nullptr && pProfileEnv[0] != '\0'))
+	{
+		Game2048_Profile::Enable();
+	}
+
+	//非交互模式
+	if (cmd.Mode() == "replay")
+	{
+		return Game2048_Replay::Main(cmd);
+	}
+	else if (cmd.Mode() == "selfplay")
+	{
+		return Game2048_SelfPlay::Main(cmd);
+	}
+	else if (cmd.Mode() == "archive")
+	{
+		return Game2048_Archive_Tool::Main(cmd);
+	}
+	else if (cmd.Mode() == "dataset")
+	{
+		return Game2048_Export_Reader::Main(cmd);
+	}
+	else if (cmd.Mode() == "train")
+	{
+		return Game2048_NTuple_Trainer::Main(cmd);
+	}
+	else if (cmd.Mode() == "symmetry")
+	{
+		return Game2048_Symmetry_Bench::Main(cmd);
+	}
+	else if (cmd.Mode() == "tablebase")
+	{
+		return Game2048_Tablebase_Tool::Main(cmd);
+	}
+	else if (cmd.Mode() == "envbench")
+	{
+		return Game2048_EnvBench::Main(cmd);
+	}
+	else if (cmd.Mode() == "arena")
+	{
+		return Game2048_SessionArena_Bench::Main(cmd);
+	}
+	else if (cmd.Mode() == "server")
+	{
+		return Game2048_Server::Main(cmd);
+	}
+	else if (cmd.Mode() == "bot")
+	{
+		return Game2048_Bot::Main(cmd);
+	}
+	else if (cmd.Mode() == "tournament")
+	{
+		return Game2048_Tournament::Main(cmd);
+	}
+	else if (cmd.Mode() == "heuristic")
+	{
+		return Game2048_Heuristic_Bench::Main(cmd);
+	}
+	else if (cmd.Mode() == "variants")
+	{
+		return Game2048_Variants::Main(cmd);
+	}
+	else if (cmd.Mode() == "wide")
+	{
+		return Board_Wide_Bench::Main(cmd);
+	}
+	else if (cmd.Mode() == "autoplay")
+	{
+		return Game2048_AutoPlay::Main(cmd);
+	}
+	else if (cmd.Mode() == "spectate")
+	{
+		return Game2048_Spectate::Main(cmd);
+	}
+	else if (cmd.Mode() == "book")
+	{
+		return Game2048_BookBuilder::Main(cmd);
+	}
+	else if (cmd.Mode() == "shard")
+	{
+		return Game2048_Shard::Main(cmd);
+	}
+
 	Console_Input ci{};
 	Console_Output co{};
 
 	//游戏对象
-	Game2048 game(ci, co);
+	uint32_t u32Seed = cmd.HasFlag("seed") ? (uint32_t)cmd.GetU64("seed", 0) : std::random_device{}();
+	Game2048 game(ci, co, u32Seed);
+
+	//录像
+	game.EnableRecord(cmd.GetString("record"));
+	//快照
+	game.EnableSnapshot(cmd.HasFlag("no-save") ? nullptr : cmd.GetString("save", "Game2048.sav"));
 
 	//初始化
 	game.Init();
@@ -21,6 +135,6 @@ int main(void)
 	{
 		continue;
 	}
-	
+
 	return 0;
 }
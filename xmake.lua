@@ -3,4 +3,17 @@ add_rules("mode.debug", "mode.release")
 target("Game2048")
 	set_kind("binary")
 	set_languages("c++20")
-	add_files("Game2048/*.cpp")
\ No newline at end of file
+	add_files("Game2048/main.cpp")
+	if is_plat("linux") then
+		add_syslinks("pthread")
+	end
+
+target("Game2048_Env")
+	set_kind("shared")
+	set_languages("c++20")
+	add_files("Game2048/Game2048_Env.cpp")
+	add_defines("GAME2048_ENV_BUILD")
+	set_symbols("hidden")
+	if is_plat("linux") then
+		add_syslinks("pthread")
+	end